@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha512_ce_glue.c - SHA-384/SHA-512 secure hash using ARMv8.2 Crypto
+ * Extensions
+ */
+
+#include <asm/system.h>
+#include <u-boot/sha512.h>
+
+extern void sha512_armv8_ce_process(uint64_t state[8], uint8_t const *src,
+				    uint32_t blocks);
+
+/* -1 until probed, then 0 or 1 depending on ID_AA64ISAR0_EL1.SHA2 */
+static int sha512_ce_present = -1;
+
+/* The SHA-512 instructions are optional even on ARMv8.2 cores */
+static bool sha512_has_ce(void)
+{
+	uint64_t reg;
+
+	if (sha512_ce_present < 0) {
+		__asm__ volatile("mrs %0, ID_AA64ISAR0_EL1\n" : "=r" (reg));
+		sha512_ce_present = (reg & ID_AA64ISAR0_EL1_SHA2) >=
+				    ID_AA64ISAR0_EL1_SHA2_SHA512;
+	}
+
+	return sha512_ce_present;
+}
+
+void sha512_process(sha512_context *ctx, const unsigned char *data,
+		    unsigned int blocks)
+{
+	if (!blocks)
+		return;
+
+	if (sha512_has_ce())
+		sha512_armv8_ce_process(ctx->state, data, blocks);
+	else
+		sha512_base_process(ctx, data, blocks);
+}
@@ -156,6 +156,9 @@ void enable_caches(void)
 	 * warning: the TLB location udpated in board_f.c::reserve_mmu
 	 */
 	dcache_enable();
+
+	/* the reserved regions are only needed to set up the MMU */
+	lmb_uninit(&lmb);
 }
 
 static void setup_boot_mode(void)
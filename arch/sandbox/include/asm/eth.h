@@ -80,6 +80,7 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * recv_packet_buffer - buffers of the packet returned as received
  * recv_packet_length - lengths of the packet returned as received
  * recv_packets - number of packets returned
+ * batch_buffer - copies of the packets last returned by recv_batch()
  * tx_handler - function to generate responses to sent packets
  * priv - a pointer to some structure a test may want to keep track of
  */
@@ -90,6 +91,7 @@ struct eth_sandbox_priv {
 	uchar * recv_packet_buffer[PKTBUFSRX];
 	int recv_packet_length[PKTBUFSRX];
 	int recv_packets;
+	uchar batch_buffer[PKTBUFSRX][PKTSIZE_ALIGN];
 	sandbox_eth_tx_hand_f *tx_handler;
 	void *priv;
 };
@@ -1294,8 +1294,123 @@ int calculate_hash(const void *data, int data_len, const char *name,
 	return 0;
 }
 
+/* Largest number of hash nodes which can be checked while copying an image */
+#define FIT_COPY_MAX_HASHES	4
+
+/* Amount of data copied and then hashed while it is still in the cache */
+#define FIT_COPY_CHUNK_SZ	(16 * 1024)
+
+/**
+ * struct fit_hash_value - hash calculated while copying image data
+ *
+ * @len: length of @value in bytes, 0 if the hash node is ignored
+ * @value: hash value
+ */
+struct fit_hash_value {
+	int len;
+	uint8_t value[FIT_MAX_HASH_LEN];
+};
+
+#ifndef USE_HOSTCC
+/**
+ * fit_image_hash_copy() - copy image data while calculating its hashes
+ *
+ * Copy the data a chunk at a time, passing each chunk to the progressive hash
+ * of every hash node of the image while it is still in the cache, so that the
+ * data is only read from memory once.
+ *
+ * This is not done for hardware hashing, which does not read the data through
+ * the cache anyway.
+ *
+ * @fit: FIT containing the image
+ * @image_noffset: Offset of the image node
+ * @dst: Destination for the data
+ * @data: Image data
+ * @size: Size of @data in bytes
+ * @values: Returns the value for each hash node, in order
+ * Return: 0 if OK, -ENOSYS if the hashes cannot be calculated this way, in
+ * which case @dst may have been partly written
+ */
+static int fit_image_hash_copy(const void *fit, int image_noffset, void *dst,
+			       const void *data, size_t size,
+			       struct fit_hash_value *values)
+{
+	struct hash_algo *algos[FIT_COPY_MAX_HASHES];
+	void *ctxs[FIT_COPY_MAX_HASHES];
+	int count = 0, noffset, ignore, i;
+	size_t ofs = 0, chunk;
+	const char *algo;
+	int ret = 0;
+
+	if (IS_ENABLED(CONFIG_DM_HASH) || CONFIG_IS_ENABLED(SHA_HW_ACCEL) ||
+	    CONFIG_IS_ENABLED(SHA512_HW_ACCEL))
+		return -ENOSYS;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (count == FIT_COPY_MAX_HASHES ||
+		    fit_image_hash_get_algo(fit, noffset, &algo))
+			return -ENOSYS;
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		algos[count] = NULL;
+		if (!ignore && hash_progressive_lookup_algo(algo, &algos[count]))
+			return -ENOSYS;
+		count++;
+	}
+
+	for (i = 0; i < count; i++) {
+		values[i].len = 0;
+		if (algos[i] && algos[i]->hash_init(algos[i], &ctxs[i])) {
+			count = i;
+			ret = -ENOSYS;
+			goto finish;
+		}
+	}
+
+	do {
+		chunk = min_t(size_t, size - ofs, FIT_COPY_CHUNK_SZ);
+		memcpy(dst + ofs, data + ofs, chunk);
+		for (i = 0; i < count; i++) {
+			if (!algos[i])
+				continue;
+			if (algos[i]->hash_update(algos[i], ctxs[i], dst + ofs,
+						  chunk, ofs + chunk == size)) {
+				/* the context is gone, so just drop this one */
+				algos[i] = NULL;
+				ret = -ENOSYS;
+			}
+		}
+		ofs += chunk;
+		schedule();
+	} while (ofs < size && !ret);
+
+finish:
+	for (i = 0; i < count; i++) {
+		if (!algos[i])
+			continue;
+		if (algos[i]->hash_finish(algos[i], ctxs[i], values[i].value,
+					  sizeof(values[i].value)))
+			ret = -ENOSYS;
+		values[i].len = algos[i]->digest_size;
+	}
+
+	return ret;
+}
+#else
+static int fit_image_hash_copy(const void *fit, int image_noffset, void *dst,
+			       const void *data, size_t size,
+			       struct fit_hash_value *values)
+{
+	return -ENOSYS;
+}
+#endif
+
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+				size_t size, const struct fit_hash_value *hv,
+				char **err_msgp)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
 	int value_len;
@@ -1326,7 +1441,11 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	if (hv) {
+		/* already calculated while copying the data */
+		memcpy(value, hv->value, hv->len);
+		value_len = hv->len;
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -1342,16 +1461,39 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	return 0;
 }
 
-int fit_image_verify_with_data(const void *fit, int image_noffset,
-			       const void *key_blob, const void *data,
-			       size_t size)
+/**
+ * fit_image_verify_data() - verify image data, optionally copying it
+ *
+ * This checks the signatures and hashes of an image against @data. If @dst is
+ * not NULL, the required signatures are checked against @data, then the data
+ * is copied to @dst, calculating the hashes on the way where possible, and the
+ * hashes are checked at @dst. Since the data is written before its hashes are
+ * known to be correct, @dst must be memory which is not otherwise in use and
+ * @size must be known to be correct.
+ *
+ * @fit: FIT containing the image
+ * @image_noffset: Offset of the image node
+ * @key_blob: FDT containing public keys
+ * @data: Image data
+ * @size: Size of @data in bytes
+ * @dst: Destination to copy the data to, or NULL
+ * Return: 1 if verified, 0 if not
+ */
+static int fit_image_verify_data(const void *fit, int image_noffset,
+				 const void *key_blob, const void *data,
+				 size_t size, void *dst)
 {
+	struct fit_hash_value values[FIT_COPY_MAX_HASHES];
+	struct fit_hash_value *hv = NULL;
 	int		noffset = 0;
 	char		*err_msg = "";
 	int verify_all = 1;
 	int ret;
 
-	/* Verify all required signatures */
+	/*
+	 * Verify all required signatures, before anything is written to @dst,
+	 * so that an image which is not signed is never copied
+	 */
 	if (FIT_IMAGE_ENABLE_VERIFY &&
 	    fit_image_verify_required_sigs(fit, image_noffset, data, size,
 					   key_blob, &verify_all)) {
@@ -1359,6 +1501,15 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		goto error;
 	}
 
+	if (dst) {
+		if (fit_image_hash_copy(fit, image_noffset, dst, data, size,
+					values))
+			memcpy(dst, data, size);
+		else
+			hv = values;
+		data = dst;
+	}
+
 	/* Process all hash subnodes of the component image node */
 	fdt_for_each_subnode(noffset, fit, image_noffset) {
 		const char *name = fit_get_name(fit, noffset, NULL);
@@ -1370,9 +1521,11 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		 */
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
-			if (fit_image_check_hash(fit, noffset, data, size,
+			if (fit_image_check_hash(fit, noffset, data, size, hv,
 						 &err_msg))
 				goto error;
+			if (hv)
+				hv++;
 			puts("+ ");
 		} else if (FIT_IMAGE_ENABLE_VERIFY && verify_all &&
 				!strncmp(name, FIT_SIG_NODENAME,
@@ -1407,20 +1560,25 @@ error:
 	return 0;
 }
 
+int fit_image_verify_with_data(const void *fit, int image_noffset,
+			       const void *key_blob, const void *data,
+			       size_t size)
+{
+	return fit_image_verify_data(fit, image_noffset, key_blob, data, size,
+				     NULL);
+}
+
 /**
- * fit_image_verify - verify data integrity
+ * fit_image_verify_copy() - verify data integrity, optionally copying the data
  * @fit: pointer to the FIT format image header
  * @image_noffset: component image node offset
- *
- * fit_image_verify() goes over component image hash nodes,
- * re-calculates each data hash and compares with the value stored in hash
- * node.
+ * @dst: destination to copy the image data to while verifying it, or NULL
  *
  * returns:
  *     1, if all hashes are valid
  *     0, otherwise (or on error)
  */
-int fit_image_verify(const void *fit, int image_noffset)
+static int fit_image_verify_copy(const void *fit, int image_noffset, void *dst)
 {
 	const char *name = fit_get_name(fit, image_noffset, NULL);
 	const void	*data;
@@ -1441,8 +1599,8 @@ int fit_image_verify(const void *fit, int image_noffset)
 		goto err;
 	}
 
-	return fit_image_verify_with_data(fit, image_noffset, gd_fdt_blob(),
-					  data, size);
+	return fit_image_verify_data(fit, image_noffset, gd_fdt_blob(), data,
+				     size, dst);
 
 err:
 	printf("error!\n%s in '%s' image node\n", err_msg,
@@ -1450,6 +1608,24 @@ err:
 	return 0;
 }
 
+/**
+ * fit_image_verify - verify data integrity
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ *
+ * fit_image_verify() goes over component image hash nodes,
+ * re-calculates each data hash and compares with the value stored in hash
+ * node.
+ *
+ * returns:
+ *     1, if all hashes are valid
+ *     0, otherwise (or on error)
+ */
+int fit_image_verify(const void *fit, int image_noffset)
+{
+	return fit_image_verify_copy(fit, image_noffset, NULL);
+}
+
 /**
  * fit_all_image_verify - verify data integrity for all images
  * @fit: pointer to the FIT format image header
@@ -2051,6 +2227,59 @@ static const char *fit_get_image_type_property(int type)
 	return "unknown";
 }
 
+/**
+ * fit_image_copies_data() - check if image data is moved unchanged
+ *
+ * This is true when fit_image_load() copies the data as it is to the load
+ * address, so that its hashes can be checked while copying it.
+ *
+ * Since the data is then written before its hashes are checked, this also
+ * requires the whole load region to be free memory, so that a bad image
+ * cannot overwrite anything else. A wrong size, including a wrong
+ * 'data-size' for external data, then only fails the hash check.
+ *
+ * @images: Images information, providing the memory map
+ * @fit: FIT containing the image
+ * @noffset: Offset of the image node
+ * @image_type: Type of image being loaded
+ * @load_op: How to handle the load address
+ * Return: true if the data is copied unchanged
+ */
+static bool fit_image_copies_data(struct bootm_headers *images,
+				  const void *fit, int noffset, int image_type,
+				  enum fit_load_op load_op)
+{
+	size_t size;
+	ulong load;
+	uint8_t comp;
+	void *buf;
+
+	if (tools_build() || IS_ENABLED(CONFIG_FIT_IMAGE_POST_PROCESS) ||
+	    load_op == FIT_LOAD_IGNORED)
+		return false;
+	if (IS_ENABLED(CONFIG_FIT_CIPHER) && IMAGE_ENABLE_DECRYPT &&
+	    fdt_subnode_offset(fit, noffset, FIT_CIPHER_NODENAME) >= 0)
+		return false;
+	if (fit_image_get_load(fit, noffset, &load) ||
+	    (load_op == FIT_LOAD_OPTIONAL_NON_ZERO && !load))
+		return false;
+	if (fit_image_get_data_and_size(fit, noffset, (const void **)&buf,
+					&size) || map_to_sysmem(buf) == load)
+		return false;
+#ifndef USE_HOSTCC
+	if (!CONFIG_IS_ENABLED(LMB) ||
+	    lmb_get_free_size(images_lmb(images), load) < size)
+		return false;
+#endif
+
+	/* Kernel images get decompressed later in bootm_load_os() */
+	return fit_image_get_comp(fit, noffset, &comp) ||
+		comp == IH_COMP_NONE ||
+		image_type == IH_TYPE_KERNEL ||
+		image_type == IH_TYPE_KERNEL_NOLOAD ||
+		image_type == IH_TYPE_RAMDISK;
+}
+
 int fit_image_load(struct bootm_headers *images, ulong addr,
 		   const char **fit_unamep, const char **fit_uname_configp,
 		   int arch, int ph_type, int bootstage_id,
@@ -2066,6 +2295,7 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 	void *loadbuf;
 	size_t size;
 	int type_ok, os_ok;
+	bool copy_verify;
 	ulong load, load_end, data, len;
 	uint8_t os, comp;
 	const char *prop_name;
@@ -2142,7 +2372,14 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	/*
+	 * If the data is just copied to its load address, check its hashes
+	 * while copying it rather than making a separate pass over it
+	 */
+	copy_verify = images->verify &&
+		fit_image_copies_data(images, fit, noffset, image_type,
+				      load_op);
+	ret = fit_image_select(fit, noffset, images->verify && !copy_verify);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
@@ -2283,7 +2520,18 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 		len = load_end - load;
 	} else if (load != data) {
 		loadbuf = map_sysmem(load, len);
-		memcpy(loadbuf, buf, len);
+		if (copy_verify) {
+			puts("   Verifying Hash Integrity ... ");
+			if (!fit_image_verify_copy(fit, noffset, loadbuf)) {
+				puts("Bad Data Hash\n");
+				bootstage_error(bootstage_id +
+						BOOTSTAGE_SUB_HASH);
+				return -EACCES;
+			}
+			puts("OK\n");
+		} else {
+			memcpy(loadbuf, buf, len);
+		}
 	}
 
 	if (image_type == IH_TYPE_RAMDISK && comp != IH_COMP_NONE)
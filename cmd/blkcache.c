@@ -9,6 +9,7 @@
 #include <common.h>
 #include <malloc.h>
 #include <part.h>
+#include <linux/sizes.h>
 
 static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 		     int argc, char *const argv[])
@@ -18,26 +19,30 @@ static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "read-aheads: %u\n"
+	       "read-ahead blocks: %u\n"
 	       "entries: %u\n"
-	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "cache size: %lu KiB\n"
+	       "max read-ahead: %lu KiB\n",
+	       stats.hits, stats.misses, stats.readaheads,
+	       stats.readahead_blocks, stats.entries, stats.max_entries,
+	       stats.size / SZ_1K, stats.max_readahead / SZ_1K);
 	return 0;
 }
 
 static int blkc_configure(struct cmd_tbl *cmdtp, int flag,
 			  int argc, char *const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
+	ulong size_mb, readahead_kb;
 	if (argc != 3)
 		return CMD_RET_USAGE;
 
-	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
-	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	size_mb = simple_strtoul(argv[1], 0, 0);
+	readahead_kb = simple_strtoul(argv[2], 0, 0);
+	blkcache_configure(size_mb * SZ_1M, readahead_kb * SZ_1K);
+	printf("changed to %lu MiB with up to %lu KiB read-ahead\n",
+	       size_mb, readahead_kb);
 	return 0;
 }
 
@@ -70,6 +75,6 @@ U_BOOT_CMD(
 	blkcache, 4, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"blkcache configure <size_mib> <readahead_kib> "
+	"- set cache size and max read-ahead\n"
 );
@@ -11,8 +11,15 @@
 
 #include <common.h>
 #include <command.h>
+#include <console.h>
+#include <dm.h>
 #include <hash.h>
+#include <malloc.h>
+#include <time.h>
+#include <u-boot/hash.h>
 #include <linux/ctype.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 #if IS_ENABLED(CONFIG_HASH_VERIFY)
 #define HARGS 6
@@ -20,13 +27,303 @@
 #define HARGS 5
 #endif
 
+#if IS_ENABLED(CONFIG_CMD_HASH_BENCH)
+#define HASH_MAXARGS	10
+#else
+#define HASH_MAXARGS	HARGS
+#endif
+
+/* Defaults for 'hash bench' */
+#define HASH_BENCH_SIZE		SZ_1M
+#define HASH_BENCH_TIME_MS	200
+
+enum hash_bench_impl {
+	HASH_BENCH_ONESHOT,	/* hash_func_ws() */
+	HASH_BENCH_PROG,	/* hash_init(), hash_update(), hash_finish() */
+	HASH_BENCH_DEV,		/* a UCLASS_HASH device */
+};
+
+/**
+ * struct hash_bench - State of the 'hash bench' command
+ *
+ * @buf: Data to hash
+ * @size: Number of bytes of @buf to hash for the throughput
+ * @chunk: Chunk size to use, or 0 to use the chunk size of each algorithm
+ * @min_us: Minimum time to spend on each measurement
+ * @min_rate: Minimum acceptable throughput in MB/s, or 0 for none
+ * @slow: Number of implementations found to be slower than @min_rate
+ * @digest: Digest produced by the last call
+ */
+struct hash_bench {
+	u8 *buf;
+	uint size;
+	uint chunk;
+	ulong min_us;
+	uint min_rate;
+	int slow;
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+};
+
+/* Hash the first @size bytes of the buffer once */
+static int hash_bench_one(struct hash_bench *hb, enum hash_bench_impl impl,
+			  struct hash_algo *algo, struct udevice *dev,
+			  enum HASH_ALGO dev_algo, uint size, uint chunk)
+{
+	u8 *out = hb->digest;
+	uint ofs, len;
+	void *ctx;
+	int ret;
+
+	switch (impl) {
+	case HASH_BENCH_ONESHOT:
+		algo->hash_func_ws(hb->buf, size, out, chunk);
+		return 0;
+	case HASH_BENCH_PROG:
+		ret = algo->hash_init(algo, &ctx);
+		if (ret)
+			return ret;
+		for (ofs = 0; ofs < size; ofs += len) {
+			len = min(chunk, size - ofs);
+			ret = algo->hash_update(algo, ctx, hb->buf + ofs, len,
+						ofs + len == size);
+			if (ret)
+				goto err;
+		}
+		ret = algo->hash_finish(algo, ctx, out, sizeof(hb->digest));
+		if (ret)
+			goto err;
+		return 0;
+	case HASH_BENCH_DEV:
+		return hash_digest_wd(dev, dev_algo, hb->buf, size, out, chunk);
+	}
+
+	return -EINVAL;
+err:
+	/* hash_finish() only frees the context when it succeeds */
+	free(ctx);
+	return ret;
+}
+
+/*
+ * Check that the last call hashed the whole buffer to the same digest as the
+ * one-shot software implementation of @name, if there is one
+ */
+static int hash_bench_check(struct hash_bench *hb, const char *name)
+{
+	u8 ref[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+
+	if (hash_lookup_algo(name, &algo))
+		return 0;
+	algo->hash_func_ws(hb->buf, hb->size, ref, algo->chunk_size);
+	if (memcmp(ref, hb->digest, algo->digest_size)) {
+		printf("%s: wrong digest\n", name);
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+/*
+ * Hash @size bytes over and over for at least hb->min_us. The timer is only
+ * read after each batch of calls, which doubles in length each time, so that
+ * it does not distort the timing of small inputs.
+ */
+static int hash_bench_time(struct hash_bench *hb, enum hash_bench_impl impl,
+			   struct hash_algo *algo, struct udevice *dev,
+			   enum HASH_ALGO dev_algo, uint size, uint chunk,
+			   ulong *callsp, ulong *usp)
+{
+	ulong start, calls, batch, i;
+	int ret;
+
+	start = timer_get_us();
+	calls = 0;
+	batch = 1;
+	do {
+		for (i = 0; i < batch; i++) {
+			ret = hash_bench_one(hb, impl, algo, dev, dev_algo,
+					     size, chunk);
+			if (ret)
+				return ret;
+		}
+		calls += batch;
+		batch *= 2;
+		*usp = timer_get_us() - start;
+		schedule();
+	} while (*usp < hb->min_us);
+	*callsp = calls;
+
+	return 0;
+}
+
+/*
+ * Measure and show the throughput for the whole buffer and the cost of a
+ * call which hashes a single byte, which is mostly per-call overhead. The
+ * digest of the whole buffer is checked too.
+ */
+static int hash_bench_show(struct hash_bench *hb, enum hash_bench_impl impl,
+			   const char *name, const char *impl_name,
+			   struct hash_algo *algo, struct udevice *dev,
+			   enum HASH_ALGO dev_algo, uint chunk)
+{
+	ulong calls, us, ns;
+	u64 rate;
+	int ret;
+
+	ret = hash_bench_time(hb, impl, algo, dev, dev_algo, hb->size, chunk,
+			      &calls, &us);
+	if (!ret && impl != HASH_BENCH_ONESHOT)
+		ret = hash_bench_check(hb, name);
+	if (ret)
+		return ret;
+	/* bytes per microsecond is MB/s; keep one decimal place */
+	rate = div64_u64((u64)hb->size * calls * 10, max(us, 1UL));
+
+	ret = hash_bench_time(hb, impl, algo, dev, dev_algo, 1, chunk, &calls,
+			      &us);
+	if (ret)
+		return ret;
+	ns = div64_u64((u64)us * 1000, calls);
+
+	printf("%-12s %-12s %8u %8u %6llu.%llu %8lu%s\n", name, impl_name,
+	       hb->size, chunk, rate / 10, rate % 10, ns,
+	       rate < hb->min_rate * 10 ? "  slow" : "");
+	if (rate < hb->min_rate * 10)
+		hb->slow++;
+
+	return 0;
+}
+
+static int hash_bench_algo(struct hash_bench *hb, struct hash_algo *algo)
+{
+	uint chunk = hb->chunk ? hb->chunk : algo->chunk_size;
+	int ret;
+
+	ret = hash_bench_show(hb, HASH_BENCH_ONESHOT, algo->name, "oneshot",
+			      algo, NULL, 0, chunk);
+	if (!ret && algo->hash_init)
+		ret = hash_bench_show(hb, HASH_BENCH_PROG, algo->name,
+				      "progressive", algo, NULL, 0, chunk);
+
+	return ret;
+}
+
+static int hash_bench_devs(struct hash_bench *hb, const char *algo_name)
+{
+	struct udevice *dev;
+	enum HASH_ALGO id;
+	const char *name;
+	uint chunk;
+	int ret;
+
+	uclass_foreach_dev_probe(UCLASS_HASH, dev) {
+		for (id = 0; id < HASH_ALGO_NUM; id++) {
+			name = hash_algo_name(id);
+			if (algo_name && strcmp(algo_name, name))
+				continue;
+			chunk = hb->chunk ? hb->chunk : SZ_64K;
+			ret = hash_bench_show(hb, HASH_BENCH_DEV, name,
+					      dev->name, NULL, dev, id, chunk);
+			/* not every device supports every algorithm */
+			if (ret == -EINVAL || ret == -ENOSYS ||
+			    ret == -EOPNOTSUPP)
+				continue;
+			if (ret)
+				return ret;
+			if (ctrlc())
+				return -EINTR;
+		}
+	}
+
+	return 0;
+}
+
+static int do_hash_bench(int argc, char *const argv[])
+{
+	struct hash_bench hb = {
+		.size = HASH_BENCH_SIZE,
+		.min_us = HASH_BENCH_TIME_MS * 1000,
+	};
+	const char *algo_name = NULL;
+	struct hash_algo *algo;
+	int ret = 0;
+	char *end;
+	int i;
+
+	for (; argc > 1 && *argv[0] == '-'; argc -= 2, argv += 2) {
+		switch (argv[0][1]) {
+		case 'a':
+			algo_name = argv[1];
+			break;
+		case 'm':
+			hb.min_rate = dectoul(argv[1], NULL);
+			break;
+		case 't':
+			hb.min_us = dectoul(argv[1], NULL) * 1000;
+			break;
+		default:
+			return CMD_RET_USAGE;
+		}
+	}
+	if (argc > 2 || (argc && *argv[0] == '-'))
+		return CMD_RET_USAGE;
+	if (argc > 0)
+		hb.size = ustrtoul(argv[0], &end, 0);
+	if (argc > 1)
+		hb.chunk = ustrtoul(argv[1], &end, 0);
+	if (!hb.size)
+		return CMD_RET_USAGE;
+	if (algo_name && hash_lookup_algo(algo_name, &algo) &&
+	    !IS_ENABLED(CONFIG_DM_HASH)) {
+		printf("Unknown hash algorithm '%s'\n", algo_name);
+		return CMD_RET_FAILURE;
+	}
+
+	hb.buf = malloc(hb.size);
+	if (!hb.buf) {
+		printf("Cannot allocate %u bytes\n", hb.size);
+		return CMD_RET_FAILURE;
+	}
+	for (i = 0; i < hb.size; i++)
+		hb.buf[i] = i * 7 + (i >> 8);
+
+	printf("%-12s %-12s %8s %8s %8s %8s\n", "Algorithm", "Impl", "Size",
+	       "Chunk", "MB/s", "Call ns");
+	for (i = 0; !ret && !hash_get_algo(i, &algo); i++) {
+		if (algo_name && strcmp(algo_name, algo->name))
+			continue;
+		ret = hash_bench_algo(&hb, algo);
+		if (!ret && ctrlc())
+			ret = -EINTR;
+	}
+	if (!ret && IS_ENABLED(CONFIG_DM_HASH))
+		ret = hash_bench_devs(&hb, algo_name);
+	free(hb.buf);
+
+	if (ret) {
+		printf("Benchmark failed (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+	if (hb.slow) {
+		printf("%d below %u MB/s\n", hb.slow, hb.min_rate);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
 static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 		   char *const argv[])
 {
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
-	if (argc < (HARGS - 1))
+	if (IS_ENABLED(CONFIG_CMD_HASH_BENCH) && argc > 1 &&
+	    !strcmp(argv[1], "bench"))
+		return do_hash_bench(argc - 2, argv + 2);
+
+	if (argc < (HARGS - 1) || argc > HARGS)
 		return CMD_RET_USAGE;
 
 #if IS_ENABLED(CONFIG_HASH_VERIFY)
@@ -45,7 +342,7 @@ static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 }
 
 U_BOOT_CMD(
-	hash,	HARGS,	1,	do_hash,
+	hash,	HASH_MAXARGS,	1,	do_hash,
 	"compute hash message digest",
 	"algorithm address count [[*]hash_dest]\n"
 		"    - compute message digest [save to env var / *address]"
@@ -54,4 +351,10 @@ U_BOOT_CMD(
 		"    - verify message digest of memory area to immediate value, \n"
 		"      env var or *address"
 #endif
+#if IS_ENABLED(CONFIG_CMD_HASH_BENCH)
+	"\nhash bench [-a algorithm] [-t ms] [-m MB/s] [size [chunk]]\n"
+		"    - measure the throughput of each algorithm over 'size'\n"
+		"      bytes, hashed 'chunk' bytes at a time, for at least 'ms'\n"
+		"      milliseconds; fail if any is slower than 'MB/s'"
+#endif
 );
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show the state of the malloc() heap
+ */
+
+#include <command.h>
+#include <display_options.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <linux/string.h>
+
+static int do_malloc_info(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	struct malloc_class_stats st;
+	struct malloc_info info;
+	int i;
+
+	malloc_get_info(&info);
+	printf("total bytes   = ");
+	print_size(info.total, "\n");
+	printf("peak bytes    = ");
+	print_size(info.peak, "\n");
+	printf("in use bytes  = ");
+	print_size(info.in_use, "\n");
+	printf("free bytes    = ");
+	print_size(info.free, "\n");
+	printf("free chunks   = %lu, largest ", info.free_chunks);
+	print_size(info.largest_free, "");
+	if (info.free)
+		printf(", %lu%% fragmented",
+		       (info.free - info.largest_free) * 100 / info.free);
+	printf("\n");
+
+	if (malloc_get_class_stats(0, &st))
+		return 0;
+	printf("cached bytes  = ");
+	print_size(info.cached, "\n");
+	printf("\n  Size     Allocs       Hits      Frees  Cached\n");
+	for (i = 0; !malloc_get_class_stats(i, &st); i++) {
+		if (!st.allocs && !st.frees)
+			continue;
+		printf("%6lu %10lu %10lu %10lu %7lu\n", st.size, st.allocs,
+		       st.hits, st.frees, st.cached);
+	}
+
+	return 0;
+}
+
+static int do_malloc_slab(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	if (!IS_ENABLED(CONFIG_SYS_MALLOC_SLAB)) {
+		printf("Small-object free lists are not enabled\n");
+		return CMD_RET_FAILURE;
+	}
+	if (argc < 2)
+		return CMD_RET_USAGE;
+	if (!strcmp(argv[1], "on"))
+		malloc_slab_enable(true);
+	else if (!strcmp(argv[1], "off"))
+		malloc_slab_enable(false);
+	else
+		return CMD_RET_USAGE;
+
+	return 0;
+}
+
+U_BOOT_LONGHELP(malloc,
+	"info - show heap usage and statistics for each small size class\n"
+	"malloc slab on|off - use or bypass the small-object free lists");
+
+U_BOOT_CMD_WITH_SUBCMDS(malloc, "malloc() heap information", malloc_help_text,
+	U_BOOT_SUBCMD_MKENT(info, 1, 1, do_malloc_info),
+	U_BOOT_SUBCMD_MKENT(slab, 2, 1, do_malloc_slab));
@@ -22,6 +22,7 @@
 #include <net/udp.h>
 #include <net/sntp.h>
 #include <net/ncsi.h>
+#include <net/wget.h>
 
 static int netboot_common(enum proto_t, struct cmd_tbl *, int, char * const []);
 
@@ -198,13 +199,51 @@ U_BOOT_CMD(
 #if defined(CONFIG_CMD_WGET)
 static int do_wget(struct cmd_tbl *cmdtp, int flag, int argc, char * const argv[])
 {
-	return netboot_common(WGET, cmdtp, argc, argv);
+	ulong addr;
+	int i, ret;
+
+	if (argc > 1 && !strcmp(argv[1], "-c")) {
+		wget_set_resume(true);
+		argc--;
+		argv++;
+	}
+
+	/* further files are given as address/path pairs */
+	if (argc > 3) {
+		if (argc % 2 == 0) {
+			ret = CMD_RET_USAGE;
+			goto out;
+		}
+		for (i = 3; i < argc; i += 2) {
+			if (strict_strtoul(argv[i], 16, &addr) < 0) {
+				printf("Invalid address\n");
+				ret = CMD_RET_USAGE;
+				goto out;
+			}
+			if (wget_add_file(addr, argv[i + 1])) {
+				printf("Too many files\n");
+				ret = CMD_RET_FAILURE;
+				goto out;
+			}
+		}
+		argc = 3;
+	}
+
+	ret = netboot_common(WGET, cmdtp, argc, argv);
+out:
+	wget_clear_files();
+
+	return ret;
 }
 
 U_BOOT_CMD(
-	wget,   3,      1,      do_wget,
+	wget,   CONFIG_SYS_MAXARGS,      1,      do_wget,
 	"boot image via network using HTTP protocol",
-	"[loadAddress] [[hostIPaddr:]path and image name]"
+	"[-c] [loadAddress] [[hostIPaddr:]path and image name]\n"
+	"    [loadAddress path]...\n"
+	"    - further files are fetched from the same server, over the\n"
+	"      same connection if possible\n"
+	"    -c: resume a partial download held at $fileaddr/$filesize"
 );
 #endif
 
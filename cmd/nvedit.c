@@ -922,7 +922,9 @@ static int do_env_indirect(struct cmd_tbl *cmdtp, int flag,
  */
 static int print_env_info(void)
 {
+	struct hsearch_stats stats;
 	const char *value;
+	uint avg;
 
 	/* print environment validity value */
 	switch (gd->env_valid) {
@@ -949,6 +951,17 @@ static int print_env_info(void)
 	value = gd->flags & GD_FLG_ENV_DEFAULT ? "true" : "false";
 	printf("env_use_default = %s\n", value);
 
+	/* print hash table statistics, probes in hundredths */
+	hstats_r(&env_htab, &stats);
+	avg = stats.filled ? stats.probes * 100 / stats.filled : 0;
+	printf("env_entries = %u\n", stats.filled);
+	printf("env_table_size = %u\n", stats.size);
+	printf("env_load_factor = %u%%\n",
+	       stats.size ? stats.filled * 100 / stats.size : 0);
+	printf("env_deleted = %u\n", stats.deleted);
+	printf("env_avg_probes = %u.%02u\n", avg / 100, avg % 100);
+	printf("env_max_probes = %u\n", stats.max_probes);
+
 	return CMD_RET_SUCCESS;
 }
 
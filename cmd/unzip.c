@@ -82,7 +82,7 @@ static int do_gzwrite(struct cmd_tbl *cmdtp, int flag,
 
 U_BOOT_CMD(
 	gzwrite, 8, 0, do_gzwrite,
-	"unzip and write memory to block device",
+	"unzip (gzip or zstd) and write memory to block device",
 	"<interface> <dev> <addr> length [wbuf=1M [offs=0 [outsize=0]]]\n"
 	"\twbuf is the size in bytes (hex) of write buffer\n"
 	"\t\tand should be padded to erase size for SSDs\n"
@@ -233,6 +233,8 @@ static int initr_dm(void)
 	/* Save the pre-reloc driver model and start a new one */
 	gd->dm_root_f = gd->dm_root;
 	gd->dm_root = NULL;
+	/* The compatible-string table may be in the pre-relocation heap */
+	gd_set_dm_compat_hash(NULL);
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
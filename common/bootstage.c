@@ -19,6 +19,8 @@
 #include <sort.h>
 #include <spl.h>
 #include <asm/global_data.h>
+#include <dm/device.h>
+#include <dm/root.h>
 #include <linux/compiler.h>
 #include <linux/libfdt.h>
 
@@ -263,6 +265,53 @@ static int h_compare_record(const void *r1, const void *r2)
 }
 
 #ifdef CONFIG_OF_LIBFDT
+#if CONFIG_IS_ENABLED(DM_PROBE_TIME)
+/**
+ * add_probe_times() - Add the probe time of devices to a device tree
+ *
+ * Each device with a probe time gets an 'accum' record named after it, with a
+ * 'parent' property so that the time can be attributed to part of the tree.
+ *
+ * @blob: Device tree blob
+ * @bootstage: Offset of the bootstage node
+ * @dev: Device to add, along with all devices below it
+ * @indexp: Number of the next record, updated by this function
+ * Return: 0 on success, -ENOSPC if the device tree is full, -EINVAL on other
+ *	error
+ */
+static int add_probe_times(void *blob, int bootstage, struct udevice *dev,
+			   int *indexp)
+{
+	struct udevice *child;
+	char buf[40];
+	int node;
+	int ret;
+
+	if (dev->probe_us) {
+		node = fdt_add_subnode(blob, bootstage, simple_itoa(*indexp));
+		if (node < 0)
+			return -ENOSPC;
+		(*indexp)++;
+
+		snprintf(buf, sizeof(buf), "probe %s", dev->name);
+		if (fdt_setprop_string(blob, node, "name", buf) ||
+		    fdt_setprop_cell(blob, node, "accum", dev->probe_us))
+			return -EINVAL;
+		if (dev->parent &&
+		    fdt_setprop_string(blob, node, "parent", dev->parent->name))
+			return -EINVAL;
+	}
+
+	device_foreach_child(child, dev) {
+		ret = add_probe_times(blob, bootstage, child, indexp);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+#endif
+
 /**
  * Add all bootstage timings to a device tree.
  *
@@ -299,9 +348,10 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 		if (rec->id != BOOTSTAGE_ID_AWAKE && rec->time_us == 0)
 			continue;
 
+		/* out of space, so there is no room for probe times either */
 		node = fdt_add_subnode(blob, bootstage, simple_itoa(i));
 		if (node < 0)
-			break;
+			return 0;
 
 		/* add properties to the node. */
 		if (fdt_setprop_string(blob, node, "name",
@@ -315,6 +365,16 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 			return -EINVAL;
 	}
 
+#if CONFIG_IS_ENABLED(DM_PROBE_TIME)
+	if (dm_root()) {
+		int ret;
+
+		ret = add_probe_times(blob, bootstage, dm_root(), &i);
+		if (ret == -EINVAL)
+			return ret;
+	}
+#endif
+
 	return 0;
 }
 
@@ -579,6 +579,10 @@ static mbinptr av_[NAV * 2 + 2] = {
 static void malloc_init(void);
 #endif
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+static void slab_reset(void);
+#endif
+
 ulong mem_malloc_start = 0;
 ulong mem_malloc_end = 0;
 ulong mem_malloc_brk = 0;
@@ -615,6 +619,9 @@ void mem_malloc_init(ulong start, ulong size)
 #ifdef CONFIG_SYS_MALLOC_DEFAULT_TO_INIT
 	malloc_init();
 #endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	slab_reset();
+#endif
 
 	debug("using memory %#lx-%#lx for malloc()\n", mem_malloc_start,
 	      mem_malloc_end);
@@ -1208,6 +1215,206 @@ static void malloc_extend_top(nb) INTERNAL_SIZE_T nb;
 
 
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/*
+ * Small-object front-end
+ *
+ * Freed chunks of up to SLAB_MAX_CHUNK bytes are kept on a free list for
+ * their size instead of going back to the bins, so that malloc() can hand
+ * them out again without coalescing, splitting or searching. An empty list is
+ * refilled by carving a batch of chunks out of one larger allocation, which
+ * also keeps objects of the same size next to each other.
+ *
+ * As far as the rest of dlmalloc is concerned, chunks on the lists are in
+ * use: each keeps a valid header, so realloc(), malloc_usable_size() and the
+ * debug checks work as usual, and any of them can be freed to the bins at any
+ * time. slab_flush() does that when the heap runs out.
+ */
+#define SLAB_MAX_REQUEST	256
+#define SLAB_MAX_CHUNK		request2size(SLAB_MAX_REQUEST)
+#define SLAB_FIRST		(MINSIZE / MALLOC_ALIGNMENT)
+#define SLAB_LISTS		(SLAB_MAX_CHUNK / MALLOC_ALIGNMENT + 1)
+#define SLAB_BATCH_BYTES	4096
+#define SLAB_BATCH_MIN		4
+
+#define slab_index(sz)		((sz) / MALLOC_ALIGNMENT)
+
+static struct {
+	mchunkptr list[SLAB_LISTS];
+	struct malloc_class_stats stats[SLAB_LISTS];
+	ulong cached;		/* bytes held on the lists */
+	bool disabled;
+} slab;
+
+static void slab_reset(void)
+{
+	bool disabled = slab.disabled;
+
+	memset(&slab, '\0', sizeof(slab));
+	slab.disabled = disabled;
+}
+
+/* Carve a new batch of @nb-byte chunks, returning one and caching the rest */
+static mchunkptr slab_refill(INTERNAL_SIZE_T nb)
+{
+	struct malloc_class_stats *st = &slab.stats[slab_index(nb)];
+	mchunkptr *list = &slab.list[slab_index(nb)];
+	INTERNAL_SIZE_T sz;
+	mchunkptr p, q;
+	Void_t *mem;
+	int count, i;
+
+	/* keep the count seen by malloc_enable_testing() exact */
+	if (CONFIG_IS_ENABLED(UNIT_TEST) && malloc_testing)
+		return NULL;
+
+	/* this is always larger than SLAB_MAX_CHUNK so does not come back here */
+	count = max_t(int, SLAB_BATCH_BYTES / nb, SLAB_BATCH_MIN);
+	mem = mALLOc(count * nb - SIZE_SZ);
+	if (!mem)
+		return NULL;
+	p = mem2chunk(mem);
+	sz = chunksize(p);
+
+	/* the first chunk keeps the PREV_INUSE bit of the batch */
+	set_head_size(p, nb);
+	for (i = count - 2; i >= 0; i--) {
+		q = chunk_at_offset(p, i * nb);
+		if (i)
+			set_head(q, nb | PREV_INUSE);
+		q->fd = *list;
+		*list = q;
+	}
+	st->cached += count - 1;
+	slab.cached += (count - 1) * nb;
+
+	/* the last one takes any slack and goes to the caller */
+	q = chunk_at_offset(p, (count - 1) * nb);
+	set_head(q, (sz - (count - 1) * nb) | PREV_INUSE);
+
+	return q;
+}
+
+/* Take a chunk of size @nb from the front-end, or NULL to use the bins */
+static mchunkptr slab_get(INTERNAL_SIZE_T nb)
+{
+	struct malloc_class_stats *st = &slab.stats[slab_index(nb)];
+	mchunkptr *list = &slab.list[slab_index(nb)];
+	mchunkptr p;
+
+	st->allocs++;
+	p = *list;
+	if (!p)
+		return slab_refill(nb);
+	*list = p->fd;
+	st->hits++;
+	st->cached--;
+	slab.cached -= nb;
+
+	return p;
+}
+
+/* Put chunk @p on its list, returning false if it should go to the bins */
+static bool slab_put(mchunkptr p)
+{
+	INTERNAL_SIZE_T sz = chunksize(p);
+	struct malloc_class_stats *st;
+
+	if (slab.disabled || sz > SLAB_MAX_CHUNK || chunk_is_mmapped(p))
+		return false;
+	st = &slab.stats[slab_index(sz)];
+	p->fd = slab.list[slab_index(sz)];
+	slab.list[slab_index(sz)] = p;
+	st->frees++;
+	st->cached++;
+	slab.cached += sz;
+
+	return true;
+}
+
+/* Give all cached chunks back to the bins, returning true if there were any */
+static bool slab_flush(void)
+{
+	bool disabled = slab.disabled;
+	bool found = false;
+	mchunkptr p;
+	int i;
+
+	slab.disabled = true;
+	for (i = SLAB_FIRST; i < SLAB_LISTS; i++) {
+		while ((p = slab.list[i])) {
+			slab.list[i] = p->fd;
+			fREe(chunk2mem(p));
+			found = true;
+		}
+		slab.stats[i].cached = 0;
+	}
+	slab.cached = 0;
+	slab.disabled = disabled;
+
+	return found;
+}
+
+void malloc_slab_enable(bool enable)
+{
+	slab_flush();
+	slab.disabled = !enable;
+}
+
+int malloc_get_class_stats(int index, struct malloc_class_stats *stats)
+{
+	if (index < 0 || index >= SLAB_LISTS - SLAB_FIRST)
+		return -ENOENT;
+	*stats = slab.stats[SLAB_FIRST + index];
+	stats->size = (SLAB_FIRST + index) * MALLOC_ALIGNMENT;
+
+	return 0;
+}
+#else
+#define slab_flush()		false
+
+void malloc_slab_enable(bool enable)
+{
+}
+
+int malloc_get_class_stats(int index, struct malloc_class_stats *stats)
+{
+	return -ENOENT;
+}
+#endif /* SYS_MALLOC_SLAB */
+
+void malloc_get_info(struct malloc_info *info)
+{
+	INTERNAL_SIZE_T sz;
+	mbinptr b;
+	mchunkptr p;
+	int i;
+
+	memset(info, '\0', sizeof(*info));
+	if (!mem_malloc_start)
+		return;
+
+	sz = chunksize(top);
+	info->free = sz;
+	info->largest_free = sz;
+	info->free_chunks = sz >= MINSIZE ? 1 : 0;
+	for (i = 1; i < NAV; i++) {
+		b = bin_at(i);
+		for (p = last(b); p != b; p = p->bk) {
+			sz = chunksize(p);
+			info->free += sz;
+			info->largest_free = max(info->largest_free, sz);
+			info->free_chunks++;
+		}
+	}
+	info->total = sbrked_mem;
+	info->peak = max_total_mem;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	info->cached = slab.cached;
+#endif
+	info->in_use = info->total - info->free - info->cached;
+}
+
 /* Main public routines */
 
 
@@ -1311,6 +1518,21 @@ Void_t* mALLOc(bytes) size_t bytes;
 
   nb = request2size(bytes);  /* padded request size; */
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  if (nb <= SLAB_MAX_CHUNK && !slab.disabled)
+  {
+    victim = slab_get(nb);
+    if (victim)
+    {
+      /* the chunk before it may have been freed in the meantime */
+      check_inuse_chunk(victim);
+      return chunk2mem(victim);
+    }
+  }
+
+retry:
+#endif
+
   /* Check for exact match in a bin */
 
   if (is_small_request(nb))  /* Faster version for small requests */
@@ -1517,7 +1739,14 @@ Void_t* mALLOc(bytes) size_t bytes;
     /* Try to extend */
     malloc_extend_top(nb);
     if ( (remainder_size = chunksize(top) - nb) < (long)MINSIZE)
+    {
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+      /* Cached small chunks may coalesce into something big enough */
+      if (slab_flush())
+	goto retry;
+#endif
       return NULL; /* propagate failure */
+    }
   }
 
   victim = top;
@@ -1586,6 +1815,12 @@ void fREe(mem) Void_t* mem;
   p = mem2chunk(mem);
   hd = p->size;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  check_inuse_chunk(p);
+  if (slab_put(p))
+    return;
+#endif
+
 #if HAVE_MMAP
   if (hd & IS_MMAPPED)                       /* release mmapped memory. */
   {
@@ -2355,6 +2590,11 @@ static void malloc_update_mallinfo(void)
     }
   }
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  /* Chunks cached by the small-object front-end are not in use */
+  avail += slab.cached;
+#endif
+
   current_mallinfo.ordblks = navail;
   current_mallinfo.uordblks = sbrked_mem - avail;
   current_mallinfo.fordblks = avail;
@@ -8,154 +8,399 @@
 #include <blk.h>
 #include <log.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <asm/global_data.h>
+#include <linux/bitops.h>
 #include <linux/ctype.h>
-#include <linux/list.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
 
-struct block_cache_node {
-	struct list_head lh;
+/*
+ * The cache is set-associative: each (device, line index) pair hashes to one
+ * set of BLKCACHE_WAYS lines and the least-recently-used line of that set is
+ * replaced on a miss. A line holds BLKCACHE_LINE_SIZE bytes worth of
+ * consecutive blocks, each of which may be present or not.
+ */
+#define BLKCACHE_LINE_SIZE	SZ_4K
+#define BLKCACHE_WAYS		8
+#define BLKCACHE_STREAMS	4
+#define BLKCACHE_RA_MIN		SZ_16K
+
+#ifdef CONFIG_SPL_BUILD
+#define BLKCACHE_DEFAULT_SIZE	SZ_128K
+#define BLKCACHE_DEFAULT_RA	0
+#else
+#define BLKCACHE_DEFAULT_SIZE	(CONFIG_BLOCK_CACHE_SIZE_MB * SZ_1M)
+#define BLKCACHE_DEFAULT_RA	(CONFIG_BLOCK_CACHE_READAHEAD_KB * SZ_1K)
+#endif
+
+/**
+ * struct block_cache_line - A line of the block cache
+ *
+ * @iftype: uclass_id of the device
+ * @devnum: device number
+ * @blksz: block size of the device
+ * @index: first block in the line divided by the number of blocks per line
+ * @valid: bitmap of the blocks present in the line, 0 if the line is free
+ * @stamp: value of the access clock when the line was last used
+ */
+struct block_cache_line {
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
 	unsigned long blksz;
-	char *cache;
+	lbaint_t index;
+	u32 valid;
+	u32 stamp;
+};
+
+/**
+ * struct block_cache_stream - A sequential reader seen by the cache
+ *
+ * @iftype: uclass_id of the device
+ * @devnum: device number
+ * @next: block at which the next sequential read starts
+ * @window: current read-ahead in blocks
+ * @stamp: value of the access clock when the stream was last used
+ */
+struct block_cache_stream {
+	int iftype;
+	int devnum;
+	lbaint_t next;
+	lbaint_t window;
+	u32 stamp;
 };
 
-static LIST_HEAD(block_cache);
+static struct {
+	struct block_cache_line *lines;
+	char *data;
+	char *rabuf;
+	uint sets;
+	u32 clock;
+	struct block_cache_stream streams[BLKCACHE_STREAMS];
+} cache;
+
+/*
+ * Set when the cache memory cannot be allocated, so that reads go uncached
+ * rather than trying again every time, until blkcache_configure() is called
+ */
+static bool cache_failed;
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.size = BLKCACHE_DEFAULT_SIZE,
+	.max_readahead = BLKCACHE_DEFAULT_RA,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
-{
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
-			return node;
-		}
+/* Return log2 of the number of blocks per line, or -1 if not cacheable */
+static int line_shift(unsigned long blksz)
+{
+	if (!blksz || !is_power_of_2(blksz) || blksz > BLKCACHE_LINE_SIZE ||
+	    BLKCACHE_LINE_SIZE / blksz > 32)
+		return -1;
+
+	return ilog2(BLKCACHE_LINE_SIZE / blksz);
+}
+
+static int cache_setup(void)
+{
+	uint lines;
+
+	if (cache.lines)
+		return 0;
+	if (cache_failed)
+		return -ENOMEM;
+
+	lines = _stats.size / BLKCACHE_LINE_SIZE / BLKCACHE_WAYS;
+	if (!lines)
+		return -ENOSPC;
+	cache.sets = rounddown_pow_of_two(lines);
+	lines = cache.sets * BLKCACHE_WAYS;
+
+	cache.lines = calloc(lines, sizeof(*cache.lines));
+	cache.data = malloc(lines * BLKCACHE_LINE_SIZE);
+	if (_stats.max_readahead)
+		cache.rabuf = malloc_cache_aligned(_stats.max_readahead);
+	if (!cache.lines || !cache.data ||
+	    (_stats.max_readahead && !cache.rabuf)) {
+		free(cache.lines);
+		free(cache.data);
+		free(cache.rabuf);
+		cache.lines = NULL;
+		cache.data = NULL;
+		cache.rabuf = NULL;
+		log_warning("Cannot allocate block cache; reads are uncached\n");
+		cache_failed = true;
+		return -ENOMEM;
+	}
+	_stats.max_entries = lines;
+	debug("setup: %u sets of %u lines\n", cache.sets, BLKCACHE_WAYS);
+
 	return 0;
 }
 
+static struct block_cache_line *cache_set(int iftype, int devnum,
+					  lbaint_t index)
+{
+	u32 hash;
+
+	hash = lower_32_bits(index) ^ upper_32_bits(index);
+	hash += ((u32)iftype << 16 | devnum) * 0x61c88647;
+
+	return &cache.lines[(hash & (cache.sets - 1)) * BLKCACHE_WAYS];
+}
+
+static char *line_data(struct block_cache_line *line)
+{
+	return cache.data + (line - cache.lines) * BLKCACHE_LINE_SIZE;
+}
+
+static struct block_cache_line *cache_find(int iftype, int devnum,
+					   unsigned long blksz, lbaint_t index)
+{
+	struct block_cache_line *line = cache_set(iftype, devnum, index);
+	int i;
+
+	for (i = 0; i < BLKCACHE_WAYS; i++, line++) {
+		if (line->valid && line->index == index &&
+		    line->devnum == devnum && line->iftype == iftype &&
+		    line->blksz == blksz)
+			return line;
+	}
+
+	return NULL;
+}
+
+/* Find a line to hold @index, evicting the least-recently-used one */
+static struct block_cache_line *cache_alloc(int iftype, int devnum,
+					    unsigned long blksz,
+					    lbaint_t index)
+{
+	struct block_cache_line *line, *lru;
+	int i;
+
+	line = cache_set(iftype, devnum, index);
+	lru = line;
+	for (i = 0; i < BLKCACHE_WAYS; i++, line++) {
+		if (!line->valid) {
+			lru = line;
+			break;
+		}
+		if ((s32)(line->stamp - lru->stamp) < 0)
+			lru = line;
+	}
+
+	if (lru->valid)
+		debug("drop: index " LBAF "\n", lru->index);
+	else
+		_stats.entries++;
+	lru->iftype = iftype;
+	lru->devnum = devnum;
+	lru->blksz = blksz;
+	lru->index = index;
+	lru->valid = 0;
+
+	return lru;
+}
+
+static struct block_cache_stream *stream_find(int iftype, int devnum,
+					      lbaint_t start)
+{
+	struct block_cache_stream *st;
+
+	for (st = cache.streams; st < cache.streams + BLKCACHE_STREAMS; st++) {
+		if (st->stamp && st->next == start && st->devnum == devnum &&
+		    st->iftype == iftype)
+			return st;
+	}
+
+	return NULL;
+}
+
+/* Start tracking a new stream in place of the least-recently-used one */
+static void stream_new(int iftype, int devnum, lbaint_t next)
+{
+	struct block_cache_stream *st, *lru = cache.streams;
+
+	for (st = cache.streams; st < cache.streams + BLKCACHE_STREAMS; st++) {
+		if ((s32)(st->stamp - lru->stamp) < 0)
+			lru = st;
+	}
+	lru->iftype = iftype;
+	lru->devnum = devnum;
+	lru->next = next;
+	lru->window = 0;
+	lru->stamp = ++cache.clock;
+}
+
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	struct block_cache_stream *st;
+	struct block_cache_line *line;
+	lbaint_t blk, end = start + blkcnt;
+	char *dst = buffer;
+	uint ofs, count;
+	int shift;
+	u32 mask;
+
+	shift = line_shift(blksz);
+	if (!cache.lines || shift < 0)
+		goto miss;
+
+	for (blk = start; blk < end; blk += count) {
+		ofs = blk & ((1 << shift) - 1);
+		count = min_t(lbaint_t, (1 << shift) - ofs, end - blk);
+		mask = GENMASK(ofs + count - 1, ofs);
+		line = cache_find(iftype, devnum, blksz, blk >> shift);
+		if (!line || (line->valid & mask) != mask)
+			goto miss;
+		memcpy(dst, line_data(line) + ofs * blksz, count * blksz);
+		line->stamp = ++cache.clock;
+		dst += count * blksz;
 	}
 
+	/* keep following a sequential reader while it hits read-ahead data */
+	st = stream_find(iftype, devnum, start);
+	if (st) {
+		st->next = end;
+		st->stamp = ++cache.clock;
+	}
+
+	debug("hit: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+	++_stats.hits;
+	return 1;
+
+miss:
 	debug("miss: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 	++_stats.misses;
 	return 0;
 }
 
+lbaint_t blkcache_readahead(int iftype, int devnum,
+			    lbaint_t start, lbaint_t blkcnt,
+			    unsigned long blksz, lbaint_t lba, void **bufp)
+{
+	struct block_cache_stream *st;
+	lbaint_t max, ra;
+
+	/* read-ahead data has nowhere to go without the cache */
+	if (!_stats.max_readahead || cache_setup())
+		return 0;
+
+	st = stream_find(iftype, devnum, start);
+	if (!st) {
+		stream_new(iftype, devnum, start + blkcnt);
+		return 0;
+	}
+	st->next = start + blkcnt;
+	st->stamp = ++cache.clock;
+
+	max = _stats.max_readahead / blksz;
+	if (line_shift(blksz) < 0 || blkcnt >= max || start + blkcnt >= lba)
+		return 0;
+
+	/* grow the window while the reader stays sequential */
+	if (st->window)
+		st->window = min(st->window * 2, max);
+	else
+		st->window = min_t(lbaint_t, BLKCACHE_RA_MIN / blksz, max);
+
+	*bufp = cache.rabuf;
+
+	ra = min(st->window, max - blkcnt);
+	ra = min(ra, lba - start - blkcnt);
+	_stats.readaheads++;
+	_stats.readahead_blocks += ra;
+
+	return ra;
+}
+
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	struct block_cache_line *line;
+	lbaint_t blk, end = start + blkcnt;
+	const char *src = buffer;
+	uint ofs, count;
+	int shift;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	/* don't let big reads flush out everything else */
+	shift = line_shift(blksz);
+	if (shift < 0 || blkcnt * blksz > _stats.size / 4)
 		return;
 
-	if (_stats.max_entries == 0)
+	if (cache_setup())
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
-
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
-	}
-
 	debug("fill: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	for (blk = start; blk < end; blk += count) {
+		ofs = blk & ((1 << shift) - 1);
+		count = min_t(lbaint_t, (1 << shift) - ofs, end - blk);
+		line = cache_find(iftype, devnum, blksz, blk >> shift);
+		if (!line)
+			line = cache_alloc(iftype, devnum, blksz, blk >> shift);
+		memcpy(line_data(line) + ofs * blksz, src, count * blksz);
+		line->valid |= GENMASK(ofs + count - 1, ofs);
+		line->stamp = ++cache.clock;
+		src += count * blksz;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_line *line;
+	uint i;
+
+	if (!cache.lines)
+		return;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if (iftype == -1 ||
-		    (node->iftype == iftype && node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
+	for (i = 0, line = cache.lines; i < _stats.max_entries; i++, line++) {
+		if (line->valid && (iftype == -1 ||
+		    (line->iftype == iftype && line->devnum == devnum))) {
+			line->valid = 0;
 			--_stats.entries;
 		}
 	}
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_remove(int iftype, int devnum)
 {
-	/* invalidate cache if there is a change */
-	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries))
-		blkcache_invalidate(-1, 0);
+	struct block_cache_stream *st;
+
+	for (st = cache.streams; st < cache.streams + BLKCACHE_STREAMS; st++) {
+		if (st->iftype == iftype && st->devnum == devnum)
+			st->stamp = 0;
+	}
+	blkcache_invalidate(iftype, devnum);
+
+	/* give the memory back once no device has anything cached */
+	if (!_stats.entries)
+		blkcache_free();
+}
+
+void blkcache_configure(ulong size, ulong readahead)
+{
+	ulong max_readahead = min(readahead, size / 4);
+
+	/* drop the cache if it is resized */
+	if (size != _stats.size || max_readahead != _stats.max_readahead)
+		blkcache_free();
 
-	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+	_stats.size = size;
+	_stats.max_readahead = max_readahead;
+	cache_failed = false;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
+	_stats.readahead_blocks = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -163,9 +408,16 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
+	_stats.readahead_blocks = 0;
 }
 
 void blkcache_free(void)
 {
-	blkcache_invalidate(-1, 0);
+	free(cache.lines);
+	free(cache.data);
+	free(cache.rabuf);
+	memset(&cache, '\0', sizeof(cache));
+	_stats.entries = 0;
+	_stats.max_entries = 0;
 }
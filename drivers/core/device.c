@@ -33,6 +33,7 @@
 #include <linux/err.h>
 #include <linux/list.h>
 #include <power-domain.h>
+#include <time.h>
 #include <linux/printk.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -495,9 +496,65 @@ static int device_get_dma_constraints(struct udevice *dev)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(DM_PROBE_TIME)
+/* Total time recorded against all devices, used to leave out nested probes */
+static ulong probe_time_total;
+
+/**
+ * probe_time_start() - Start timing the probe of a device
+ *
+ * Devices are only timed after relocation, once the timer can be read without
+ * probing anything.
+ *
+ * @nestedp: Returns the total time recorded so far
+ * Return: current time in microseconds, or 0 if the device is not timed
+ */
+static ulong probe_time_start(ulong *nestedp)
+{
+	if (!(gd->flags & GD_FLG_RELOC))
+		return 0;
+	if (CONFIG_IS_ENABLED(TIMER) && !gd->timer &&
+	    !IS_ENABLED(CONFIG_TIMER_EARLY))
+		return 0;
+	*nestedp = probe_time_total;
+
+	return timer_get_us() ? : 1;
+}
+
+/**
+ * probe_time_end() - Record the time taken to probe a device
+ *
+ * @dev: Device which was probed
+ * @start: Value returned by probe_time_start()
+ * @nested: Total time recorded when the probe started
+ */
+static void probe_time_end(struct udevice *dev, ulong start, ulong nested)
+{
+	ulong us;
+
+	if (!start)
+		return;
+
+	/* anything probed in the meantime has already been counted */
+	us = timer_get_us() - start - (probe_time_total - nested);
+	dev->probe_us = us;
+	probe_time_total += us;
+}
+#else
+static ulong probe_time_start(ulong *nestedp)
+{
+	return 0;
+}
+
+static void probe_time_end(struct udevice *dev, ulong start, ulong nested)
+{
+}
+#endif
+
 int device_probe(struct udevice *dev)
 {
 	const struct driver *drv;
+	ulong start, nested = 0;
 	int ret;
 
 	printf("device_probe - START\n");
@@ -509,6 +566,8 @@ int device_probe(struct udevice *dev)
 	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
 		return 0;
 
+	start = probe_time_start(&nested);
+
 	printf("device_notify - START\n");
 	ret = device_notify(dev, EVT_DM_PRE_PROBE);
 	if (ret)
@@ -635,6 +694,8 @@ int device_probe(struct udevice *dev)
 	if (ret)
 		goto fail_event;
 
+	probe_time_end(dev, start, nested);
+
 	return 0;
 fail_event:
 fail_uclass:
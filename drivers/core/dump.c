@@ -357,3 +357,81 @@ void dm_dump_mem(struct dm_stats *stats)
 	printf("Drop device name (not SRAM): %x (%d)\n", stats->dev_name_size,
 	       stats->dev_name_size);
 }
+
+#if CONFIG_IS_ENABLED(DM_PROBE_TIME)
+/**
+ * struct probe_time_info - probe time of a device and the devices below it
+ *
+ * @dev: Device
+ * @total: Probe time of @dev plus that of all its descendants, in us
+ */
+struct probe_time_info {
+	struct udevice *dev;
+	ulong total;
+};
+
+static int h_cmp_probe_time(const void *p1, const void *p2)
+{
+	const struct probe_time_info *info1 = p1, *info2 = p2;
+
+	if (info1->dev->probe_us != info2->dev->probe_us)
+		return info1->dev->probe_us < info2->dev->probe_us ? 1 : -1;
+
+	if (info1->total != info2->total)
+		return info1->total < info2->total ? 1 : -1;
+
+	return 0;
+}
+
+/* Add each timed device to @info, returning the total time below @dev */
+static ulong collect_probe_times(struct udevice *dev,
+				 struct probe_time_info *info, int *countp)
+{
+	struct probe_time_info *entry = NULL;
+	struct udevice *child;
+	ulong total;
+
+	if (dev->probe_us) {
+		entry = &info[(*countp)++];
+		entry->dev = dev;
+	}
+
+	total = dev->probe_us;
+	device_foreach_child(child, dev)
+		total += collect_probe_times(child, info, countp);
+	if (entry)
+		entry->total = total;
+
+	return total;
+}
+
+void dm_dump_probe_time(void)
+{
+	struct probe_time_info *info;
+	int dev_count, uclasses;
+	int count, i;
+	ulong total;
+
+	dm_get_stats(&dev_count, &uclasses);
+	info = calloc(dev_count, sizeof(*info));
+	if (!info) {
+		printf("(out of memory)\n");
+		return;
+	}
+
+	count = 0;
+	total = collect_probe_times(dm_root(), info, &count);
+	qsort(info, count, sizeof(*info), h_cmp_probe_time);
+
+	puts("Device               Uclass        Self (us) Total (us)\n");
+	puts("-------------------------------------------------------\n");
+	for (i = 0; i < count; i++) {
+		struct udevice *dev = info[i].dev;
+
+		printf("%-20.20s %-12.12s %10lu %10lu\n", dev->name,
+		       dev->uclass->uc_drv->name, dev->probe_us, info[i].total);
+	}
+	printf("%d devices, %lu us\n", count, total);
+	free(info);
+}
+#endif
@@ -11,6 +11,8 @@
 #include <common.h>
 #include <errno.h>
 #include <log.h>
+#include <malloc.h>
+#include <asm/global_data.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -19,6 +21,10 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <linux/err.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -181,11 +187,157 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   struct driver *drv, bool pre_reloc_only)
+#define COMPAT_SLOT_EMPTY	0xffff
+
+/**
+ * struct lists_compat_slot - Slot in the compatible-string hash table
+ *
+ * Indexes are used rather than pointers to keep the table small, since it may
+ * be built in the early malloc() area
+ *
+ * @drv: Index of the driver in the driver linker list, or COMPAT_SLOT_EMPTY
+ * @id: Index of the compatible string in the driver's of_match table
+ */
+struct lists_compat_slot {
+	u16 drv;
+	u16 id;
+};
+
+/**
+ * struct lists_compat_hash - Hash table of the drivers' compatible strings
+ *
+ * This uses open addressing with linear probing. It is never more than half
+ * full, so a lookup always finds an empty slot if the string is not present.
+ *
+ * @mask: Number of slots minus one (the number of slots is a power of two)
+ * @slot: Slots in the table
+ */
+struct lists_compat_hash {
+	uint mask;
+	struct lists_compat_slot slot[];
+};
+
+/* FNV-1a hash of a compatible string */
+static uint compat_hash(const char *compat)
+{
+	uint hash = 2166136261U;
+
+	while (*compat)
+		hash = (hash ^ (u8)*compat++) * 16777619;
+
+	return hash;
+}
+
+static struct driver *compat_hash_find(struct lists_compat_hash *tab,
+				       const char *compat,
+				       const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	struct lists_compat_slot *slot;
+	const struct udevice_id *id;
+	uint i;
+
+	for (i = compat_hash(compat) & tab->mask;; i = (i + 1) & tab->mask) {
+		slot = &tab->slot[i];
+		if (slot->drv == COMPAT_SLOT_EMPTY)
+			return NULL;
+		id = &driver[slot->drv].of_match[slot->id];
+		if (!strcmp(id->compatible, compat)) {
+			*idp = id;
+			return &driver[slot->drv];
+		}
+	}
+}
+
+/**
+ * compat_hash_build() - Build the compatible-string hash table
+ *
+ * Where more than one driver has the same compatible string, the first one in
+ * the linker list is used, as with a linear search.
+ *
+ * Return: new table, or ERR_PTR(-ENOMEM) if there is not enough memory
+ */
+static struct lists_compat_hash *compat_hash_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match, *id;
+	struct lists_compat_hash *tab;
+	uint count = 0, size, i;
+	struct driver *entry;
+	size_t bytes;
+
+	if (n_ents >= COMPAT_SLOT_EMPTY)
+		return ERR_PTR(-ENOMEM);
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match; of_match && of_match->compatible;
+		     of_match++)
+			count++;
+	}
+	size = roundup_pow_of_two(max(count * 2, 16U));
+	bytes = sizeof(*tab) + size * sizeof(struct lists_compat_slot);
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F)
+	/* Leave most of the early malloc() area for the devices themselves */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    bytes > (gd->malloc_limit - gd->malloc_ptr) / 4) {
+		log_debug("No space for compatible table (%zx bytes)\n", bytes);
+		return ERR_PTR(-ENOMEM);
+	}
+#endif
+	tab = malloc(bytes);
+	if (!tab)
+		return ERR_PTR(-ENOMEM);
+	tab->mask = size - 1;
+	memset(tab->slot, '\xff', size * sizeof(struct lists_compat_slot));
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match; of_match && of_match->compatible;
+		     of_match++) {
+			if (compat_hash_find(tab, of_match->compatible, &id))
+				continue;
+			i = compat_hash(of_match->compatible) & tab->mask;
+			while (tab->slot[i].drv != COMPAT_SLOT_EMPTY)
+				i = (i + 1) & tab->mask;
+			tab->slot[i].drv = entry - driver;
+			tab->slot[i].id = of_match - entry->of_match;
+		}
+	}
+	log_debug("Compatible table has %u strings in %u slots\n", count,
+		  size);
+
+	return tab;
+}
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+	if (CONFIG_IS_ENABLED(DM_COMPAT_HASH)) {
+		struct lists_compat_hash *tab = gd_dm_compat_hash();
+
+		if (!tab) {
+			tab = compat_hash_build();
+			gd_set_dm_compat_hash(tab);
+		}
+		if (!IS_ERR(tab))
+			return compat_hash_find(tab, compat, idp);
+	}
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   struct driver *drv, bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -223,20 +375,21 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 			  compat);
 
 		id = NULL;
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			if (drv) {
-				if (drv != entry)
+		if (drv) {
+			entry = drv;
+			if (entry->of_match) {
+				ret = driver_check_compatible(entry->of_match,
+							      &id, compat);
+				if (ret)
 					continue;
-				if (!entry->of_match)
-					break;
 			}
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
+		} else {
+			entry = lists_driver_lookup_compat(compat, &id);
+			if (!entry) {
+				ret = -ENOENT;
+				continue;
+			}
 		}
-		if (entry == driver + n_ents)
-			continue;
 
 		if (pre_reloc_only) {
 			if (!ofnode_pre_reloc(node) &&
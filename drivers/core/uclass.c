@@ -23,6 +23,144 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+#define UCLASS_HASH_BITS	6
+#define UCLASS_HASH_SIZE	(1 << UCLASS_HASH_BITS)
+
+/* Get the value of @key for @dev, returning false if it has none */
+static bool uclass_hash_val(struct udevice *dev, enum uclass_hash_key key,
+			    ulong *valp)
+{
+	switch (key) {
+	case UCLASS_HASH_OFNODE:
+		if (!ofnode_valid(dev_ofnode(dev)))
+			return false;
+		*valp = dev_ofnode(dev).of_offset;
+		return true;
+	case UCLASS_HASH_SEQ:
+		if (dev->seq_ == -1)
+			return false;
+		*valp = dev->seq_;
+		return true;
+	case UCLASS_HASH_PHANDLE:
+		if (!CONFIG_IS_ENABLED(OF_REAL) || !dev_has_ofnode(dev))
+			return false;
+		*valp = dev_read_phandle(dev);
+		return *valp != 0;
+	default:
+		return false;
+	}
+}
+
+static struct hlist_head *uclass_hash_head(struct uclass *uc,
+					   enum uclass_hash_key key, ulong val)
+{
+	u32 hash = lower_32_bits(val) ^ upper_32_bits(val);
+
+	hash = (hash * 0x61c88647) >> (32 - UCLASS_HASH_BITS);
+
+	return &uc->index_[key * UCLASS_HASH_SIZE + hash];
+}
+
+/* Add @dev to the end of each chain, so the first device bound is found */
+static void uclass_index_add(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+	struct hlist_node *node, *last;
+	struct hlist_head *head;
+	int key;
+	ulong val;
+
+	if (!uc->index_)
+		return;
+
+	for (key = 0; key < UCLASS_HASH_COUNT; key++) {
+		node = &dev->uclass_hash_[key];
+		INIT_HLIST_NODE(node);
+		if (!uclass_hash_val(dev, key, &val))
+			continue;
+
+		head = uclass_hash_head(uc, key, val);
+		if (hlist_empty(head)) {
+			hlist_add_head(node, head);
+			continue;
+		}
+		for (last = head->first; last->next; last = last->next)
+			;
+		hlist_add_after(last, node);
+	}
+}
+
+static void uclass_index_del(struct udevice *dev)
+{
+	int key;
+
+	if (!dev->uclass->index_)
+		return;
+
+	for (key = 0; key < UCLASS_HASH_COUNT; key++)
+		hlist_del_init(&dev->uclass_hash_[key]);
+}
+
+void uclass_rehash_device(struct udevice *dev)
+{
+	uclass_index_del(dev);
+	uclass_index_add(dev);
+}
+
+/*
+ * Find the first device in @uc with the value @val for @key. Returns 0 if
+ * found, -ENODEV if not or -ENOSYS if there is no index to search
+ */
+static int uclass_index_find(struct uclass *uc, enum uclass_hash_key key,
+			     ulong val, struct udevice **devp)
+{
+	struct hlist_node *node;
+	struct udevice *dev;
+	ulong cur;
+
+	if (!uc->index_)
+		return -ENOSYS;
+
+	hlist_for_each(node, uclass_hash_head(uc, key, val)) {
+		dev = container_of(node - key, struct udevice,
+				   uclass_hash_[0]);
+		if (uclass_hash_val(dev, key, &cur) && cur == val) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+
+/* There are few devices before relocation and little memory to spare */
+static void uclass_index_init(struct uclass *uc)
+{
+	if (gd->flags & GD_FLG_RELOC)
+		uc->index_ = calloc(UCLASS_HASH_COUNT * UCLASS_HASH_SIZE,
+				    sizeof(struct hlist_head));
+}
+
+static void uclass_index_free(struct uclass *uc)
+{
+	free(uc->index_);
+}
+#else
+static inline void uclass_index_add(struct udevice *dev) {}
+static inline void uclass_index_del(struct udevice *dev) {}
+
+static inline int uclass_index_find(struct uclass *uc,
+				    enum uclass_hash_key key, ulong val,
+				    struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+static inline void uclass_index_init(struct uclass *uc) {}
+static inline void uclass_index_free(struct uclass *uc) {}
+#endif
+
 struct uclass *uclass_find(enum uclass_id key)
 {
 	struct uclass *uc;
@@ -85,6 +223,7 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	uc->uc_drv = uc_drv;
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
+	uclass_index_init(uc);
 	list_add(&uc->sibling_node, DM_UCLASS_ROOT_NON_CONST);
 
 	if (uc_drv->init) {
@@ -102,6 +241,7 @@ fail:
 		uclass_set_priv(uc, NULL);
 	}
 	list_del(&uc->sibling_node);
+	uclass_index_free(uc);
 fail_mem:
 	free(uc);
 
@@ -137,6 +277,7 @@ int uclass_destroy(struct uclass *uc)
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto)
 		free(uclass_get_priv(uc));
+	uclass_index_free(uc);
 	free(uc);
 
 	return 0;
@@ -342,6 +483,10 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq, struct udevice **devp)
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find(uc, UCLASS_HASH_SEQ, seq, devp);
+	if (ret != -ENOSYS)
+		return ret;
+
 	uclass_foreach_dev(dev, uc) {
 		log_debug("   - %d '%s'\n", dev->seq_, dev->name);
 		if (dev->seq_ == seq) {
@@ -394,11 +539,16 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find(uc, UCLASS_HASH_OFNODE, node.of_offset, devp);
+	if (ret != -ENOSYS)
+		goto done;
+
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
 		if (ofnode_equal(dev_ofnode(dev), node)) {
 			*devp = dev;
+			ret = 0;
 			goto done;
 		}
 	}
@@ -423,6 +573,10 @@ static int uclass_find_device_by_phandle_id(enum uclass_id id,
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find(uc, UCLASS_HASH_PHANDLE, find_phandle, devp);
+	if (ret != -ENOSYS)
+		return ret;
+
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
@@ -694,6 +848,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_index_add(dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -708,6 +863,7 @@ int uclass_bind_device(struct udevice *dev)
 	return 0;
 err:
 	/* There is no need to undo the parent's post_bind call */
+	uclass_index_del(dev);
 	list_del(&dev->uclass_node);
 
 	return ret;
@@ -731,6 +887,7 @@ int uclass_pre_unbind_device(struct udevice *dev)
 
 int uclass_unbind_device(struct udevice *dev)
 {
+	uclass_index_del(dev);
 	list_del(&dev->uclass_node);
 
 	return 0;
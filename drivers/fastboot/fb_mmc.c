@@ -165,6 +165,38 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	if (fastboot_progress_callback)
+		fastboot_progress_callback("erasing");
+
+	return blk_derase(sparse->dev_desc, blk, blkcnt);
+}
+
+/**
+ * fb_mmc_erase_blks() - Get the number of blocks erased at a time
+ *
+ * Erasing is only used in place of writing zeroes, so this checks that the
+ * device reads back zeroes once erased. This is only known for eMMC.
+ *
+ * @dev_desc: Block device to check
+ * Return: erase granularity in blocks, or 0 if erasing does not give zeroes
+ */
+static lbaint_t fb_mmc_erase_blks(struct blk_desc *dev_desc)
+{
+	struct mmc *mmc = find_mmc_device(dev_desc->devnum);
+
+	if (!mmc || IS_SD(mmc) || !mmc->ext_csd ||
+	    mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT])
+		return 0;
+
+	/* trim works on single blocks, otherwise whole groups are erased */
+	return mmc->can_trim ? 1 : mmc->erase_grp_size;
+}
+
 static void write_raw_image(struct blk_desc *dev_desc,
 			    struct disk_partition *info, const char *part_name,
 			    void *buffer, u32 download_bytes, char *response)
@@ -621,6 +653,8 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		sparse.size = info.size;
 		sparse.write = fb_mmc_sparse_write;
 		sparse.reserve = fb_mmc_sparse_reserve;
+		sparse.erase_blks = fb_mmc_erase_blks(dev_desc);
+		sparse.erase = sparse.erase_blks ? fb_mmc_sparse_erase : NULL;
 		sparse.mssg = fastboot_fail;
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
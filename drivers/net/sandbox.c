@@ -347,14 +347,19 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	return priv->tx_handler(dev, packet, length);
 }
 
-static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
+static void sb_eth_skip_timeout(void)
 {
-	struct eth_sandbox_priv *priv = dev_get_priv(dev);
-
 	if (skip_timeout) {
 		timer_test_add_offset(11000UL);
 		skip_timeout = false;
 	}
+}
+
+static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	sb_eth_skip_timeout();
 
 	if (priv->recv_packets) {
 		int lcl_recv_packet_length = priv->recv_packet_length[0];
@@ -367,6 +372,44 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 	return 0;
 }
 
+static int sb_eth_recv_batch(struct udevice *dev, int flags,
+			     struct eth_rx_pkt *pkts, int count)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int i, num;
+
+	sb_eth_skip_timeout();
+
+	/*
+	 * Copy the whole batch out of the receive queue, so that the queue has
+	 * room for any replies generated while the batch is processed
+	 */
+	num = min(count, priv->recv_packets);
+	for (i = 0; i < num; i++) {
+		pkts[i].packet = priv->batch_buffer[i];
+		pkts[i].length = priv->recv_packet_length[i];
+		memcpy(pkts[i].packet, priv->recv_packet_buffer[i],
+		       pkts[i].length);
+	}
+	debug("eth_sandbox: received %d packets, %d waiting\n", num,
+	      priv->recv_packets - num);
+
+	priv->recv_packets -= num;
+	for (i = 0; i < PKTBUFSRX; i++) {
+		if (i < priv->recv_packets) {
+			priv->recv_packet_length[i] =
+				priv->recv_packet_length[i + num];
+			memcpy(priv->recv_packet_buffer[i],
+			       priv->recv_packet_buffer[i + num],
+			       priv->recv_packet_length[i]);
+		} else {
+			priv->recv_packet_length[i] = 0;
+		}
+	}
+
+	return num;
+}
+
 static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -407,6 +450,7 @@ static const struct eth_ops sb_eth_ops = {
 	.start			= sb_eth_start,
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
+	.recv_batch		= sb_eth_recv_batch,
 	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
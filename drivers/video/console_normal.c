@@ -89,10 +89,7 @@ static int console_putc_xy(struct udevice *dev, uint x_frac, uint y, char ch)
 	ret = fill_char_vertically(pfont, &line, vid_priv, fontdata, NORMAL_DIRECTION);
 	if (ret)
 		return ret;
-
-	ret = vidconsole_sync_copy(dev, start, line);
-	if (ret)
-		return ret;
+	video_damage(vid, x, linenum, fontdata->width, fontdata->height);
 
 	return VID_TO_POS(fontdata->width);
 }
@@ -10,6 +10,8 @@
 #include <malloc.h>
 #include <video.h>
 #include <video_console.h>
+#include <linux/list.h>
+#include <linux/sizes.h>
 
 /* Functions needed by stb_truetype.h */
 static int tt_floor(double val)
@@ -127,6 +129,58 @@ struct pos_info {
  */
 #define POS_HISTORY_SIZE	(CONFIG_SYS_CBSIZE * 11 / 10)
 
+/*
+ * Glyphs are rendered for this many horizontal sub-pixel positions, so that
+ * the cached image for a character can be reused wherever it is drawn
+ */
+#define TT_SUBPIXELS		4
+
+/**
+ * struct console_tt_glyph - A rendered character in the glyph cache
+ *
+ * @sibling:	Node in the cache's least-recently-used list
+ * @slot:	Place in the font cache which points to this glyph
+ * @data:	8-bit-per-pixel alpha map of the character, NULL if it is empty
+ * @width:	Width of @data in pixels
+ * @height:	Height of @data in pixels
+ * @xoff:	X offset of @data from the cursor position
+ * @yoff:	Y offset of @data from the baseline
+ */
+struct console_tt_glyph {
+	struct list_head sibling;
+	struct console_tt_glyph **slot;
+	u8 *data;
+	int width;
+	int height;
+	int xoff;
+	int yoff;
+};
+
+/**
+ * struct console_tt_char - Cached metrics for a character
+ *
+ * @valid:	true if this has been filled in
+ * @glyph:	Glyph index of the character in the font
+ * @advance:	Advance width of the character, in font units
+ */
+struct console_tt_char {
+	bool valid;
+	int glyph;
+	int advance;
+};
+
+/**
+ * struct console_tt_font_cache - Cached information for a font / size
+ *
+ * @chars:	Metrics for each character
+ * @glyphs:	Rendered glyph for each character and sub-pixel position, or
+ *		NULL if not cached
+ */
+struct console_tt_font_cache {
+	struct console_tt_char chars[256];
+	struct console_tt_glyph *glyphs[256][TT_SUBPIXELS];
+};
+
 /**
  * struct console_tt_metrics - Information about a font / size combination
  *
@@ -145,6 +199,8 @@ struct pos_info {
  * @scale:	Scale of the font. This is calculated from the pixel height
  *		of the font. It is used by the STB library to generate images
  *		of the correct size.
+ * @cache:	Character metrics and rendered glyphs for this font / size,
+ *		allocated when first needed. NULL if the glyph cache is disabled
  */
 struct console_tt_metrics {
 	const char *font_name;
@@ -153,6 +209,7 @@ struct console_tt_metrics {
 	stbtt_fontinfo font;
 	int baseline;
 	double scale;
+	struct console_tt_font_cache *cache;
 };
 
 /**
@@ -167,6 +224,8 @@ struct console_tt_metrics {
  *		last character. We record enough characters to go back to the
  *		start of the current command line.
  * @pos_ptr:	Current position in the position history
+ * @glyph_lru:	Glyphs in the glyph cache, most recently used first
+ * @cache:	Glyph cache statistics and limits
  */
 struct console_tt_priv {
 	struct console_tt_metrics *cur_met;
@@ -174,6 +233,8 @@ struct console_tt_priv {
 	int num_metrics;
 	struct pos_info pos[POS_HISTORY_SIZE];
 	int pos_ptr;
+	struct list_head glyph_lru;
+	struct console_tt_cache_stats cache;
 };
 
 /**
@@ -187,6 +248,189 @@ struct console_tt_store {
 	struct pos_info cur;
 };
 
+/**
+ * tt_font_cache() - Get the cache for a font / size
+ *
+ * The cache is allocated if needed. Its size is counted as part of the glyph
+ * cache, so it is not allocated if the glyph cache is too small to hold it.
+ *
+ * @priv:	Private data
+ * @met:	Font / size to use
+ * Return: cache, or NULL if the glyph cache is disabled, too small or out of
+ * memory
+ */
+static struct console_tt_font_cache *tt_font_cache(struct console_tt_priv *priv,
+						   struct console_tt_metrics *met)
+{
+	if (met->cache)
+		return met->cache;
+	if (priv->cache.used + sizeof(*met->cache) > priv->cache.size)
+		return NULL;
+
+	met->cache = calloc(1, sizeof(*met->cache));
+	if (met->cache)
+		priv->cache.used += sizeof(*met->cache);
+
+	return met->cache;
+}
+
+/**
+ * tt_char_metrics() - Get the glyph index and advance width of a character
+ *
+ * @priv:	Private data
+ * @met:	Font / size to use
+ * @ch:		Character to look up
+ * @advancep:	Returns the advance width of the character in font units, if
+ *		not NULL
+ * Return: glyph index of the character
+ */
+static int tt_char_metrics(struct console_tt_priv *priv,
+			   struct console_tt_metrics *met, int ch, int *advancep)
+{
+	struct console_tt_font_cache *cache = tt_font_cache(priv, met);
+	struct console_tt_char *tch = NULL;
+	int glyph, advance;
+
+	if (cache) {
+		tch = &cache->chars[(u8)ch];
+		if (tch->valid) {
+			if (advancep)
+				*advancep = tch->advance;
+			return tch->glyph;
+		}
+	}
+
+	glyph = stbtt_FindGlyphIndex(&met->font, ch);
+	stbtt_GetGlyphHMetrics(&met->font, glyph, &advance, NULL);
+	if (tch) {
+		tch->valid = true;
+		tch->glyph = glyph;
+		tch->advance = advance;
+	}
+	if (advancep)
+		*advancep = advance;
+
+	return glyph;
+}
+
+static void tt_free_glyph(struct console_tt_priv *priv,
+			  struct console_tt_glyph *glyph)
+{
+	priv->cache.used -= sizeof(*glyph) + glyph->width * glyph->height;
+	priv->cache.glyphs--;
+	*glyph->slot = NULL;
+	list_del(&glyph->sibling);
+	free(glyph->data);
+	free(glyph);
+}
+
+/* Drop least-recently-used glyphs until the cache has @size bytes free */
+static void tt_cache_trim(struct console_tt_priv *priv, uint size)
+{
+	while (!list_empty(&priv->glyph_lru) &&
+	       priv->cache.used + size > priv->cache.size)
+		tt_free_glyph(priv, list_last_entry(&priv->glyph_lru,
+						    struct console_tt_glyph,
+						    sibling));
+}
+
+/**
+ * tt_get_glyph() - Get a rendered character from the glyph cache
+ *
+ * The character is rendered and added to the cache if it is not there. Its
+ * sub-pixel offset is rounded down to one of TT_SUBPIXELS positions.
+ *
+ * @priv:	Private data
+ * @met:	Font / size to use
+ * @ch:		Character to render
+ * @glyph_idx:	Glyph index of @ch
+ * @x_shift:	Sub-pixel offset of the character, from 0 to 1
+ * Return: glyph, or NULL if the cache is disabled or out of memory
+ */
+static struct console_tt_glyph *tt_get_glyph(struct console_tt_priv *priv,
+					     struct console_tt_metrics *met,
+					     int ch, int glyph_idx,
+					     double x_shift)
+{
+	struct console_tt_font_cache *cache = tt_font_cache(priv, met);
+	struct console_tt_glyph *glyph, **slot;
+	int sub;
+	uint size;
+
+	if (!cache)
+		return NULL;
+
+	sub = min((int)(x_shift * TT_SUBPIXELS), TT_SUBPIXELS - 1);
+	slot = &cache->glyphs[(u8)ch][sub];
+	glyph = *slot;
+	if (glyph) {
+		priv->cache.hits++;
+		list_move(&glyph->sibling, &priv->glyph_lru);
+		return glyph;
+	}
+	priv->cache.misses++;
+
+	glyph = malloc(sizeof(*glyph));
+	if (!glyph)
+		return NULL;
+	glyph->data = stbtt_GetGlyphBitmapSubpixel(&met->font, met->scale,
+						   met->scale,
+						   (double)sub / TT_SUBPIXELS,
+						   0, glyph_idx, &glyph->width,
+						   &glyph->height, &glyph->xoff,
+						   &glyph->yoff);
+	if (!glyph->data) {
+		glyph->width = 0;
+		glyph->height = 0;
+	}
+
+	size = sizeof(*glyph) + glyph->width * glyph->height;
+	tt_cache_trim(priv, size);
+	if (priv->cache.used + size > priv->cache.size) {
+		free(glyph->data);
+		free(glyph);
+		return NULL;
+	}
+
+	glyph->slot = slot;
+	*slot = glyph;
+	list_add(&glyph->sibling, &priv->glyph_lru);
+	priv->cache.used += size;
+	priv->cache.glyphs++;
+
+	return glyph;
+}
+
+void console_truetype_set_cache_size(struct udevice *dev, uint size)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+	struct console_tt_metrics *met;
+	int i;
+
+	priv->cache.size = size;
+	tt_cache_trim(priv, 0);
+	if (priv->cache.used <= size)
+		return;
+
+	/* The per-font tables alone are too large, so drop them all */
+	for (i = 0; i < priv->num_metrics; i++) {
+		met = &priv->metrics[i];
+		if (met->cache) {
+			priv->cache.used -= sizeof(*met->cache);
+			free(met->cache);
+			met->cache = NULL;
+		}
+	}
+}
+
+void console_truetype_get_cache_stats(struct udevice *dev,
+				      struct console_tt_cache_stats *stats)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+
+	*stats = priv->cache;
+}
+
 static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
 {
 	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
@@ -270,18 +514,18 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	struct console_tt_priv *priv = dev_get_priv(dev);
 	struct console_tt_metrics *met = priv->cur_met;
 	stbtt_fontinfo *font = &met->font;
+	struct console_tt_glyph *glyph;
 	int width, height, xoff, yoff;
 	double xpos, x_shift;
-	int lsb;
 	int width_frac, linenum;
 	struct pos_info *pos;
 	u8 *bits, *data;
-	int advance;
+	int advance, last, idx;
 	void *start, *end, *line;
-	int row, ret;
+	int row;
 
 	/* First get some basic metrics about this character */
-	stbtt_GetCodepointHMetrics(font, ch, &advance, &lsb);
+	idx = tt_char_metrics(priv, met, ch, &advance);
 
 	/*
 	 * First out our current X position in fractional pixels. If we wrote
@@ -289,8 +533,8 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	 * this character */
 	xpos = frac(VID_TO_PIXEL((double)x));
 	if (vc_priv->last_ch) {
-		xpos += met->scale * stbtt_GetCodepointKernAdvance(font,
-							vc_priv->last_ch, ch);
+		last = tt_char_metrics(priv, met, vc_priv->last_ch, NULL);
+		xpos += met->scale * stbtt_GetGlyphKernAdvance(font, last, idx);
 	}
 
 	/*
@@ -319,9 +563,19 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	 * image of the character. For empty characters, like ' ', data will
 	 * return NULL;
 	 */
-	data = stbtt_GetCodepointBitmapSubpixel(font, met->scale, met->scale,
-						x_shift, 0, ch, &width, &height,
-						&xoff, &yoff);
+	glyph = tt_get_glyph(priv, met, ch, idx, x_shift);
+	if (glyph) {
+		data = glyph->data;
+		width = glyph->width;
+		height = glyph->height;
+		xoff = glyph->xoff;
+		yoff = glyph->yoff;
+	} else {
+		data = stbtt_GetGlyphBitmapSubpixel(font, met->scale,
+						    met->scale, x_shift, 0,
+						    idx, &width, &height,
+						    &xoff, &yoff);
+	}
 	if (!data)
 		return width_frac;
 
@@ -412,16 +666,17 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 			break;
 		}
 		default:
-			free(data);
+			if (!glyph)
+				free(data);
 			return -ENOSYS;
 		}
 
 		line += vid_priv->line_length;
 	}
-	ret = vidconsole_sync_copy(dev, start, line);
-	if (ret)
-		return ret;
-	free(data);
+	if (!glyph)
+		free(data);
+	video_damage(vid, VID_TO_PIXEL(x) + xoff, y + max(linenum, 0), width,
+		     height);
 
 	return width_frac;
 }
@@ -724,9 +979,10 @@ static int truetype_select_font(struct udevice *dev, const char *name,
 static int truetype_measure(struct udevice *dev, const char *name, uint size,
 			    const char *text, struct vidconsole_bbox *bbox)
 {
+	struct console_tt_priv *priv = dev_get_priv(dev);
 	struct console_tt_metrics *met;
 	stbtt_fontinfo *font;
-	int lsb, advance;
+	int advance, glyph;
 	const char *s;
 	int width;
 	int last;
@@ -742,18 +998,16 @@ static int truetype_measure(struct udevice *dev, const char *name, uint size,
 
 	font = &met->font;
 	width = 0;
-	for (last = 0, s = text; *s; s++) {
-		int ch = *s;
+	for (last = -1, s = text; *s; s++) {
+		/* First get some basic metrics about this character */
+		glyph = tt_char_metrics(priv, met, *s, &advance);
 
 		/* Used kerning to fine-tune the position of this character */
-		if (last)
-			width += stbtt_GetCodepointKernAdvance(font, last, ch);
-
-		/* First get some basic metrics about this character */
-		stbtt_GetCodepointHMetrics(font, ch, &advance, &lsb);
+		if (last != -1)
+			width += stbtt_GetGlyphKernAdvance(font, last, glyph);
 
 		width += advance;
-		last = ch;
+		last = glyph;
 	}
 
 	bbox->valid = true;
@@ -959,6 +1213,8 @@ static int console_truetype_probe(struct udevice *dev)
 	int ret;
 
 	debug("%s: start\n", __func__);
+	INIT_LIST_HEAD(&priv->glyph_lru);
+	priv->cache.size = CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE * SZ_1K;
 	if (vid_priv->font_size)
 		font_size = vid_priv->font_size;
 	else
@@ -981,6 +1237,13 @@ static int console_truetype_probe(struct udevice *dev)
 	return 0;
 }
 
+static int console_truetype_remove(struct udevice *dev)
+{
+	console_truetype_set_cache_size(dev, 0);
+
+	return 0;
+}
+
 struct vidconsole_ops console_truetype_ops = {
 	.putc_xy	= console_truetype_putc_xy,
 	.move_rows	= console_truetype_move_rows,
@@ -1002,5 +1265,6 @@ U_BOOT_DRIVER(vidconsole_truetype) = {
 	.id	= UCLASS_VIDEO_CONSOLE,
 	.ops	= &console_truetype_ops,
 	.probe	= console_truetype_probe,
+	.remove	= console_truetype_remove,
 	.priv_auto	= sizeof(struct console_tt_priv),
 };
@@ -152,8 +152,17 @@ int video_fill_part(struct udevice *dev, int xstart, int ystart, int xend,
 {
 	struct video_priv *priv = dev_get_uclass_priv(dev);
 	void *start, *line;
-	int pixels = xend - xstart;
-	int row, i, ret;
+	int pixels;
+	int row, i;
+
+	/* Clip to the display */
+	xstart = max(xstart, 0);
+	ystart = max(ystart, 0);
+	xend = min(xend, (int)priv->xsize);
+	yend = min(yend, (int)priv->ysize);
+	if (xstart >= xend || ystart >= yend)
+		return 0;
+	pixels = xend - xstart;
 
 	start = priv->fb + ystart * priv->line_length;
 	start += xstart * VNBYTES(priv->bpix);
@@ -192,9 +201,7 @@ int video_fill_part(struct udevice *dev, int xstart, int ystart, int xend,
 		}
 		line += priv->line_length;
 	}
-	ret = video_sync_copy(dev, start, line);
-	if (ret)
-		return ret;
+	video_damage(dev, xstart, ystart, pixels, yend - ystart);
 
 	return 0;
 }
@@ -347,9 +354,68 @@ void video_set_default_colors(struct udevice *dev, bool invert)
 	priv->colour_bg = video_index_to_colour(priv, back);
 }
 
+/* Flush part of the frame buffer from the data cache */
+static void video_flush_range(struct video_priv *priv, void *start, void *end)
+{
+	/*
+	 * flush_dcache_range() is declared in common.h but it seems that some
+	 * architectures do not actually implement it. Is there a way to find
+	 * out whether it exists? For now, ARM is safe.
+	 */
+#if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
+	if (priv->flush_dcache) {
+		flush_dcache_range(ALIGN_DOWN((ulong)start,
+					      CONFIG_SYS_CACHELINE_SIZE),
+				   ALIGN((ulong)end, CONFIG_SYS_CACHELINE_SIZE));
+	}
+#endif
+}
+
+/**
+ * video_sync_region() - Copy and optionally flush a region of the frame buffer
+ *
+ * @priv: Video device information
+ * @rect: Region to sync, which must lie within the display
+ * @flush: true to flush the region from the data cache too
+ * Return: number of frame-buffer bytes covered by the region
+ */
+static ulong video_sync_region(struct video_priv *priv,
+			       const struct vid_rect *rect, bool flush)
+{
+	int pbytes = VNBYTES(priv->bpix);
+	long offset, size;
+	int rows, i;
+
+	if (rect->xend <= rect->xstart || rect->yend <= rect->ystart)
+		return 0;
+
+	/* Whole lines are contiguous, so handle them in one go */
+	if ((!rect->xstart && rect->xend == priv->xsize) || !pbytes) {
+		offset = rect->ystart * priv->line_length;
+		size = (rect->yend - rect->ystart) * priv->line_length;
+		rows = 1;
+	} else {
+		offset = rect->ystart * priv->line_length +
+			rect->xstart * pbytes;
+		size = (rect->xend - rect->xstart) * pbytes;
+		rows = rect->yend - rect->ystart;
+	}
+
+	for (i = 0; i < rows; i++, offset += priv->line_length) {
+		if (IS_ENABLED(CONFIG_VIDEO_COPY) && priv->copy_fb)
+			memcpy(priv->copy_fb + offset, priv->fb + offset, size);
+		if (flush)
+			video_flush_range(priv, priv->fb + offset,
+					  priv->fb + offset + size);
+	}
+
+	return rows * size;
+}
+
 /* Flush video activity to the caches */
 int video_sync(struct udevice *vid, bool force)
 {
+	struct video_priv *priv = dev_get_uclass_priv(vid);
 	struct video_ops *ops = video_get_ops(vid);
 	int ret;
 
@@ -359,21 +425,16 @@ int video_sync(struct udevice *vid, bool force)
 			return ret;
 	}
 
-	/*
-	 * flush_dcache_range() is declared in common.h but it seems that some
-	 * architectures do not actually implement it. Is there a way to find
-	 * out whether it exists? For now, ARM is safe.
-	 */
-#if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
-
-	if (priv->flush_dcache) {
-		flush_dcache_range((ulong)priv->fb,
-				   ALIGN((ulong)priv->fb + priv->fb_size,
-					 CONFIG_SYS_CACHELINE_SIZE));
+	if (IS_ENABLED(CONFIG_VIDEO_DAMAGE)) {
+		priv->sync_bytes = video_sync_region(priv, &priv->damage, true);
+		memset(&priv->damage, '\0', sizeof(priv->damage));
+	} else {
+		video_flush_range(priv, priv->fb, priv->fb + priv->fb_size);
+		priv->sync_bytes = priv->fb_size;
 	}
-#elif defined(CONFIG_VIDEO_SANDBOX_SDL)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
+	priv->sync_total += priv->sync_bytes;
+
+#ifdef CONFIG_VIDEO_SANDBOX_SDL
 	static ulong last_sync;
 
 	if (force || get_timer(last_sync) > 100) {
@@ -432,54 +493,110 @@ int video_get_ysize(struct udevice *dev)
 	return priv->ysize;
 }
 
-#ifdef CONFIG_VIDEO_COPY
+#if defined(CONFIG_VIDEO_COPY) || defined(CONFIG_VIDEO_DAMAGE)
+void video_damage(struct udevice *vid, int x, int y, int width, int height)
+{
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+	struct vid_rect *damage = &priv->damage;
+	struct vid_rect rect;
+
+	rect.xstart = max(x, 0);
+	rect.ystart = max(y, 0);
+	rect.xend = min_t(int, x + width, priv->xsize);
+	rect.yend = min_t(int, y + height, priv->ysize);
+	if (rect.xend <= rect.xstart || rect.yend <= rect.ystart)
+		return;
+
+	if (!IS_ENABLED(CONFIG_VIDEO_DAMAGE)) {
+		video_sync_region(priv, &rect, false);
+		return;
+	}
+
+	if (damage->xend <= damage->xstart) {
+		*damage = rect;
+	} else {
+		damage->xstart = min(damage->xstart, rect.xstart);
+		damage->ystart = min(damage->ystart, rect.ystart);
+		damage->xend = max(damage->xend, rect.xend);
+		damage->yend = max(damage->yend, rect.yend);
+	}
+}
+
+/*
+ * Record damage for a range of bytes in the frame buffer. The range only
+ * gives the exact columns if it lies within a single line
+ */
+static void video_damage_range(struct udevice *dev, long offset, long size)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	int pbytes = VNBYTES(priv->bpix);
+	int xstart, ystart, xend, yend;
+
+	if (size <= 0)
+		return;
+	ystart = offset / priv->line_length;
+	yend = DIV_ROUND_UP(offset + size, priv->line_length);
+	if (yend - ystart == 1 && pbytes) {
+		xstart = offset % priv->line_length / pbytes;
+		xend = DIV_ROUND_UP(offset + size - ystart * priv->line_length,
+				    pbytes);
+	} else {
+		xstart = 0;
+		xend = priv->xsize;
+	}
+	video_damage(dev, xstart, ystart, xend - xstart, yend - ystart);
+}
+
 int video_sync_copy(struct udevice *dev, void *from, void *to)
 {
 	struct video_priv *priv = dev_get_uclass_priv(dev);
+	long offset, size;
 
-	if (priv->copy_fb) {
-		long offset, size;
+	if (!priv->copy_fb && !IS_ENABLED(CONFIG_VIDEO_DAMAGE))
+		return 0;
 
-		/* Find the offset of the first byte to copy */
-		if ((ulong)to > (ulong)from) {
-			size = to - from;
-			offset = from - priv->fb;
-		} else {
-			size = from - to;
-			offset = to - priv->fb;
-		}
+	/* Find the offset of the first byte to copy */
+	if ((ulong)to > (ulong)from) {
+		size = to - from;
+		offset = from - priv->fb;
+	} else {
+		size = from - to;
+		offset = to - priv->fb;
+	}
 
-		/*
-		 * Allow a bit of leeway for valid requests somewhere near the
-		 * frame buffer
-		 */
-		if (offset < -priv->fb_size || offset > 2 * priv->fb_size) {
+	/*
+	 * Allow a bit of leeway for valid requests somewhere near the
+	 * frame buffer
+	 */
+	if (offset < -priv->fb_size || offset > 2 * priv->fb_size) {
 #ifdef DEBUG
-			char str[120];
+		char str[120];
 
-			snprintf(str, sizeof(str),
-				 "[** FAULT sync_copy fb=%p, from=%p, to=%p, offset=%lx]",
-				 priv->fb, from, to, offset);
-			console_puts_select_stderr(true, str);
+		snprintf(str, sizeof(str),
+			 "[** FAULT sync_copy fb=%p, from=%p, to=%p, offset=%lx]",
+			 priv->fb, from, to, offset);
+		console_puts_select_stderr(true, str);
 #endif
-			return -EFAULT;
-		}
+		return -EFAULT;
+	}
 
-		/*
-		 * Silently crop the memcpy. This allows callers to avoid doing
-		 * this themselves. It is common for the end pointer to go a
-		 * few lines after the end of the frame buffer, since most of
-		 * the update algorithms terminate a line after their last write
-		 */
-		if (offset + size > priv->fb_size) {
-			size = priv->fb_size - offset;
-		} else if (offset < 0) {
-			size += offset;
-			offset = 0;
-		}
+	/*
+	 * Silently crop the memcpy. This allows callers to avoid doing
+	 * this themselves. It is common for the end pointer to go a
+	 * few lines after the end of the frame buffer, since most of
+	 * the update algorithms terminate a line after their last write
+	 */
+	if (offset + size > priv->fb_size) {
+		size = priv->fb_size - offset;
+	} else if (offset < 0) {
+		size += offset;
+		offset = 0;
+	}
 
+	if (IS_ENABLED(CONFIG_VIDEO_DAMAGE))
+		video_damage_range(dev, offset, size);
+	else
 		memcpy(priv->copy_fb + offset, priv->fb + offset, size);
-	}
 
 	return 0;
 }
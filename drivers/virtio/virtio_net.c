@@ -33,6 +33,8 @@ struct virtio_net_priv {
 	char rx_buff[VIRTIO_NET_NUM_RX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
 	bool rx_running;
 	int net_hdr_len;
+	void *rx_batch[VIRTIO_NET_NUM_RX_BUFS];
+	int rx_batch_num;
 };
 
 /*
@@ -133,6 +135,40 @@ static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 	return 0;
 }
 
+static int virtio_net_recv_batch(struct udevice *dev, int flags,
+				 struct eth_rx_pkt *pkts, int count)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	struct virtio_sg sg = { NULL, VIRTIO_NET_RX_BUF_SIZE };
+	struct virtio_sg *sgs[] = { &sg };
+	unsigned int len;
+	void *buf;
+	int i;
+
+	/* Put the buffers of the last batch back, notifying the device once */
+	if (priv->rx_batch_num) {
+		for (i = 0; i < priv->rx_batch_num; i++) {
+			sg.addr = priv->rx_batch[i];
+			virtqueue_add(priv->rx_vq, sgs, 0, 1);
+		}
+		virtqueue_kick(priv->rx_vq);
+		priv->rx_batch_num = 0;
+	}
+
+	count = min(count, VIRTIO_NET_NUM_RX_BUFS);
+	for (i = 0; i < count; i++) {
+		buf = virtqueue_get_buf(priv->rx_vq, &len);
+		if (!buf)
+			break;
+		priv->rx_batch[i] = buf;
+		pkts[i].packet = buf + priv->net_hdr_len;
+		pkts[i].length = len - priv->net_hdr_len;
+	}
+	priv->rx_batch_num = i;
+
+	return i;
+}
+
 static void virtio_net_stop(struct udevice *dev)
 {
 	/*
@@ -220,6 +256,7 @@ static const struct eth_ops virtio_net_ops = {
 	.start = virtio_net_start,
 	.send = virtio_net_send,
 	.recv = virtio_net_recv,
+	.recv_batch = virtio_net_recv_batch,
 	.free_pkt = virtio_net_free_pkt,
 	.stop = virtio_net_stop,
 	.write_hwaddr = virtio_net_write_hwaddr,
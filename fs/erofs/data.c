@@ -55,7 +55,6 @@ int erofs_map_blocks(struct erofs_inode *inode,
 {
 	struct erofs_inode *vi = inode;
 	struct erofs_inode_chunk_index *idx;
-	u8 buf[EROFS_MAX_BLOCK_SIZE];
 	u64 chunknr;
 	unsigned int unit;
 	erofs_off_t pos;
@@ -81,9 +80,15 @@ int erofs_map_blocks(struct erofs_inode *inode,
 	pos = roundup(iloc(vi->nid) + vi->inode_isize +
 		      vi->xattr_isize, unit) + unit * chunknr;
 
-	err = erofs_blk_read(buf, erofs_blknr(pos), 1);
-	if (err < 0)
-		return -EIO;
+	/* consecutive chunks mostly share the same index block */
+	if (map->index != erofs_blknr(pos)) {
+		err = erofs_blk_read(map->mpage, erofs_blknr(pos), 1);
+		if (err < 0) {
+			map->index = UINT_MAX;
+			return -EIO;
+		}
+		map->index = erofs_blknr(pos);
+	}
 
 	map->m_la = chunknr << vi->u.chunkbits;
 	map->m_plen = min_t(erofs_off_t, 1UL << vi->u.chunkbits,
@@ -91,7 +96,7 @@ int erofs_map_blocks(struct erofs_inode *inode,
 
 	/* handle block map */
 	if (!(vi->u.chunkformat & EROFS_CHUNK_FORMAT_INDEXES)) {
-		__le32 *blkaddr = (void *)buf + erofs_blkoff(pos);
+		__le32 *blkaddr = (void *)map->mpage + erofs_blkoff(pos);
 
 		if (le32_to_cpu(*blkaddr) == EROFS_NULL_ADDR) {
 			map->m_flags = 0;
@@ -102,7 +107,7 @@ int erofs_map_blocks(struct erofs_inode *inode,
 		goto out;
 	}
 	/* parse chunk indexes */
-	idx = (void *)buf + erofs_blkoff(pos);
+	idx = (void *)map->mpage + erofs_blkoff(pos);
 	switch (le32_to_cpu(idx->blkaddr)) {
 	case EROFS_NULL_ADDR:
 		map->m_flags = 0;
@@ -147,32 +152,14 @@ int erofs_map_dev(struct erofs_map_dev *map)
 	return 0;
 }
 
-int erofs_read_one_data(struct erofs_map_blocks *map, char *buffer, u64 offset,
-			size_t len)
-{
-	struct erofs_map_dev mdev;
-	int ret;
-
-	mdev = (struct erofs_map_dev) {
-		.m_deviceid = map->m_deviceid,
-		.m_pa = map->m_pa,
-	};
-	ret = erofs_map_dev(&mdev);
-	if (ret)
-		return ret;
-
-	ret = erofs_dev_read(mdev.m_deviceid, buffer, mdev.m_pa + offset, len);
-	if (ret < 0)
-		return -EIO;
-	return 0;
-}
-
 static int erofs_read_raw_data(struct erofs_inode *inode, char *buffer,
 			       erofs_off_t size, erofs_off_t offset)
 {
 	struct erofs_map_blocks map = {
 		.index = UINT_MAX,
 	};
+	struct erofs_map_dev mdev, pending;
+	erofs_off_t pending_la, pending_len = 0;
 	int ret;
 	erofs_off_t ptr = offset;
 
@@ -208,35 +195,127 @@ static int erofs_read_raw_data(struct erofs_inode *inode, char *buffer,
 			map.m_la = ptr;
 		}
 
-		ret = erofs_read_one_data(&map, estart, moff, eend - map.m_la);
+		mdev = (struct erofs_map_dev) {
+			.m_deviceid = map.m_deviceid,
+			.m_pa = map.m_pa + moff,
+		};
+		ret = erofs_map_dev(&mdev);
 		if (ret)
 			return ret;
+
+		/*
+		 * extend the pending read if this extent follows it both in
+		 * the file and on disk, so that contiguous files are read
+		 * with a single request
+		 */
+		if (pending_len && pending.m_deviceid == mdev.m_deviceid &&
+		    pending_la + pending_len == map.m_la &&
+		    pending.m_pa + pending_len == mdev.m_pa) {
+			pending_len += eend - map.m_la;
+			ptr = eend;
+			continue;
+		}
+
+		if (pending_len) {
+			ret = erofs_dev_read(pending.m_deviceid,
+					     buffer + pending_la - offset,
+					     pending.m_pa, pending_len);
+			if (ret < 0)
+				return -EIO;
+		}
+		pending = mdev;
+		pending_la = map.m_la;
+		pending_len = eend - map.m_la;
 		ptr = eend;
 	}
+
+	if (pending_len &&
+	    erofs_dev_read(pending.m_deviceid, buffer + pending_la - offset,
+			   pending.m_pa, pending_len) < 0)
+		return -EIO;
 	return 0;
 }
 
-int z_erofs_read_one_data(struct erofs_inode *inode,
-			  struct erofs_map_blocks *map, char *raw, char *buffer,
-			  erofs_off_t skip, erofs_off_t length, bool trimmed)
+/**
+ * struct z_erofs_pcluster_slot - A decompressed physical cluster
+ *
+ * @pa: position of the compressed data on the disk
+ * @data: decompressed data, NULL if the slot is free
+ * @len: number of valid bytes in @data
+ * @size: size of @data
+ * @stamp: value of the access clock when the slot was last used
+ */
+struct z_erofs_pcluster_slot {
+	erofs_off_t pa;
+	char *data;
+	unsigned int len;
+	unsigned int size;
+	u32 stamp;
+};
+
+static struct z_erofs_pcluster_slot pcache[CONFIG_FS_EROFS_PCLUSTER_CACHE];
+static u32 pcache_clock;
+
+static struct z_erofs_pcluster_slot *z_erofs_pcache_find(erofs_off_t pa,
+							 unsigned int len)
 {
-	struct erofs_map_dev mdev;
-	int ret = 0;
+	struct z_erofs_pcluster_slot *slot;
 
-	if (map->m_flags & EROFS_MAP_FRAGMENT) {
-		struct erofs_inode packed_inode = {
-			.nid = sbi.packed_nid,
-		};
+	for (slot = pcache; slot < pcache + ARRAY_SIZE(pcache); slot++) {
+		if (slot->data && slot->pa == pa && slot->len >= len) {
+			slot->stamp = ++pcache_clock;
+			return slot;
+		}
+	}
 
-		ret = erofs_read_inode_from_disk(&packed_inode);
-		if (ret) {
-			erofs_err("failed to read packed inode from disk");
-			return ret;
+	return NULL;
+}
+
+/* Get a slot of at least @len bytes, evicting the least-recently-used one */
+static struct z_erofs_pcluster_slot *z_erofs_pcache_alloc(erofs_off_t pa,
+							  unsigned int len)
+{
+	struct z_erofs_pcluster_slot *slot, *lru = pcache;
+
+	for (slot = pcache; slot < pcache + ARRAY_SIZE(pcache); slot++) {
+		if (slot->data && slot->pa == pa) {
+			lru = slot;
+			break;
 		}
+		if ((s32)(slot->stamp - lru->stamp) < 0)
+			lru = slot;
+	}
 
-		return erofs_pread(&packed_inode, buffer, length - skip,
-				   inode->fragmentoff + skip);
+	if (lru->size < len) {
+		free(lru->data);
+		lru->size = 0;
+		lru->data = malloc(len);
+		if (!lru->data)
+			return NULL;
+		lru->size = len;
 	}
+	lru->pa = pa;
+	lru->len = 0;
+	lru->stamp = ++pcache_clock;
+
+	return lru;
+}
+
+void z_erofs_cache_free(void)
+{
+	struct z_erofs_pcluster_slot *slot;
+
+	for (slot = pcache; slot < pcache + ARRAY_SIZE(pcache); slot++)
+		free(slot->data);
+	memset(pcache, '\0', sizeof(pcache));
+}
+
+static int z_erofs_read_pcluster(struct erofs_map_blocks *map, char *raw,
+				 char *buffer, erofs_off_t skip,
+				 erofs_off_t length, bool partial)
+{
+	struct erofs_map_dev mdev;
+	int ret;
 
 	/* no device id here, thus it will always succeed */
 	mdev = (struct erofs_map_dev) {
@@ -252,7 +331,7 @@ int z_erofs_read_one_data(struct erofs_inode *inode,
 	if (ret < 0)
 		return ret;
 
-	ret = z_erofs_decompress(&(struct z_erofs_decompress_req) {
+	return z_erofs_decompress(&(struct z_erofs_decompress_req) {
 			.in = raw,
 			.out = buffer,
 			.decodedskip = skip,
@@ -262,12 +341,61 @@ int z_erofs_read_one_data(struct erofs_inode *inode,
 			.inputsize = map->m_plen,
 			.decodedlength = length,
 			.alg = map->m_algorithmformat,
-			.partial_decoding = trimmed ? true :
-				!(map->m_flags & EROFS_MAP_FULL_MAPPED) ||
-					(map->m_flags & EROFS_MAP_PARTIAL_REF),
+			.partial_decoding = partial,
 			 });
-	if (ret < 0)
-		return ret;
+}
+
+int z_erofs_read_one_data(struct erofs_inode *inode,
+			  struct erofs_map_blocks *map, char *raw, char *buffer,
+			  erofs_off_t skip, erofs_off_t length, bool trimmed)
+{
+	struct z_erofs_pcluster_slot *slot;
+	bool partial;
+	int ret = 0;
+
+	if (map->m_flags & EROFS_MAP_FRAGMENT) {
+		struct erofs_inode packed_inode = {
+			.nid = sbi.packed_nid,
+		};
+
+		ret = erofs_read_inode_from_disk(&packed_inode);
+		if (ret) {
+			erofs_err("failed to read packed inode from disk");
+			return ret;
+		}
+
+		return erofs_pread(&packed_inode, buffer, length - skip,
+				   inode->fragmentoff + skip);
+	}
+
+	partial = !(map->m_flags & EROFS_MAP_FULL_MAPPED) ||
+		(map->m_flags & EROFS_MAP_PARTIAL_REF);
+
+	/*
+	 * A whole extent is decompressed straight into the buffer. Only part
+	 * of it is needed at either end of a read, which is where the next
+	 * read in the file usually starts, so decompress all of the extent
+	 * into the cache and copy out the part which is needed.
+	 */
+	if ((!skip && !trimmed) ||
+	    map->m_algorithmformat >= Z_EROFS_COMPRESSION_MAX)
+		return z_erofs_read_pcluster(map, raw, buffer, skip, length,
+					     partial || trimmed);
+
+	slot = z_erofs_pcache_find(map->m_pa, length);
+	if (!slot) {
+		slot = z_erofs_pcache_alloc(map->m_pa, map->m_llen);
+		if (!slot)
+			return z_erofs_read_pcluster(map, raw, buffer, skip,
+						     length, partial || trimmed);
+		ret = z_erofs_read_pcluster(map, raw, slot->data, 0,
+					    map->m_llen, partial);
+		if (ret < 0)
+			return ret;
+		slot->len = map->m_llen;
+	}
+	memcpy(buffer, slot->data + skip, length - skip);
+
 	return 0;
 }
 
@@ -287,7 +415,9 @@ static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 	while (end > offset) {
 		map.m_la = end - 1;
 
-		ret = z_erofs_map_blocks_iter(inode, &map, 0);
+		/* map the whole extent, so that all of it can be cached */
+		ret = z_erofs_map_blocks_iter(inode, &map,
+					      EROFS_GET_BLOCKS_FIEMAP);
 		if (ret)
 			break;
 
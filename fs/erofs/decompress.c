@@ -1,6 +1,25 @@
 // SPDX-License-Identifier: GPL-2.0+
 #include "decompress.h"
 
+/*
+ * Skip the zeroes which pad the compressed data to the end of the pcluster,
+ * returning the offset at which the data starts
+ */
+static int __maybe_unused
+z_erofs_fixup_insize(struct z_erofs_decompress_req *rq)
+{
+	unsigned int inputmargin = 0;
+
+	while (!rq->in[inputmargin & (erofs_blksiz() - 1)])
+		if (!(++inputmargin & (erofs_blksiz() - 1)))
+			break;
+
+	if (inputmargin >= rq->inputsize)
+		return -EIO;
+
+	return inputmargin;
+}
+
 #if IS_ENABLED(CONFIG_LZ4)
 #include <u-boot/lz4.h>
 static int z_erofs_decompress_lz4(struct z_erofs_decompress_req *rq)
@@ -10,17 +29,14 @@ static int z_erofs_decompress_lz4(struct z_erofs_decompress_req *rq)
 	char *src = rq->in;
 	char *buff = NULL;
 	bool support_0padding = false;
-	unsigned int inputmargin = 0;
+	int inputmargin = 0;
 
 	if (erofs_sb_has_lz4_0padding()) {
 		support_0padding = true;
 
-		while (!src[inputmargin & (erofs_blksiz() - 1)])
-			if (!(++inputmargin & (erofs_blksiz() - 1)))
-				break;
-
-		if (inputmargin >= rq->inputsize)
-			return -EIO;
+		inputmargin = z_erofs_fixup_insize(rq);
+		if (inputmargin < 0)
+			return inputmargin;
 	}
 
 	if (rq->decodedskip) {
@@ -59,6 +75,140 @@ out:
 }
 #endif
 
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_LZMA)
+#include <asm/unaligned.h>
+#include <linux/sizes.h>
+#include <lzma/LzmaDec.h>
+
+static void *z_erofs_lzma_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+static void z_erofs_lzma_free(void *p, void *address)
+{
+	free(address);
+}
+
+/*
+ * MicroLZMA is a raw LZMA stream without an end marker, whose first byte
+ * holds the bitwise negation of the properties byte in place of the first
+ * byte of the range coder, which is always zero
+ */
+static int z_erofs_decompress_lzma(struct z_erofs_decompress_req *rq)
+{
+	ISzAlloc alloc = { z_erofs_lzma_alloc, z_erofs_lzma_free };
+	char *dest = rq->out;
+	char *src = rq->in;
+	char *buff = NULL;
+	u8 props[LZMA_PROPS_SIZE];
+	ELzmaStatus status;
+	SizeT inlen, outlen;
+	int inputmargin;
+	int ret;
+	u8 first;
+
+	inputmargin = z_erofs_fixup_insize(rq);
+	if (inputmargin < 0)
+		return inputmargin;
+	src += inputmargin;
+	inlen = rq->inputsize - inputmargin;
+
+	if (rq->decodedskip) {
+		buff = malloc(rq->decodedlength);
+		if (!buff)
+			return -ENOMEM;
+		dest = buff;
+	}
+
+	/* the whole output buffer is the dictionary */
+	first = src[0];
+	props[0] = ~first;
+	put_unaligned_le32(max_t(u32, rq->decodedlength, SZ_4K), props + 1);
+	src[0] = 0;
+
+	outlen = rq->decodedlength;
+	ret = LzmaDecode((Byte *)dest, &outlen, (Byte *)src, &inlen, props,
+			 sizeof(props), LZMA_FINISH_ANY, &status, &alloc);
+	src[0] = first;
+	if (ret != SZ_OK || outlen != rq->decodedlength) {
+		erofs_err("failed to decompress %d in[%u, %u] out[%u]",
+			  ret, rq->inputsize, inputmargin, rq->decodedlength);
+		ret = -EIO;
+		goto out;
+	}
+	ret = 0;
+
+	if (rq->decodedskip)
+		memcpy(rq->out, dest + rq->decodedskip,
+		       rq->decodedlength - rq->decodedskip);
+
+out:
+	if (buff)
+		free(buff);
+
+	return ret;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_DEFLATE)
+#include <u-boot/zlib.h>
+
+static int z_erofs_decompress_deflate(struct z_erofs_decompress_req *rq)
+{
+	char *dest = rq->out;
+	char *buff = NULL;
+	int inputmargin;
+	z_stream strm;
+	int ret;
+
+	inputmargin = z_erofs_fixup_insize(rq);
+	if (inputmargin < 0)
+		return inputmargin;
+
+	if (rq->decodedskip) {
+		buff = malloc(rq->decodedlength);
+		if (!buff)
+			return -ENOMEM;
+		dest = buff;
+	}
+
+	memset(&strm, '\0', sizeof(strm));
+	ret = inflateInit2(&strm, -MAX_WBITS);
+	if (ret != Z_OK) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	strm.next_in = (Bytef *)rq->in + inputmargin;
+	strm.avail_in = rq->inputsize - inputmargin;
+	strm.next_out = (Bytef *)dest;
+	strm.avail_out = rq->decodedlength;
+
+	/* partial decoding stops as soon as the output buffer is full */
+	ret = inflate(&strm, Z_FINISH);
+	inflateEnd(&strm);
+	if (strm.avail_out ||
+	    (ret != Z_STREAM_END && !rq->partial_decoding)) {
+		erofs_err("failed to %s decompress %d in[%u, %u] out[%u]",
+			  rq->partial_decoding ? "partial" : "full",
+			  ret, rq->inputsize, inputmargin, rq->decodedlength);
+		ret = -EIO;
+		goto out;
+	}
+	ret = 0;
+
+	if (rq->decodedskip)
+		memcpy(rq->out, dest + rq->decodedskip,
+		       rq->decodedlength - rq->decodedskip);
+
+out:
+	if (buff)
+		free(buff);
+
+	return ret;
+}
+#endif
+
 int z_erofs_decompress(struct z_erofs_decompress_req *rq)
 {
 	if (rq->alg == Z_EROFS_COMPRESSION_INTERLACED) {
@@ -93,6 +243,14 @@ int z_erofs_decompress(struct z_erofs_decompress_req *rq)
 #if IS_ENABLED(CONFIG_LZ4)
 	if (rq->alg == Z_EROFS_COMPRESSION_LZ4)
 		return z_erofs_decompress_lz4(rq);
+#endif
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_LZMA)
+	if (rq->alg == Z_EROFS_COMPRESSION_LZMA)
+		return z_erofs_decompress_lzma(rq);
+#endif
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_DEFLATE)
+	if (rq->alg == Z_EROFS_COMPRESSION_DEFLATE)
+		return z_erofs_decompress_deflate(rq);
 #endif
 	return -EOPNOTSUPP;
 }
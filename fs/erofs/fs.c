@@ -7,6 +7,11 @@ struct erofs_sb_info sbi;
 static struct erofs_ctxt {
 	struct disk_partition cur_part_info;
 	struct blk_desc *cur_dev;
+
+	/* filesystem which the decompressed clusters were cached from */
+	struct blk_desc *cache_dev;
+	lbaint_t cache_start;
+	struct erofs_super_block cache_sb;
 } ctxt;
 
 int erofs_dev_read(int device_id, void *buf, u64 offset, size_t len)
@@ -29,6 +34,29 @@ int erofs_blk_read(void *buf, erofs_blk_t start, u32 nblocks)
 			 erofs_pos(nblocks));
 }
 
+/*
+ * The cache of decompressed clusters is kept across erofs_close(), since every
+ * command closes the filesystem. Drop it when another filesystem is probed.
+ */
+static void erofs_check_cache(void)
+{
+	struct erofs_super_block sb;
+	int ret;
+
+	ret = erofs_dev_read(0, &sb, EROFS_SUPER_OFFSET, sizeof(sb));
+	if (ret < 0)
+		memset(&sb, '\0', sizeof(sb));
+	else if (ctxt.cache_dev == ctxt.cur_dev &&
+		 ctxt.cache_start == ctxt.cur_part_info.start &&
+		 !memcmp(&ctxt.cache_sb, &sb, sizeof(sb)))
+		return;
+
+	z_erofs_cache_free();
+	ctxt.cache_dev = ctxt.cur_dev;
+	ctxt.cache_start = ctxt.cur_part_info.start;
+	ctxt.cache_sb = sb;
+}
+
 int erofs_probe(struct blk_desc *fs_dev_desc,
 		struct disk_partition *fs_partition)
 {
@@ -40,6 +68,7 @@ int erofs_probe(struct blk_desc *fs_dev_desc,
 	ret = erofs_read_superblock();
 	if (ret)
 		goto error;
+	erofs_check_cache();
 
 	return 0;
 error:
@@ -1530,16 +1530,23 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
+/*
+ * Walk the extent tree down to the leaf for @fileblock. If @endp is not NULL
+ * it is set to the first file block covered by a later leaf, or 0 if there is
+ * none.
+ */
 static struct ext4_extent_header *ext4fs_get_extent_block
 	(struct ext2_data *data, struct ext_block_cache *cache,
 		struct ext4_extent_header *ext_block,
-		uint32_t fileblock, int log2_blksz)
+		uint32_t fileblock, int log2_blksz, uint32_t *endp)
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
 	int blksz = EXT2_BLOCK_SIZE(data);
 	int i;
 
+	if (endp)
+		*endp = 0;
 	while (1) {
 		index = (struct ext4_extent_idx *)(ext_block + 1);
 
@@ -1562,6 +1569,10 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 		if (i > 0)
 			i--;
 
+		/* the next index entry bounds the leaf, tightest at the bottom */
+		if (endp && i + 1 < le16_to_cpu(ext_block->eh_entries))
+			*endp = le32_to_cpu(index[i + 1].ei_block);
+
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
 		block <<= log2_blksz;
@@ -1571,6 +1582,88 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 	}
 }
 
+/* Check whether @ext_block is a leaf whose extents span @fileblock */
+static bool ext4fs_leaf_spans(struct ext4_extent_header *ext_block,
+			      uint32_t fileblock)
+{
+	struct ext4_extent *extent = (struct ext4_extent *)(ext_block + 1);
+	int entries = le16_to_cpu(ext_block->eh_entries);
+
+	if (le16_to_cpu(ext_block->eh_magic) != EXT4_EXT_MAGIC ||
+	    ext_block->eh_depth || !entries)
+		return false;
+
+	return fileblock >= le32_to_cpu(extent[0].ee_block) &&
+	       fileblock < le32_to_cpu(extent[entries - 1].ee_block) +
+			   le16_to_cpu(extent[entries - 1].ee_len);
+}
+
+/*
+ * Find the extent holding @fileblock and record it as the current run in
+ * @cache. A hole is recorded as a run up to the next extent, with a physical
+ * block of 0. Returns the physical block of @fileblock, 0 for a hole or a
+ * negative error.
+ */
+static long int ext4fs_find_extent(struct ext2_inode *inode, int fileblock,
+				   struct ext_block_cache *cache,
+				   int log2_blksz)
+{
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	long int startblock, endblock;
+	unsigned long long start;
+	uint32_t leaf_end = 0;
+	int i;
+
+	/*
+	 * The leaf found for the previous run usually holds the next one too,
+	 * so only go back to the root, and read the index blocks, when not.
+	 */
+	ext_block = (struct ext4_extent_header *)cache->buf;
+	if (!ext_block || !ext4fs_leaf_spans(ext_block, fileblock))
+		ext_block = ext4fs_get_extent_block(ext4fs_root, cache,
+						    (struct ext4_extent_header *)
+						    inode->b.blocks.dir_blocks,
+						    fileblock, log2_blksz,
+						    &leaf_end);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	/*
+	 * Past the last extent the hole runs up to the next leaf. Without one
+	 * it is past the end of the tree, so take a single block.
+	 */
+	cache->run_start = fileblock;
+	cache->run_len = leaf_end > fileblock ? leaf_end - fileblock : 1;
+	cache->run_blknr = 0;
+
+	extent = (struct ext4_extent *)(ext_block + 1);
+
+	for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+		startblock = le32_to_cpu(extent[i].ee_block);
+		endblock = startblock + le16_to_cpu(extent[i].ee_len);
+
+		if (startblock > fileblock) {
+			/* Sparse file */
+			cache->run_len = startblock - fileblock;
+			return 0;
+
+		} else if (fileblock < endblock) {
+			start = le16_to_cpu(extent[i].ee_start_hi);
+			start = (start << 32) +
+				le32_to_cpu(extent[i].ee_start_lo);
+			cache->run_start = startblock;
+			cache->run_len = endblock - startblock;
+			cache->run_blknr = start;
+			return (fileblock - startblock) + start;
+		}
+	}
+
+	return 0;
+}
+
 static int ext4fs_blockgroup
 	(struct ext2_data *data, int group, struct ext2_block_group *blkgrp)
 {
@@ -1657,18 +1750,13 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		long int startblock, endblock;
 		struct ext_block_cache *c, cd;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i;
 
 		if (cache) {
 			c = cache;
@@ -1676,43 +1764,10 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			c = &cd;
 			ext_cache_init(c);
 		}
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, c,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
-			printf("invalid extent block\n");
-			if (!cache)
-				ext_cache_fini(c);
-			return -EINVAL;
-		}
-
-		extent = (struct ext4_extent *)(ext_block + 1);
-
-		for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
-			startblock = le32_to_cpu(extent[i].ee_block);
-			endblock = startblock + le16_to_cpu(extent[i].ee_len);
-
-			if (startblock > fileblock) {
-				/* Sparse file */
-				if (!cache)
-					ext_cache_fini(c);
-				return 0;
-
-			} else if (fileblock < endblock) {
-				start = le16_to_cpu(extent[i].ee_start_hi);
-				start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-				if (!cache)
-					ext_cache_fini(c);
-				return (fileblock - startblock) + start;
-			}
-		}
-
+		blknr = ext4fs_find_extent(inode, fileblock, c, log2_blksz);
 		if (!cache)
 			ext_cache_fini(c);
-		return 0;
+		return blknr;
 	}
 
 	/* Direct blocks. */
@@ -2000,6 +2055,59 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+/**
+ * read_allocated_run() - Find the run of blocks holding a file block
+ *
+ * A run is a range of file blocks stored in consecutive filesystem blocks, or
+ * a hole. For extent-mapped files this is the whole extent, for block-mapped
+ * files the following entries of the (cached) indirect blocks are compared.
+ * The run is kept in @cache so that the blocks after @fileblock are found
+ * without walking the tree again.
+ *
+ * @inode:	inode of the file
+ * @fileblock:	file block to look up
+ * @maxcount:	maximum number of blocks to return, at least 1
+ * @cache:	lookup cache, set up with ext_cache_init()
+ * @countp:	returns the number of blocks in the run from @fileblock on
+ * Return:	filesystem block holding @fileblock, 0 for a hole or a negative
+ *		error
+ */
+long int read_allocated_run(struct ext2_inode *inode, int fileblock,
+			    int maxcount, struct ext_block_cache *cache,
+			    int *countp)
+{
+	long int blknr, next;
+	int count;
+
+	if (!cache->run_len || fileblock < cache->run_start ||
+	    fileblock - cache->run_start >= cache->run_len) {
+		blknr = read_allocated_block(inode, fileblock, cache);
+		if (blknr < 0)
+			return blknr;
+
+		if (!(le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL)) {
+			for (count = 1; count < maxcount; count++) {
+				next = read_allocated_block(inode,
+							    fileblock + count,
+							    NULL);
+				if (next < 0 ||
+				    next != (blknr ? blknr + count : 0))
+					break;
+			}
+			cache->run_start = fileblock;
+			cache->run_len = count;
+			cache->run_blknr = blknr;
+		}
+	}
+
+	*countp = min(maxcount,
+		      cache->run_start + cache->run_len - fileblock);
+	if (!cache->run_blknr)
+		return 0;
+
+	return cache->run_blknr + fileblock - cache->run_start;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -53,7 +53,7 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
+	int i, count;
 	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
@@ -65,7 +65,6 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	lbaint_t delayed_skipfirst = 0;
 	lbaint_t delayed_next = 0;
 	char *delayed_buf = NULL;
-	char *start_buf = buf;
 	short status;
 	struct ext_block_cache cache;
 
@@ -82,12 +81,15 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
+	for (i = lldiv(pos, blocksize); i < blockcnt; i += count) {
 		long int blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
+		loff_t blockoff = (loff_t)blocksize * i;
+		loff_t blockend;
 		int skipfirst = 0;
-		blknr = read_allocated_block(&node->inode, i, &cache);
+
+		/* look up a whole run of blocks at a time */
+		blknr = read_allocated_run(&node->inode, i, blockcnt - i,
+					   &cache, &count);
 		if (blknr < 0) {
 			ext_cache_fini(&cache);
 			return -1;
@@ -95,27 +97,22 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 
 		blknr = blknr << log2_fs_blocksize;
 
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
+		/* Stop at the end of the run or of the data wanted */
+		blockend = min(blockoff + (loff_t)blocksize * count, len + pos);
 
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
+		/* First block, which may be partial */
+		if (blockoff < pos)
+			skipfirst = pos - blockoff;
+		blockend -= blockoff + skipfirst;
 
-		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
-		}
 		if (blknr) {
 			int status;
 
 			if (previous_block_number != -1) {
 				if (delayed_next == blknr) {
 					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
+					delayed_next += (lbaint_t)count <<
+						log2_fs_blocksize;
 				} else {	/* spill */
 					status = ext4fs_devread(delayed_start,
 							delayed_skipfirst,
@@ -130,8 +127,8 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 					delayed_extent = blockend;
 					delayed_skipfirst = skipfirst;
 					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
+					delayed_next = blknr + ((lbaint_t)count <<
+						log2_fs_blocksize);
 				}
 			} else {
 				previous_block_number = blknr;
@@ -139,12 +136,10 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 				delayed_extent = blockend;
 				delayed_skipfirst = skipfirst;
 				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
+				delayed_next = blknr + ((lbaint_t)count <<
+					log2_fs_blocksize);
 			}
 		} else {
-			int n;
-			int n_left;
 			if (previous_block_number != -1) {
 				/* spill */
 				status = ext4fs_devread(delayed_start,
@@ -158,13 +153,9 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 				previous_block_number = -1;
 			}
 			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			n_left = len - ( buf - start_buf );
-			if (n > n_left)
-				n = n_left;
-			memset(buf, 0, n);
+			memset(buf, 0, blockend);
 		}
-		buf += blocksize - skipfirst;
+		buf += blockend;
 	}
 	if (previous_block_number != -1) {
 		/* spill */
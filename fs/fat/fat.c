@@ -26,10 +26,14 @@
 #include <linux/compiler.h>
 #include <linux/ctype.h>
 #include <linux/log2.h>
+#include <linux/sizes.h>
 
 /* maximum number of clusters for FAT12 */
 #define MAX_FAT12	0xFF4
 
+/* most bytes to read at a time into a misaligned buffer, through a copy */
+#define FATBOUNCESIZE	SZ_64K
+
 /*
  * Convert a string to lowercase.  Converts at most 'len' characters,
  * 'len' may be larger than the length of 'str' if 'str' is NULL
@@ -172,6 +176,8 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	__u32 offset, off8;
 	__u32 ret = 0x00;
 
+	BUILD_BUG_ON(FATBUFBLOCKS % 3);
+
 	if (CHECK_CLUST(entry, mydata->fatsize)) {
 		log_err("Invalid FAT entry: %#08x\n", entry);
 		return ret;
@@ -264,21 +270,37 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 
 	debug("gc - clustnum: %d, startsect: %d\n", clustnum, startsect);
 
-	if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1)) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
+	if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1) &&
+	    size >= mydata->sect_size) {
+		__u32 max_count = FATBOUNCESIZE / mydata->sect_size;
 
 		debug("FAT: Misaligned buffer address (%p)\n", buffer);
 
+		/* bounce up to FATBOUNCESIZE at a time, through a buffer kept per mount */
+		if (!mydata->bouncebuf) {
+			mydata->bouncebuf = malloc_cache_aligned(FATBOUNCESIZE);
+			if (!mydata->bouncebuf) {
+				debug("Error: allocating buffer\n");
+				return -1;
+			}
+		}
+
 		while (size >= mydata->sect_size) {
-			ret = disk_read(startsect++, 1, tmpbuf);
-			if (ret != 1) {
+			__u32 sect_count, bytes_read;
+
+			sect_count = min(size / mydata->sect_size,
+					 (unsigned long)max_count);
+			ret = disk_read(startsect, sect_count, mydata->bouncebuf);
+			if (ret != sect_count) {
 				debug("Error reading data (got %d)\n", ret);
 				return -1;
 			}
 
-			memcpy(buffer, tmpbuf, mydata->sect_size);
-			buffer += mydata->sect_size;
-			size -= mydata->sect_size;
+			bytes_read = sect_count * mydata->sect_size;
+			memcpy(buffer, mydata->bouncebuf, bytes_read);
+			startsect += sect_count;
+			buffer += bytes_read;
+			size -= bytes_read;
 		}
 	} else if (size >= mydata->sect_size) {
 		__u32 bytes_read;
@@ -686,6 +708,7 @@ static int get_fs_info(fsdata *mydata)
 
 	mydata->fatbufnum = -1;
 	mydata->fat_dirty = 0;
+	mydata->bouncebuf = NULL;
 	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
@@ -1239,6 +1262,7 @@ int fat_exists(const char *filename)
 
 	ret = fat_itr_resolve(itr, filename, TYPE_ANY);
 	free(fsdata.fatbuf);
+	free(fsdata.bouncebuf);
 out:
 	free(itr);
 	return ret == 0;
@@ -1286,6 +1310,7 @@ int fat_size(const char *filename, loff_t *size)
 		 * expected to fail if passed a directory path:
 		 */
 		free(fsdata.fatbuf);
+		free(fsdata.bouncebuf);
 		ret = fat_itr_root(itr, &fsdata);
 		if (ret)
 			goto out_free_itr;
@@ -1298,6 +1323,7 @@ int fat_size(const char *filename, loff_t *size)
 	*size = FAT2CPU32(itr->dent->size);
 out_free_both:
 	free(fsdata.fatbuf);
+	free(fsdata.bouncebuf);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1330,6 +1356,7 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 
 out_free_both:
 	free(fsdata.fatbuf);
+	free(fsdata.bouncebuf);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1377,6 +1404,7 @@ int fat_opendir(const char *filename, struct fs_dir_stream **dirsp)
 
 fail_free_both:
 	free(dir->fsdata.fatbuf);
+	free(dir->fsdata.bouncebuf);
 fail_free_dir:
 	free(dir);
 	return ret;
@@ -1417,6 +1445,7 @@ void fat_closedir(struct fs_dir_stream *dirs)
 {
 	fat_dir *dir = (fat_dir *)dirs;
 	free(dir->fsdata.fatbuf);
+	free(dir->fsdata.bouncebuf);
 	free(dir);
 }
 
@@ -1432,6 +1432,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 exit:
 	free(filename_copy);
 	free(mydata->fatbuf);
+	free(mydata->bouncebuf);
 	free(itr);
 	return ret;
 }
@@ -1459,6 +1460,7 @@ static int fat_dir_entries(fat_itr *itr)
 	/* duplicate fsdata */
 	fat_itr_child(dirs, itr);
 	fsdata = *dirs->fsdata;
+	fsdata.bouncebuf = NULL;
 
 	/* allocate local fat buffer */
 	fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
@@ -1475,6 +1477,7 @@ static int fat_dir_entries(fat_itr *itr)
 
 exit:
 	free(fsdata.fatbuf);
+	free(fsdata.bouncebuf);
 	free(dirs);
 	return count;
 }
@@ -1622,6 +1625,7 @@ int fat_unlink(const char *filename)
 
 exit:
 	free(fsdata.fatbuf);
+	free(fsdata.bouncebuf);
 	free(itr);
 	free(filename_copy);
 
@@ -1766,6 +1770,7 @@ int fat_mkdir(const char *dirname)
 exit:
 	free(dirname_copy);
 	free(mydata->fatbuf);
+	free(mydata->bouncebuf);
 	free(itr);
 	free(dotdent);
 	return ret;
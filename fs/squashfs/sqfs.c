@@ -93,6 +93,55 @@ static int sqfs_calc_n_blks(__le64 start, __le64 end, u64 *offset)
 	return DIV_ROUND_UP(table_size + *offset, ctxt.cur_dev->blksz);
 }
 
+/*
+ * Looks up the decompressed block which starts at byte @start on the disk. The
+ * entry is only valid until the next call to sqfs_cache_add().
+ */
+static struct sqfs_cache_entry *sqfs_cache_find(u64 start)
+{
+	struct sqfs_cache_entry *ent;
+
+	for (ent = ctxt.cache; ent < ctxt.cache + ARRAY_SIZE(ctxt.cache);
+	     ent++) {
+		if (ent->data && ent->start == start) {
+			ent->stamp = ++ctxt.cache_clock;
+			ctxt.stats.hits++;
+			return ent;
+		}
+	}
+	ctxt.stats.misses++;
+
+	return NULL;
+}
+
+/*
+ * Adds a decompressed block to the cache in place of the least-recently-used
+ * one. The cache takes ownership of @data.
+ */
+static struct sqfs_cache_entry *sqfs_cache_add(u64 start, void *data,
+					       u32 size)
+{
+	struct sqfs_cache_entry *ent, *lru = ctxt.cache;
+
+	for (ent = ctxt.cache; ent < ctxt.cache + ARRAY_SIZE(ctxt.cache);
+	     ent++) {
+		if (!ent->data) {
+			lru = ent;
+			break;
+		}
+		if ((s32)(ent->stamp - lru->stamp) < 0)
+			lru = ent;
+	}
+
+	free(lru->data);
+	lru->start = start;
+	lru->data = data;
+	lru->size = size;
+	lru->stamp = ++ctxt.cache_clock;
+
+	return lru;
+}
+
 /*
  * Retrieves fragment block entry and returns true if the fragment block is
  * compressed
@@ -104,6 +153,7 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	unsigned char *metadata_buffer, *metadata, *table;
 	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
+	struct sqfs_cache_entry *ent;
 	unsigned long dest_len;
 	int block, offset, ret;
 	u16 header;
@@ -149,6 +199,11 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	start_block = get_unaligned_le64(table + table_offset + block *
 					 sizeof(u64));
 
+	/* The metadata block may already be decompressed */
+	ent = sqfs_cache_find(start_block);
+	if (ent)
+		goto found;
+
 	start = start_block / ctxt.cur_dev->blksz;
 	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
 				  sblk->fragment_table_start, &table_offset);
@@ -189,10 +244,20 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 			goto out;
 		}
 	} else {
-		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
+		dest_len = SQFS_METADATA_SIZE(header);
+		memcpy(entries, metadata, dest_len);
 	}
 
-	*e = entries[offset];
+	ent = sqfs_cache_add(start_block, entries, dest_len);
+	entries = NULL;
+
+found:
+	if ((offset + 1) * sizeof(*e) > ent->size) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	*e = ((struct squashfs_fragment_block_entry *)ent->data)[offset];
 	ret = SQFS_COMPRESSED_BLOCK(e->size);
 
 out:
@@ -771,6 +836,7 @@ static int sqfs_read_inode_table(unsigned char **inode_table)
 		table_offset += src_len + SQFS_HEADER_SIZE;
 		src_table += src_len + SQFS_HEADER_SIZE;
 	}
+	ret = metablks_count;
 
 free_itb:
 	free(itb);
@@ -878,13 +944,47 @@ out:
 	return metablks_count;
 }
 
-int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+/*
+ * Decompresses the inode and directory tables on first use. They are kept in
+ * the context until another filesystem is probed.
+ */
+static int sqfs_get_tables(void)
 {
-	unsigned char *inode_table = NULL, *dir_table = NULL;
-	int j, token_count = 0, ret = 0, metablks_count;
+	int metablks_count;
+
+	if (ctxt.inode_table) {
+		ctxt.stats.hits++;
+		return 0;
+	}
+	ctxt.stats.misses++;
+
+	metablks_count = sqfs_read_inode_table(&ctxt.inode_table);
+	if (metablks_count < 1)
+		return -EINVAL;
+	ctxt.inode_metablks = metablks_count;
+
+	metablks_count = sqfs_read_directory_table(&ctxt.dir_table,
+						   &ctxt.dir_pos_list);
+	if (metablks_count < 1) {
+		free(ctxt.inode_table);
+		ctxt.inode_table = NULL;
+		return -EINVAL;
+	}
+	ctxt.dir_metablks = metablks_count;
+
+	return 0;
+}
+
+/*
+ * Opens a directory stream which borrows the tables from the context, so must
+ * be closed with sqfs_closedir_cached() before the filesystem is closed
+ */
+static int sqfs_opendir_cached(const char *filename,
+			       struct fs_dir_stream **dirsp)
+{
+	int j, token_count = 0, ret = 0;
 	struct squashfs_dir_stream *dirs;
 	char **token_list = NULL, *path = NULL;
-	u32 *pos_list = NULL;
 
 	dirs = calloc(1, sizeof(*dirs));
 	if (!dirs)
@@ -897,17 +997,9 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	dirs->inode_table = NULL;
 	dirs->dir_table = NULL;
 
-	ret = sqfs_read_inode_table(&inode_table);
-	if (ret) {
-		ret = -EINVAL;
-		goto out;
-	}
-
-	metablks_count = sqfs_read_directory_table(&dir_table, &pos_list);
-	if (metablks_count < 1) {
-		ret = -EINVAL;
+	ret = sqfs_get_tables();
+	if (ret)
 		goto out;
-	}
 
 	/* Tokenize filename */
 	token_count = sqfs_count_tokens(filename);
@@ -936,10 +1028,10 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	 * ldir's (extended directory) size is greater than dir, so it works as
 	 * a general solution for the malloc size, since 'i' is a union.
 	 */
-	dirs->inode_table = inode_table;
-	dirs->dir_table = dir_table;
-	ret = sqfs_search_dir(dirs, token_list, token_count, pos_list,
-			      metablks_count);
+	dirs->inode_table = ctxt.inode_table;
+	dirs->dir_table = ctxt.dir_table;
+	ret = sqfs_search_dir(dirs, token_list, token_count,
+			      ctxt.dir_pos_list, ctxt.dir_metablks);
 	if (ret)
 		goto out;
 
@@ -963,16 +1055,53 @@ out:
 	for (j = 0; j < token_count; j++)
 		free(token_list[j]);
 	free(token_list);
-	free(pos_list);
 	free(path);
-	if (ret) {
-		free(inode_table);
+	if (ret)
 		free(dirs);
-	}
 
 	return ret;
 }
 
+static void sqfs_closedir_cached(struct fs_dir_stream *dirs)
+{
+	struct squashfs_dir_stream *sqfs_dirs;
+
+	if (!dirs)
+		return;
+
+	sqfs_dirs = (struct squashfs_dir_stream *)dirs;
+	free(sqfs_dirs->dir_header);
+	free(sqfs_dirs);
+}
+
+int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct squashfs_dir_stream *dirs;
+	int ret;
+
+	ret = sqfs_opendir_cached(filename, dirsp);
+	if (ret)
+		return ret;
+
+	/*
+	 * fs_opendir() closes the filesystem straight away, so the stream needs
+	 * its own copy of the tables
+	 */
+	dirs = (struct squashfs_dir_stream *)*dirsp;
+	dirs->inode_table = memdup(ctxt.inode_table, ctxt.inode_metablks *
+				   SQFS_METADATA_BLOCK_SIZE);
+	dirs->dir_table = memdup(ctxt.dir_table, ctxt.dir_metablks *
+				 SQFS_METADATA_BLOCK_SIZE);
+	if (!dirs->inode_table || !dirs->dir_table) {
+		sqfs_closedir(*dirsp);
+		*dirsp = NULL;
+		return -ENOMEM;
+	}
+	dirs->table = dirs->dir_table + (dirs->table - ctxt.dir_table);
+
+	return 0;
+}
+
 int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
 {
 	struct squashfs_super_block *sblk = ctxt.sblk;
@@ -1088,6 +1217,35 @@ int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
 	return 0;
 }
 
+static void sqfs_cache_free(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ctxt.cache); i++)
+		free(ctxt.cache[i].data);
+	memset(ctxt.cache, '\0', sizeof(ctxt.cache));
+	free(ctxt.inode_table);
+	free(ctxt.dir_table);
+	free(ctxt.dir_pos_list);
+	ctxt.inode_table = NULL;
+	ctxt.dir_table = NULL;
+	ctxt.dir_pos_list = NULL;
+}
+
+/* Drop the tables and cache entries if they came from another filesystem */
+static void sqfs_check_cache(void)
+{
+	if (ctxt.cache_dev == ctxt.cur_dev &&
+	    ctxt.cache_start == ctxt.cur_part_info.start &&
+	    !memcmp(&ctxt.cache_sblk, ctxt.sblk, sizeof(ctxt.cache_sblk)))
+		return;
+
+	sqfs_cache_free();
+	ctxt.cache_dev = ctxt.cur_dev;
+	ctxt.cache_start = ctxt.cur_part_info.start;
+	ctxt.cache_sblk = *ctxt.sblk;
+}
+
 int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition)
 {
 	struct squashfs_super_block *sblk;
@@ -1113,6 +1271,7 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 	if (ret) {
 		goto error;
 	}
+	sqfs_check_cache();
 
 	return 0;
 error:
@@ -1317,15 +1476,74 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 	return datablk_count;
 }
 
+/*
+ * Gets the fragment block described by @e, decompressed if @comp is true,
+ * through the cache. The entry is only valid until the next block is added to
+ * the cache.
+ */
+static int sqfs_get_fragment(struct squashfs_fragment_block_entry *e,
+			     bool comp, struct sqfs_cache_entry **entp)
+{
+	u64 start, n_blks, table_size, table_offset;
+	char *fragment, *fragment_block;
+	unsigned long dest_len;
+	int ret;
+
+	*entp = sqfs_cache_find(e->start);
+	if (*entp)
+		return 0;
+
+	start = lldiv(e->start, ctxt.cur_dev->blksz);
+	table_size = SQFS_BLOCK_SIZE(e->size);
+	table_offset = e->start - (start * ctxt.cur_dev->blksz);
+	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
+
+	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+	if (!fragment)
+		return -ENOMEM;
+
+	ret = sqfs_disk_read(start, n_blks, fragment);
+	if (ret < 0)
+		goto out;
+
+	dest_len = comp ? get_unaligned_le32(&ctxt.sblk->block_size) :
+		table_size;
+	fragment_block = malloc(dest_len);
+	if (!fragment_block) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (comp) {
+		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
+				      fragment + table_offset, table_size);
+		if (ret) {
+			free(fragment_block);
+			goto out;
+		}
+	} else {
+		memcpy(fragment_block, fragment + table_offset, table_size);
+	}
+
+	*entp = sqfs_cache_add(e->start, fragment_block, dest_len);
+	ret = 0;
+
+out:
+	free(fragment);
+
+	return ret;
+}
+
 int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	      loff_t *actread)
 {
-	char *dir = NULL, *fragment_block, *datablock = NULL;
-	char *fragment = NULL, *file = NULL, *resolved, *data;
+	char *dir = NULL, *datablock = NULL;
+	char *file = NULL, *resolved, *data;
 	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
 	int ret, j, i_number, datablk_count = 0;
 	struct squashfs_super_block *sblk = ctxt.sblk;
 	struct squashfs_fragment_block_entry frag_entry;
+	struct sqfs_cache_entry *ent;
 	struct squashfs_file_info finfo = {0};
 	struct squashfs_symlink_inode *symlink;
 	struct fs_dir_stream *dirsp = NULL;
@@ -1352,7 +1570,7 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	 * return a pointer to the directory that contains the requested file.
 	 */
 	sqfs_split_path(&file, &dir, filename);
-	ret = sqfs_opendir(dir, &dirsp);
+	ret = sqfs_opendir_cached(dir, &dirsp);
 	if (ret) {
 		goto out;
 	}
@@ -1526,58 +1744,24 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 		goto out;
 	}
 
-	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
-	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
-
-	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-	if (!fragment) {
-		ret = -ENOMEM;
+	ret = sqfs_get_fragment(&frag_entry, finfo.comp, &ent);
+	if (ret)
 		goto out;
-	}
 
-	ret = sqfs_disk_read(start, n_blks, fragment);
-	if (ret < 0)
+	if (finfo.offset + finfo.size - *actread > ent->size) {
+		ret = -EINVAL;
 		goto out;
-
-	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
-		fragment_block = malloc(dest_len);
-		if (!fragment_block) {
-			ret = -ENOMEM;
-			goto out;
-		}
-
-		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
-				      (void *)fragment  + table_offset,
-				      frag_entry.size);
-		if (ret) {
-			free(fragment_block);
-			goto out;
-		}
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-
-		free(fragment_block);
-
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
 	}
 
+	memcpy(buf + *actread, ent->data + finfo.offset, finfo.size - *actread);
+	*actread = finfo.size;
+
 out:
-	free(fragment);
 	free(datablock);
 	free(file);
 	free(dir);
 	free(finfo.blk_sizes);
-	sqfs_closedir(dirsp);
+	sqfs_closedir_cached(dirsp);
 
 	return ret;
 }
@@ -1601,7 +1785,7 @@ int sqfs_size(const char *filename, loff_t *size)
 	 * sqfs_opendir will uncompress inode and directory tables, and will
 	 * return a pointer to the directory that contains the requested file.
 	 */
-	ret = sqfs_opendir(dir, &dirsp);
+	ret = sqfs_opendir_cached(dir, &dirsp);
 	if (ret) {
 		ret = -EINVAL;
 		goto free_strings;
@@ -1666,7 +1850,7 @@ free_strings:
 	free(dir);
 	free(file);
 
-	sqfs_closedir(dirsp);
+	sqfs_closedir_cached(dirsp);
 
 	return ret;
 }
@@ -1684,7 +1868,7 @@ int sqfs_exists(const char *filename)
 	 * sqfs_opendir will uncompress inode and directory tables, and will
 	 * return a pointer to the directory that contains the requested file.
 	 */
-	ret = sqfs_opendir(dir, &dirsp);
+	ret = sqfs_opendir_cached(dir, &dirsp);
 	if (ret) {
 		ret = -EINVAL;
 		goto free_strings;
@@ -1700,7 +1884,7 @@ int sqfs_exists(const char *filename)
 		dirs->entry = NULL;
 	}
 
-	sqfs_closedir(dirsp);
+	sqfs_closedir_cached(dirsp);
 
 free_strings:
 	free(dir);
@@ -1717,6 +1901,12 @@ void sqfs_close(void)
 	ctxt.cur_dev = NULL;
 }
 
+void sqfs_cache_stats(struct squashfs_cache_stats *stats)
+{
+	*stats = ctxt.stats;
+	memset(&ctxt.stats, '\0', sizeof(ctxt.stats));
+}
+
 void sqfs_closedir(struct fs_dir_stream *dirs)
 {
 	struct squashfs_dir_stream *sqfs_dirs;
@@ -1727,6 +1917,5 @@ void sqfs_closedir(struct fs_dir_stream *dirs)
 	sqfs_dirs = (struct squashfs_dir_stream *)dirs;
 	free(sqfs_dirs->inode_table);
 	free(sqfs_dirs->dir_table);
-	free(sqfs_dirs->dir_header);
-	free(sqfs_dirs);
+	sqfs_closedir_cached(dirs);
 }
@@ -128,6 +128,7 @@ int sqfs_decompress(struct squashfs_ctxt *ctxt, void *dest,
 	u16 comp_type = get_unaligned_le16(&ctxt->sblk->compression);
 	int ret = 0;
 
+	ctxt->stats.decompressions++;
 	switch (comp_type) {
 #if IS_ENABLED(CONFIG_LZO)
 	case SQFS_COMP_LZO: {
@@ -11,6 +11,7 @@
 #include <asm/unaligned.h>
 #include <fs.h>
 #include <part.h>
+#include <squashfs.h>
 #include <stdint.h>
 
 #define SQFS_MAGIC_NUMBER 0x73717368
@@ -71,6 +72,44 @@ struct squashfs_super_block {
 	__le64 export_table_start;
 };
 
+/**
+ * struct sqfs_cache_entry - A decompressed block held in the cache
+ *
+ * @start: byte offset of the block on the disk
+ * @data: decompressed contents, NULL if the entry is free
+ * @size: number of bytes in @data
+ * @stamp: value of the cache clock when the entry was last used
+ */
+struct sqfs_cache_entry {
+	u64 start;
+	void *data;
+	u32 size;
+	u32 stamp;
+};
+
+/**
+ * struct squashfs_ctxt - State of the mounted filesystem
+ *
+ * @cur_part_info: partition holding the filesystem
+ * @cur_dev: device holding the filesystem
+ * @sblk: superblock
+ * @zstd_workspace: workspace for the zstd decompressor
+ * @inode_table: decompressed inode table, NULL until first needed
+ * @inode_metablks: number of metadata blocks in the inode table
+ * @dir_table: decompressed directory table
+ * @dir_pos_list: end offset of each metadata block in the directory table
+ * @dir_metablks: number of metadata blocks in the directory table
+ * @cache: fragment blocks and fragment table metadata blocks, decompressed
+ * @cache_clock: incremented on each use of a cache entry
+ * @stats: cache and decompressor statistics
+ * @cache_dev: device which the tables and cache entries were read from
+ * @cache_start: start of the partition they were read from
+ * @cache_sblk: superblock of the filesystem they were read from
+ *
+ * Every command closes the filesystem, so the tables and cache entries are
+ * kept across sqfs_close(). They are dropped when a different device,
+ * partition or superblock is probed.
+ */
 struct squashfs_ctxt {
 	struct disk_partition cur_part_info;
 	struct blk_desc *cur_dev;
@@ -78,6 +117,17 @@ struct squashfs_ctxt {
 #if IS_ENABLED(CONFIG_ZSTD)
 	void *zstd_workspace;
 #endif
+	unsigned char *inode_table;
+	int inode_metablks;
+	unsigned char *dir_table;
+	u32 *dir_pos_list;
+	int dir_metablks;
+	struct sqfs_cache_entry cache[CONFIG_SQUASHFS_CACHE_BLOCKS];
+	u32 cache_clock;
+	struct squashfs_cache_stats stats;
+	struct blk_desc *cache_dev;
+	lbaint_t cache_start;
+	struct squashfs_super_block cache_sblk;
 };
 
 struct squashfs_directory_index {
@@ -271,8 +321,9 @@ struct squashfs_dir_stream {
 	struct squashfs_dir_inode i_dir;
 	struct squashfs_ldir_inode i_ldir;
 	/*
-	 * References to the tables' beginnings. They are assigned in
-	 * sqfs_opendir() and freed in sqfs_closedir().
+	 * References to the tables' beginnings. Internal streams borrow the
+	 * context's tables, while sqfs_opendir() gives its streams copies which
+	 * are freed in sqfs_closedir().
 	 */
 	unsigned char *inode_table;
 	unsigned char *dir_table;
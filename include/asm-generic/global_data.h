@@ -231,6 +231,13 @@ struct global_data {
 	 */
 	void *dm_priv_base;
 # endif
+# if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+	/**
+	 * @dm_compat_hash: Hash table mapping compatible strings to drivers,
+	 * NULL if not yet built, or an error pointer if it cannot be built
+	 */
+	struct lists_compat_hash *dm_compat_hash;
+# endif
 #endif
 #ifdef CONFIG_TIMER
 	/**
@@ -542,6 +549,14 @@ static_assert(sizeof(struct global_data) == GD_SIZE);
 #define gd_dm_priv_base()		NULL
 #endif
 
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+#define gd_set_dm_compat_hash(tab)	gd->dm_compat_hash = tab
+#define gd_dm_compat_hash()		gd->dm_compat_hash
+#else
+#define gd_set_dm_compat_hash(tab)
+#define gd_dm_compat_hash()		NULL
+#endif
+
 #ifdef CONFIG_ACPI
 #define gd_acpi_ctx()		gd->acpi_ctx
 #define gd_acpi_start()		gd->acpi_start
@@ -140,6 +140,29 @@ void blkcache_fill(int iftype, int dev,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer);
 
+/**
+ * blkcache_readahead() - check whether a read should be extended
+ *
+ * This is called after blkcache_read() misses. If the read continues a
+ * sequential stream of reads from the device, the number of blocks to read
+ * ahead is returned and the caller should read @blkcnt plus that many blocks
+ * into the buffer returned in @bufp, then pass all of it to blkcache_fill().
+ * The read-ahead grows while the reader stays sequential.
+ *
+ * @iftype - uclass_id_x for type of device
+ * @dev - device index of particular type
+ * @start - starting block number
+ * @blkcnt - number of blocks requested
+ * @blksz - size in bytes of each block
+ * @lba - number of blocks on the device
+ * @bufp - returns a buffer large enough for the extended read
+ *
+ * Return: number of blocks to read after @start + @blkcnt, 0 for none
+ */
+lbaint_t blkcache_readahead(int iftype, int dev,
+			    lbaint_t start, lbaint_t blkcnt,
+			    unsigned long blksz, lbaint_t lba, void **bufp);
+
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
@@ -149,13 +172,27 @@ void blkcache_fill(int iftype, int dev,
  */
 void blkcache_invalidate(int iftype, int dev);
 
+/**
+ * blkcache_remove() - forget a block device which is going away
+ *
+ * This discards the device's blocks and read-ahead state. The cache memory is
+ * freed if no other device has anything cached.
+ *
+ * @iftype - UCLASS_ID_ for type of device
+ * @dev - device index of particular type
+ */
+void blkcache_remove(int iftype, int dev);
+
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * The cache is emptied if its size changes. If the cache memory could not be
+ * allocated, this allows another attempt.
+ *
+ * @param size - cache size in bytes, 0 to disable the cache
+ * @param readahead - maximum sequential read-ahead in bytes, 0 to disable it
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(ulong size, ulong readahead);
 
 /*
  * statistics of the block cache
@@ -163,9 +200,12 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
-	unsigned entries; /* current entry count */
-	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned readaheads; /* reads extended by read-ahead */
+	unsigned readahead_blocks; /* blocks read ahead */
+	unsigned entries; /* current line count */
+	unsigned max_entries; /* lines allocated, 0 until first use */
+	ulong size; /* cache size in bytes */
+	ulong max_readahead; /* maximum read-ahead in bytes */
 };
 
 /**
@@ -191,8 +231,18 @@ static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
 
+static inline lbaint_t blkcache_readahead(int iftype, int dev,
+					  lbaint_t start, lbaint_t blkcnt,
+					  unsigned long blksz, lbaint_t lba,
+					  void **bufp)
+{
+	return 0;
+}
+
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
+static inline void blkcache_remove(int iftype, int dev) {}
+
 static inline void blkcache_free(void) {}
 
 #endif
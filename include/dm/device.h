@@ -112,6 +112,22 @@ enum {
 	DM_REMOVE_NO_PD		= 1 << 1,
 };
 
+/**
+ * enum uclass_hash_key - Keys by which a uclass indexes its devices
+ *
+ * @UCLASS_HASH_OFNODE: Device tree node of the device
+ * @UCLASS_HASH_SEQ: Sequence number of the device
+ * @UCLASS_HASH_PHANDLE: Phandle of the device tree node of the device
+ * @UCLASS_HASH_COUNT: Number of keys
+ */
+enum uclass_hash_key {
+	UCLASS_HASH_OFNODE,
+	UCLASS_HASH_SEQ,
+	UCLASS_HASH_PHANDLE,
+
+	UCLASS_HASH_COUNT,
+};
+
 /**
  * struct udevice - An instance of a driver
  *
@@ -166,6 +182,11 @@ enum {
  * @dma_offset: Offset between the physical address space (CPU's) and the
  *		device's bus address space
  * @iommu: IOMMU device associated with this device
+ * @uclass_hash_: Used by uclass to index the device by each of its keys
+ * @probe_us: Time taken to probe this device in microseconds, not counting
+ *	its parents or other devices probed along the way. This is 0 if the
+ *	device has not been probed since relocation.
+ *	(do not access outside driver model)
  */
 struct udevice {
 	const struct driver *driver;
@@ -198,6 +219,12 @@ struct udevice {
 #if CONFIG_IS_ENABLED(IOMMU)
 	struct udevice *iommu;
 #endif
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct hlist_node uclass_hash_[UCLASS_HASH_COUNT];
+#endif
+#if CONFIG_IS_ENABLED(DM_PROBE_TIME)
+	ulong probe_us;
+#endif
 };
 
 static inline int dm_udevice_size(void)
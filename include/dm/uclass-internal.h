@@ -259,6 +259,20 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
  */
 int uclass_bind_device(struct udevice *dev);
 
+/**
+ * uclass_rehash_device() - Update the index after a device's keys change
+ *
+ * This must be called if the sequence number or device tree node of a bound
+ * device changes, so that it can still be found by them.
+ *
+ * @dev:	Pointer to the device
+ */
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+void uclass_rehash_device(struct udevice *dev);
+#else
+static inline void uclass_rehash_device(struct udevice *dev) {}
+#endif
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * uclass_pre_unbind_device() - Prepare to deassociate device with a uclass
@@ -66,6 +66,14 @@ void dm_dump_static_driver_info(void);
  */
 void dm_dump_mem(struct dm_stats *stats);
 
+/**
+ * dm_dump_probe_time() - Dump the time taken to probe each device
+ *
+ * Devices are listed with the longest probe first. The total for each device
+ * includes the devices below it in the tree.
+ */
+void dm_dump_probe_time(void);
+
 #if CONFIG_IS_ENABLED(OF_PLATDATA_INST) && CONFIG_IS_ENABLED(READ_ONLY)
 void *dm_priv_to_rw(void *priv);
 #else
@@ -120,10 +120,23 @@ struct ext_filesystem {
 	struct blk_desc *dev_desc;
 };
 
+/**
+ * struct ext_block_cache - Lookup cache used while reading a file
+ *
+ * @buf: extent tree block last read, or NULL
+ * @block: sector number of @buf
+ * @size: size of @buf in bytes
+ * @run_start: first file block of the run last found
+ * @run_len: number of blocks in the run, 0 if none
+ * @run_blknr: filesystem block holding @run_start, 0 for a hole
+ */
 struct ext_block_cache {
 	char *buf;
 	lbaint_t block;
 	int size;
+	int run_start;
+	int run_len;
+	long int run_blknr;
 };
 
 extern struct ext2_data *ext4fs_root;
@@ -158,6 +171,9 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, struct disk_partition *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
+long int read_allocated_run(struct ext2_inode *inode, int fileblock,
+			    int maxcount, struct ext_block_cache *cache,
+			    int *countp);
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 struct disk_partition *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
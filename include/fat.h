@@ -25,7 +25,12 @@ struct disk_partition;
 #define DIRENTSPERCLUST	((mydata->clust_size * mydata->sect_size) / \
 			 sizeof(dir_entry))
 
+/* A multiple of 3 sectors, so that FAT12 entries never straddle the buffer */
+#if CONFIG_IS_ENABLED(FS_FAT)
+#define FATBUFBLOCKS	CONFIG_VAL(FS_FAT_BUF_SECTORS)
+#else
 #define FATBUFBLOCKS	6
+#endif
 #define FATBUFSIZE	(mydata->sect_size * FATBUFBLOCKS)
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
@@ -163,6 +168,7 @@ typedef struct dir_slot {
  */
 typedef struct {
 	__u8	*fatbuf;	/* Current FAT buffer */
+	__u8	*bouncebuf;	/* For misaligned reads, allocated on first use */
 	int	fatsize;	/* Size of FAT in bits */
 	__u32	fatlength;	/* Length of FAT in sectors */
 	__u16	fat_sect;	/* Starting sector of the FAT */
@@ -52,18 +52,24 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
  *	gzwrite_progress_init called on startup
  *	gzwrite_progress called during decompress/write loop
  *	gzwrite_progress_finish called at end of loop to
- *		indicate success (retcode=0) or failure
+ *		indicate success (retcode=0) or failure. @check_crc is
+ *		false if there was no expected CRC to compare against,
+ *		as for zstd images
  */
 void gzwrite_progress_init(ulong expected_size);
 
 void gzwrite_progress(int iteration, ulong bytes_written, ulong total_bytes);
 
 void gzwrite_progress_finish(int retcode, ulong totalwritten, ulong totalsize,
-			     u32 expected_crc, u32 calculated_crc);
+			     u32 expected_crc, u32 calculated_crc,
+			     bool check_crc);
 
 /**
  * gzwrite() - decompress and write gzipped image from memory to block device
  *
+ * A zstd-compressed image is also accepted if CONFIG_ZSTD is enabled. Its
+ * size is then taken from the frame header, if present.
+ *
  * @src:	compressed image address
  * @len:	compressed image length in bytes
  * @dev:	block device descriptor
@@ -149,6 +149,19 @@ int hash_lookup_algo(const char *algo_name, struct hash_algo **algop);
 int hash_progressive_lookup_algo(const char *algo_name,
 				 struct hash_algo **algop);
 
+/**
+ * hash_get_algo() - Get the hash_algo struct at a position in the table
+ *
+ * This allows all available algorithms to be listed, by calling it with
+ * @index starting at 0 until it fails.
+ *
+ * @index: Position in the table of algorithms
+ * @algop: Pointer to the hash_algo struct if found
+ *
+ * Return: 0 if ok, -ENOENT if @index is past the end of the table
+ */
+int hash_get_algo(int index, struct hash_algo **algop);
+
 /**
  * hash_parse_string() - Parse hash string into a binary array
  *
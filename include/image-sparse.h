@@ -11,10 +11,29 @@
 
 #define ROUNDUP(x, y)	(((x) + ((y) - 1)) & ~((y) - 1))
 
+/**
+ * struct sparse_storage - Storage that a sparse image is written to
+ *
+ * @blksz: Block size of the storage in bytes
+ * @start: First block to write
+ * @size: Number of blocks available
+ * @erase_blks: Granularity of @erase in blocks
+ * @priv: Private data for the callbacks
+ * @write: Write @blkcnt blocks from @buffer, returning the number of blocks
+ *	used (which may be more than @blkcnt if bad blocks were skipped)
+ * @reserve: Skip over @blkcnt blocks which are not written, returning the
+ *	number of blocks used
+ * @erase: Optional. Erase @blkcnt blocks so that they read back as zero,
+ *	returning @blkcnt on success. @blk and @blkcnt are always a multiple of
+ *	@erase_blks. This is used in place of writing zeroes, where it is
+ *	quicker
+ * @mssg: Report a failure to the user, may be NULL
+ */
 struct sparse_storage {
 	lbaint_t	blksz;
 	lbaint_t	start;
 	lbaint_t	size;
+	lbaint_t	erase_blks;
 	void		*priv;
 
 	lbaint_t	(*write)(struct sparse_storage *info,
@@ -26,6 +45,10 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+
 	void		(*mssg)(const char *str, char *response);
 };
 
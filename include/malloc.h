@@ -895,6 +895,71 @@ void malloc_enable_testing(int max_allocs);
 /** malloc_disable_testing() - Put malloc() into normal mode */
 void malloc_disable_testing(void);
 
+/**
+ * struct malloc_info - Summary of the state of the heap
+ *
+ * @total: bytes taken from the malloc() area so far
+ * @peak: highest value @total has reached
+ * @in_use: bytes in allocated chunks, including their overhead
+ * @free: bytes in free chunks, including the top of the heap
+ * @cached: bytes held by the small-object front-end (SYS_MALLOC_SLAB)
+ * @free_chunks: number of free chunks
+ * @largest_free: size of the largest free chunk in bytes
+ */
+struct malloc_info {
+	ulong total;
+	ulong peak;
+	ulong in_use;
+	ulong free;
+	ulong cached;
+	ulong free_chunks;
+	ulong largest_free;
+};
+
+/**
+ * struct malloc_class_stats - Statistics for a small-object size class
+ *
+ * @size: chunk size of the class in bytes, including overhead
+ * @allocs: number of allocations of this size
+ * @hits: number of those satisfied from the free list
+ * @frees: number of chunks put on the free list
+ * @cached: number of chunks currently on the free list
+ */
+struct malloc_class_stats {
+	ulong size;
+	ulong allocs;
+	ulong hits;
+	ulong frees;
+	ulong cached;
+};
+
+/**
+ * malloc_get_info() - Get a summary of the state of the heap
+ *
+ * @info: Returns the information
+ */
+void malloc_get_info(struct malloc_info *info);
+
+/**
+ * malloc_get_class_stats() - Get statistics for a small-object size class
+ *
+ * @index: Index of the class, starting at 0 for the smallest
+ * @stats: Returns the statistics
+ * Return: 0 if OK, -ENOENT if @index is past the last class or the
+ * front-end is not enabled
+ */
+int malloc_get_class_stats(int index, struct malloc_class_stats *stats);
+
+/**
+ * malloc_slab_enable() - Turn the small-object front-end on or off
+ *
+ * Chunks held by the front-end are always given back to the heap, so this
+ * can also be used to flush it. This does nothing without SYS_MALLOC_SLAB.
+ *
+ * @enable: true to use the front-end, false to bypass it
+ */
+void malloc_slab_enable(bool enable);
+
 #if CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
 #define malloc malloc_simple
 #define realloc realloc_simple
@@ -143,6 +143,17 @@ enum eth_recv_flags {
 	ETH_RECV_CHECK_DEVICE		= 1 << 0,
 };
 
+/**
+ * struct eth_rx_pkt - A received packet, as returned by recv_batch()
+ *
+ * @packet: Start of the packet, from the Ethernet header
+ * @length: Length of the packet in bytes
+ */
+struct eth_rx_pkt {
+	uchar *packet;
+	int length;
+};
+
 /**
  * struct eth_ops - functions of Ethernet MAC controllers
  *
@@ -153,6 +164,12 @@ enum eth_recv_flags {
  *	 indicate that the hardware receive FIFO is empty. If 0 is returned, the
  *	 network stack will not process the empty packet, but free_pkt() will be
  *	 called if supplied
+ * recv_batch: Return up to "count" received packets at once in "pkts", giving
+ *	       the number returned, 0 if there are none, or an error. The packets
+ *	       stay valid until the next call to recv_batch(), which is when the
+ *	       driver can take their buffers back, so free_pkt() is not called
+ *	       for them. When supplied this is used instead of recv(), which
+ *	       must still be provided for DSA - optional
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
  *	     called when no error was returned from recv - optional
@@ -177,6 +194,8 @@ struct eth_ops {
 	int (*start)(struct udevice *dev);
 	int (*send)(struct udevice *dev, void *packet, int length);
 	int (*recv)(struct udevice *dev, int flags, uchar **packetp);
+	int (*recv_batch)(struct udevice *dev, int flags,
+			  struct eth_rx_pkt *pkts, int count);
 	int (*free_pkt)(struct udevice *dev, uchar *packet, int length);
 	void (*stop)(struct udevice *dev);
 	int (*mcast)(struct udevice *dev, const u8 *enetaddr, int join);
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Decompress files as they are downloaded
+ */
+
+#ifndef __NET_DECOMPRESS_H
+#define __NET_DECOMPRESS_H
+
+#include <linux/errno.h>
+#include <linux/sizes.h>
+#include <linux/types.h>
+
+/*
+ * Room for data received ahead of a gap. Protocols which let the server send
+ * ahead should not allow it to send more than this while decompressing.
+ */
+#define NET_DECOMP_HOLD_SIZE	SZ_256K
+
+#if CONFIG_IS_ENABLED(NET_DECOMPRESS)
+
+/**
+ * net_decomp_enabled() - check whether downloads are to be decompressed
+ *
+ * Return: true if the netdecompress environment variable is set to yes
+ */
+bool net_decomp_enabled(void);
+
+/**
+ * net_decomp_start() - get ready to receive a file
+ * @addr: address where the uncompressed data goes
+ * @size: space at @addr, 0 for no limit
+ *
+ * Drop any file which was being decompressed and, if decompression is
+ * enabled, decompress the next file to @addr. The compression format is
+ * found from the start of the file; a file in none of the formats supported
+ * is stored as it is.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int net_decomp_start(ulong addr, ulong size);
+
+/**
+ * net_decomp_active() - check whether a file is being decompressed
+ *
+ * Return: true if data received must be passed to net_decomp_write()
+ */
+bool net_decomp_active(void);
+
+/**
+ * net_decomp_write() - pass part of the file to the decompressor
+ * @offset: offset of the data in the file
+ * @src: data
+ * @len: length of the data
+ *
+ * Data may be passed in any order and more than once. Data which comes
+ * after a part not yet received is held back, as long as there is room.
+ *
+ * Return: 0 if OK, -ENOSPC if the data could not be held back and must be
+ * sent again later, other -ve value if the file cannot be decompressed
+ */
+int net_decomp_write(ulong offset, const void *src, ulong len);
+
+/**
+ * net_decomp_finish() - finish decompressing a file
+ * @sizep: returns the size of the uncompressed data
+ *
+ * Return: 0 if OK, -ve if the file was incomplete or corrupt
+ */
+int net_decomp_finish(ulong *sizep);
+
+/**
+ * net_decomp_abort() - stop decompressing a file and free its resources
+ */
+void net_decomp_abort(void);
+
+#else
+
+static inline bool net_decomp_enabled(void)
+{
+	return false;
+}
+
+static inline int net_decomp_start(ulong addr, ulong size)
+{
+	return 0;
+}
+
+static inline bool net_decomp_active(void)
+{
+	return false;
+}
+
+static inline int net_decomp_write(ulong offset, const void *src, ulong len)
+{
+	return -ENOSYS;
+}
+
+static inline int net_decomp_finish(ulong *sizep)
+{
+	return -ENOSYS;
+}
+
+static inline void net_decomp_abort(void)
+{
+}
+
+#endif
+
+#endif /* __NET_DECOMPRESS_H */
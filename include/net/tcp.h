@@ -86,7 +86,8 @@ struct ip_tcp_hdr {
 #define TCP_OPT_LEN_8	0x08
 #define TCP_OPT_LEN_A	0x0a		/* Timestamp Length		*/
 #define TCP_MSS		1460		/* Max segment size		*/
-#define TCP_SCALE	0x01		/* Scale			*/
+#define TCP_MAX_SCALE	14		/* Max window scale (RFC 7323)	*/
+#define TCP_DELACK_TIMEOUT	200UL	/* Max ACK delay in ms		*/
 
 /**
  * struct tcp_mss - TCP option structure for MSS (Max segment size)
@@ -298,6 +299,16 @@ typedef void rxhand_tcp(uchar *pkt, u16 dport,
 			u32 tcp_seq_num, u32 tcp_ack_num,
 			u8 action, unsigned int len);
 void tcp_set_tcp_handler(rxhand_tcp *f);
+bool tcp_delay_ack(void);
+
+/**
+ * tcp_limit_rx_window() - limit the receive window of later connections
+ * @max: largest window to advertise in bytes, 0 for no limit
+ *
+ * This is for an application which cannot take in more than a certain amount
+ * of data ahead of what it has acknowledged. It applies from the next SYN.
+ */
+void tcp_limit_rx_window(ulong max);
 
 void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int len);
 
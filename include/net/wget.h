@@ -8,6 +8,33 @@
  */
 void wget_start(void);
 
+/**
+ * wget_set_resume() - resume the next download
+ * @resume: true to ask only for the part of the file not yet received
+ *
+ * If the next file is loaded to the address held in fileaddr, the first
+ * filesize bytes there are kept and the rest is requested from the server.
+ */
+void wget_set_resume(bool resume);
+
+/**
+ * wget_add_file() - fetch another file after the first one
+ * @addr: load address of the file
+ * @path: path of the file on the server of the first file
+ *
+ * The files are fetched in turn, over the same connection if the server
+ * allows it.
+ *
+ * Return: 0 on success, -ENOSPC if too many files were added, -ENOMEM if
+ * out of memory
+ */
+int wget_add_file(ulong addr, const char *path);
+
+/**
+ * wget_clear_files() - forget the files added and the resume request
+ */
+void wget_clear_files(void);
+
 enum wget_state {
 	WGET_CLOSED,
 	WGET_CONNECTING,
@@ -19,3 +46,4 @@ enum wget_state {
 #define DEBUG_WGET		0	/* Set to 1 for debug messages */
 #define WGET_RETRY_COUNT	30
 #define WGET_TIMEOUT		2000UL
+#define WGET_MAX_FILES		8	/* Files fetched after the first one */
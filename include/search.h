@@ -47,6 +47,8 @@ struct hsearch_data {
 	struct env_entry_node *table;
 	unsigned int size;
 	unsigned int filled;
+	/* the table must not be resized while this is non-zero */
+	unsigned int busy;
 /*
  * Callback function which will check whether the given change for variable
  * "item" to "newval" may be applied or not, and possibly apply such change.
@@ -103,6 +105,31 @@ int himport_r(struct hsearch_data *htab, const char *env, size_t size,
 	      const char sep, int flag, int crlf_is_lf, int nvars,
 	      char * const vars[]);
 
+/**
+ * struct hsearch_stats - Statistics about a hash table
+ *
+ * @size: Number of entries in the table
+ * @filled: Number of entries in use
+ * @deleted: Number of deleted entries, which still lengthen the search
+ * @probes: Total number of entries tried when looking up each entry in use
+ * @max_probes: Largest number of entries tried when looking up one entry
+ */
+struct hsearch_stats {
+	unsigned int size;
+	unsigned int filled;
+	unsigned int deleted;
+	unsigned int probes;
+	unsigned int max_probes;
+};
+
+/**
+ * hstats_r() - Get statistics about a hash table
+ *
+ * @htab: Hash table
+ * @stats: Returns the statistics
+ */
+void hstats_r(struct hsearch_data *htab, struct hsearch_stats *stats);
+
 /* Walk the whole table calling the callback on each element */
 int hwalk_r(struct hsearch_data *htab,
 	    int (*callback)(struct env_entry *entry));
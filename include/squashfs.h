@@ -12,6 +12,19 @@
 
 struct disk_partition;
 
+/**
+ * struct squashfs_cache_stats - Statistics for the SquashFS cache
+ *
+ * @hits: lookups of tables or blocks that were already decompressed
+ * @misses: lookups which needed tables or blocks to be read and decompressed
+ * @decompressions: calls to the decompressor, including for data blocks
+ */
+struct squashfs_cache_stats {
+	uint hits;
+	uint misses;
+	uint decompressions;
+};
+
 int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp);
 int sqfs_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp);
 int sqfs_probe(struct blk_desc *fs_dev_desc,
@@ -23,4 +36,11 @@ int sqfs_exists(const char *filename);
 void sqfs_close(void);
 void sqfs_closedir(struct fs_dir_stream *dirs);
 
+/**
+ * sqfs_cache_stats() - Get and reset the cache statistics
+ *
+ * @stats: Returns the statistics gathered since the last call
+ */
+void sqfs_cache_stats(struct squashfs_cache_stats *stats);
+
 #endif /* SQFS_H  */
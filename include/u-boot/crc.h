@@ -85,6 +85,50 @@ uint32_t crc32_wd(uint32_t crc, const unsigned char *buf, uint len,
  */
 uint32_t crc32_no_comp(uint32_t crc, const unsigned char *buf, uint len);
 
+/**
+ * enum crc32_engine - Implementations of crc32_no_comp()
+ *
+ * crc32_no_comp() picks the fastest engine available at runtime. The others
+ * can be selected explicitly with crc32_no_comp_engine(), e.g. for testing.
+ *
+ * @CRC32_ENGINE_TABLE: Byte-wise lookup in a single 256-entry table
+ * @CRC32_ENGINE_SLICE8: Slice-by-8 lookup, 8 bytes per step
+ *	(CONFIG_CRC32_SLICE_BY_8)
+ * @CRC32_ENGINE_ARMV8: ARMv8 CRC32 instructions (CONFIG_ARM64_CRC32), if the
+ *	CPU implements them
+ * @CRC32_ENGINE_COUNT: Number of engines
+ */
+enum crc32_engine {
+	CRC32_ENGINE_TABLE,
+	CRC32_ENGINE_SLICE8,
+	CRC32_ENGINE_ARMV8,
+
+	CRC32_ENGINE_COUNT,
+};
+
+/**
+ * crc32_engine_available() - Check whether a CRC32 engine can be used
+ *
+ * @engine: Engine to check
+ * Return: true if the engine is built in and supported by this CPU
+ */
+bool crc32_engine_available(enum crc32_engine engine);
+
+/**
+ * crc32_no_comp_engine() - Calculate the CRC32 with a particular engine
+ *
+ * This is the same as crc32_no_comp() but uses the given engine. If it is not
+ * available, the table engine is used instead.
+ *
+ * @engine: Engine to use
+ * @crc: Input crc to chain from a previous calculation
+ * @buf: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * Return: checksum value
+ */
+uint32_t crc32_no_comp_engine(enum crc32_engine engine, uint32_t crc,
+			      const unsigned char *buf, uint len);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
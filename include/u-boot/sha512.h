@@ -25,6 +25,16 @@ void sha512_finish(sha512_context * ctx, uint8_t digest[SHA512_SUM_LEN]);
 void sha512_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/*
+ * Run the compression function over whole blocks, for SHA-384 too. This is
+ * weak so that an architecture can accelerate it; sha512_base_process() is
+ * the generic version for it to fall back to.
+ */
+void sha512_process(sha512_context *ctx, const unsigned char *data,
+		    unsigned int blocks);
+void sha512_base_process(sha512_context *ctx, const unsigned char *data,
+			 unsigned int blocks);
+
 extern const uint8_t sha384_der_prefix[];
 
 void sha384_starts(sha512_context * ctx);
@@ -73,6 +73,22 @@ enum video_format {
 	VIDEO_X2R10G10B10,
 };
 
+/**
+ * struct vid_rect - A rectangular region of the frame buffer
+ *
+ * @xstart:	First pixel column in the region
+ * @ystart:	First pixel row in the region
+ * @xend:	Column after the last one in the region. The region is empty if
+ *		this is not greater than @xstart
+ * @yend:	Row after the last one in the region
+ */
+struct vid_rect {
+	int xstart;
+	int ystart;
+	int xend;
+	int yend;
+};
+
 /**
  * struct video_priv - Device information used by the video uclass
  *
@@ -97,6 +113,11 @@ enum video_format {
  *		the LCD is updated
  * @fg_col_idx:	Foreground color code (bit 3 = bold, bit 0-2 = color)
  * @bg_col_idx:	Background color code (bit 3 = bold, bit 0-2 = color)
+ * @damage:	Region which has changed since the last video_sync() (only
+ *		used with CONFIG_VIDEO_DAMAGE)
+ * @sync_bytes:	Number of frame-buffer bytes flushed (and copied to the copy
+ *		frame buffer) by the last video_sync()
+ * @sync_total:	Total number of bytes flushed by video_sync() since probing
  */
 struct video_priv {
 	/* Things set up by the driver: */
@@ -121,6 +142,9 @@ struct video_priv {
 	bool flush_dcache;
 	u8 fg_col_idx;
 	u8 bg_col_idx;
+	struct vid_rect damage;
+	ulong sync_bytes;
+	ulong sync_total;
 };
 
 /**
@@ -234,7 +258,8 @@ int video_fill(struct udevice *dev, u32 colour);
 /**
  * video_fill_part() - Erase a region
  *
- * Erase a rectangle of the display within the given bounds.
+ * Erase a rectangle of the display within the given bounds. The rectangle is
+ * clipped to the display.
  *
  * @dev:	Device to update
  * @xstart:	X start position in pixels from the left
@@ -341,7 +366,24 @@ void video_set_default_colors(struct udevice *dev, bool invert);
  */
 int video_default_font_height(struct udevice *dev);
 
-#ifdef CONFIG_VIDEO_COPY
+#if defined(CONFIG_VIDEO_COPY) || defined(CONFIG_VIDEO_DAMAGE)
+/**
+ * video_damage() - Record that a region of the frame buffer has changed
+ *
+ * With CONFIG_VIDEO_DAMAGE the region is added to the area which the next
+ * video_sync() flushes and copies. Otherwise the region is copied to the copy
+ * frame buffer straight away.
+ *
+ * The region is silently clipped to the display.
+ *
+ * @vid: Video device being updated
+ * @x: Left edge of the region, in pixels
+ * @y: Top edge of the region, in pixels
+ * @width: Width of the region, in pixels
+ * @height: Height of the region, in pixels
+ */
+void video_damage(struct udevice *vid, int x, int y, int width, int height);
+
 /**
  * vidconsole_sync_copy() - Sync back to the copy framebuffer
  *
@@ -349,6 +391,10 @@ int video_default_font_height(struct udevice *dev);
  * for a particular region. It should be called after the framebuffer is updated
  *
  * @from and @to can be in either order. The region between them is synced.
+ * With CONFIG_VIDEO_DAMAGE the region is recorded with video_damage() and the
+ * copy happens at the next video_sync(). A region covering more than one line
+ * is widened to the full width of the display; use video_damage() directly
+ * to be more precise.
  *
  * @dev: Vidconsole device being updated
  * @from: Start/end address within the framebuffer (->fb)
@@ -366,6 +412,11 @@ int video_sync_copy(struct udevice *dev, void *from, void *to);
  */
 int video_sync_copy_all(struct udevice *dev);
 #else
+static inline void video_damage(struct udevice *vid, int x, int y, int width,
+				int height)
+{
+}
+
 static inline int video_sync_copy(struct udevice *dev, void *from, void *to)
 {
 	return 0;
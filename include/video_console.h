@@ -527,7 +527,46 @@ void vidconsole_list_fonts(struct udevice *dev);
  */
 int vidconsole_get_font_size(struct udevice *dev, const char **name, uint *sizep);
 
-#ifdef CONFIG_VIDEO_COPY
+/**
+ * struct console_tt_cache_stats - Information about the TrueType glyph cache
+ *
+ * @size: Maximum number of bytes to use for cached glyphs, 0 if disabled
+ * @used: Number of bytes used by cached glyphs and the per-font tables
+ *	which index them
+ * @glyphs: Number of glyphs in the cache
+ * @hits: Number of characters drawn using a cached glyph
+ * @misses: Number of characters which had to be rendered
+ */
+struct console_tt_cache_stats {
+	uint size;
+	uint used;
+	uint glyphs;
+	ulong hits;
+	ulong misses;
+};
+
+/**
+ * console_truetype_set_cache_size() - Set the size of the glyph cache
+ *
+ * Glyphs are dropped, least-recently-used first, until the cache fits. If
+ * it still does not fit, the whole cache is dropped.
+ *
+ * @dev: TrueType console device
+ * @size: Maximum number of bytes to use for cached glyphs and their tables,
+ *	0 to disable the cache
+ */
+void console_truetype_set_cache_size(struct udevice *dev, uint size);
+
+/**
+ * console_truetype_get_cache_stats() - Get information about the glyph cache
+ *
+ * @dev: TrueType console device
+ * @stats: Returns the information
+ */
+void console_truetype_get_cache_stats(struct udevice *dev,
+				      struct console_tt_cache_stats *stats);
+
+#if defined(CONFIG_VIDEO_COPY) || defined(CONFIG_VIDEO_DAMAGE)
 /**
  * vidconsole_sync_copy() - Sync back to the copy framebuffer
  *
@@ -12,6 +12,9 @@
 #include <arpa/inet.h>
 #else
 #include <efi_loader.h>
+#ifdef CONFIG_ARM64_CRC32
+#include <asm/system.h>
+#endif
 #endif
 #include <compiler.h>
 #include <u-boot/crc.h>
@@ -29,6 +32,20 @@
 
 #define tole(x) cpu_to_le32(x)
 
+/*
+ * Slice-by-8 consumes eight bytes per step using eight 256-entry tables. The
+ * extra tables are derived from crc_table on first use, so only the byte-wise
+ * table needs to be stored in the image. The word loads assume the tables are
+ * in CPU order, which is only true on little-endian machines.
+ */
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#ifdef USE_HOSTCC
+#define CRC32_SLICE_BY_8
+#elif CONFIG_IS_ENABLED(CRC32_SLICE_BY_8)
+#define CRC32_SLICE_BY_8
+#endif
+#endif
+
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
 
 static int __efi_runtime_data crc_table_empty = 1;
@@ -82,7 +99,7 @@ static void __efi_runtime make_crc_table(void)
   }
   crc_table_empty = 0;
 }
-#elif !defined(CONFIG_ARM64_CRC32)
+#else
 /* ========================================================================
  * Table of CRC-32's of all single-byte values (made by make_crc_table)
  */
@@ -177,17 +194,9 @@ const uint32_t * ZEXPORT get_crc_table()
 
 /* ========================================================================= */
 
-/* No ones complement version. JFFS2 (and other things ?)
- * don't use ones compliment in their CRC calculations.
- */
-uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+static uint32_t __efi_runtime crc32_no_comp_table(uint32_t crc, const Bytef *buf,
+						  uInt len)
 {
-#ifdef CONFIG_ARM64_CRC32
-    crc = cpu_to_le32(crc);
-    while (len--)
-        crc = __builtin_aarch64_crc32b(crc, *buf++);
-    return le32_to_cpu(crc);
-#else
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
     size_t rem_len;
@@ -225,10 +234,155 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
     }
 
     return le32_to_cpu(crc);
+}
+
+#ifdef CRC32_SLICE_BY_8
+static int __efi_runtime_data crc_slice_empty = 1;
+/* crc_slice[k - 1][n] is the CRC of byte n followed by k zero bytes */
+static uint32_t __efi_runtime_data crc_slice[7][256];
+
+static void __efi_runtime make_crc_slice(void)
+{
+	uint32_t c;
+	int n, k;
+
+#ifdef CONFIG_DYNAMIC_CRC_TABLE
+	if (crc_table_empty)
+		make_crc_table();
 #endif
+	for (n = 0; n < 256; n++) {
+		c = crc_table[n];
+		for (k = 0; k < 7; k++) {
+			c = crc_table[c & 255] ^ (c >> 8);
+			crc_slice[k][n] = c;
+		}
+	}
+	crc_slice_empty = 0;
 }
+
+static uint32_t __efi_runtime crc32_no_comp_slice8(uint32_t crc,
+						   const Bytef *buf, uInt len)
+{
+	const uint32_t *tab = crc_table;
+	const uint32_t *b;
+	uint32_t one, two;
+
+	if (crc_slice_empty)
+		make_crc_slice();
+
+	for (; len && ((long)buf & 3); len--)
+		DO_CRC(*buf++);
+
+	b = (const uint32_t *)buf;
+	for (; len >= 8; len -= 8) {
+		one = *b++ ^ crc;
+		two = *b++;
+		crc = crc_slice[6][one & 255] ^
+		      crc_slice[5][(one >> 8) & 255] ^
+		      crc_slice[4][(one >> 16) & 255] ^
+		      crc_slice[3][one >> 24] ^
+		      crc_slice[2][two & 255] ^
+		      crc_slice[1][(two >> 8) & 255] ^
+		      crc_slice[0][(two >> 16) & 255] ^
+		      tab[two >> 24];
+	}
+
+	buf = (const Bytef *)b;
+	while (len--)
+		DO_CRC(*buf++);
+
+	return crc;
+}
+#endif
 #undef DO_CRC
 
+#ifdef CONFIG_ARM64_CRC32
+/* -1 until probed, then 0 or 1 depending on ID_AA64ISAR0_EL1.CRC32 */
+static int __efi_runtime_data crc_armv8_present = -1;
+
+static bool __efi_runtime crc32_has_armv8(void)
+{
+	uint64_t reg;
+
+	if (crc_armv8_present < 0) {
+		__asm__ volatile("mrs %0, ID_AA64ISAR0_EL1\n" : "=r" (reg));
+		crc_armv8_present = !!(reg & ID_AA64ISAR0_EL1_CRC32);
+	}
+
+	return crc_armv8_present;
+}
+
+static uint32_t __efi_runtime crc32_no_comp_armv8(uint32_t crc,
+						  const Bytef *buf, uInt len)
+{
+	for (; len && ((long)buf & 7); len--)
+		crc = __builtin_aarch64_crc32b(crc, *buf++);
+
+	for (; len >= 8; len -= 8, buf += 8)
+		crc = __builtin_aarch64_crc32x(crc, *(const uint64_t *)buf);
+
+	while (len--)
+		crc = __builtin_aarch64_crc32b(crc, *buf++);
+
+	return crc;
+}
+#endif
+
+bool crc32_engine_available(enum crc32_engine engine)
+{
+	switch (engine) {
+	case CRC32_ENGINE_TABLE:
+		return true;
+#ifdef CRC32_SLICE_BY_8
+	case CRC32_ENGINE_SLICE8:
+		return true;
+#endif
+#ifdef CONFIG_ARM64_CRC32
+	case CRC32_ENGINE_ARMV8:
+		return crc32_has_armv8();
+#endif
+	default:
+		return false;
+	}
+}
+
+uint32_t crc32_no_comp_engine(enum crc32_engine engine, uint32_t crc,
+			      const Bytef *buf, uInt len)
+{
+	switch (engine) {
+#ifdef CRC32_SLICE_BY_8
+	case CRC32_ENGINE_SLICE8:
+		return crc32_no_comp_slice8(crc, buf, len);
+#endif
+#ifdef CONFIG_ARM64_CRC32
+	case CRC32_ENGINE_ARMV8:
+		if (crc32_has_armv8())
+			return crc32_no_comp_armv8(crc, buf, len);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	return crc32_no_comp_table(crc, buf, len);
+}
+
+/* No ones complement version. JFFS2 (and other things ?)
+ * don't use ones compliment in their CRC calculations.
+ */
+uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+{
+#ifdef CONFIG_ARM64_CRC32
+	if (crc32_has_armv8())
+		return crc32_no_comp_armv8(crc, buf, len);
+#endif
+#ifdef CRC32_SLICE_BY_8
+	return crc32_no_comp_slice8(crc, buf, len);
+#else
+	return crc32_no_comp_table(crc, buf, len);
+#endif
+}
+
 uint32_t __efi_runtime crc32(uint32_t crc, const Bytef *p, uInt len)
 {
      return crc32_no_comp(crc ^ 0xffffffffL, p, len) ^ 0xffffffffL;
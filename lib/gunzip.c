@@ -14,6 +14,8 @@
 #include <memalign.h>
 #include <u-boot/crc.h>
 #include <watchdog.h>
+#include <asm/unaligned.h>
+#include <linux/zstd.h>
 #include <u-boot/zlib.h>
 
 #define HEADER0			'\x1f'
@@ -102,19 +104,149 @@ void gzwrite_progress_finish(int returnval,
 			     ulong bytes_written,
 			     ulong total_bytes,
 			     u32 expected_crc,
-			     u32 calculated_crc)
+			     u32 calculated_crc,
+			     bool check_crc)
 {
 	if (0 == returnval) {
 		printf("\n\t%lu bytes, crc 0x%08x\n",
 		       total_bytes, calculated_crc);
 	} else {
-		printf("\n\tuncompressed %lu of %lu\n"
-		       "\tcrcs == 0x%08x/0x%08x\n",
-		       bytes_written, total_bytes,
-		       expected_crc, calculated_crc);
+		printf("\n\tuncompressed %lu of %lu\n",
+		       bytes_written, total_bytes);
+		if (check_crc)
+			printf("\tcrcs == 0x%08x/0x%08x\n",
+			       expected_crc, calculated_crc);
 	}
 }
 
+/*
+ * Write @numfilled bytes of output to the device, padding the last block with
+ * zeroes
+ */
+static int gzwrite_blocks(struct blk_desc *dev, unsigned char *writebuf,
+			  ulong numfilled, lbaint_t *outblockp)
+{
+	lbaint_t writeblocks, blocks_written;
+
+	writeblocks = DIV_ROUND_UP(numfilled, dev->blksz);
+	if (numfilled % dev->blksz)
+		memset(writebuf + numfilled, 0,
+		       dev->blksz - numfilled % dev->blksz);
+
+	blocks_written = blk_dwrite(dev, *outblockp, writeblocks, writebuf);
+	if (blocks_written != writeblocks) {
+		printf("Error: write failed at block " LBAFU "\n",
+		       *outblockp + blocks_written);
+		return -1;
+	}
+	*outblockp += blocks_written;
+
+	return 0;
+}
+
+static int zstdwrite(unsigned char *src, int len, struct blk_desc *dev,
+		     unsigned char *writebuf, ulong szwritebuf,
+		     lbaint_t outblock, ulong szexpected)
+{
+	zstd_in_buffer in = { .src = src, .size = len };
+	zstd_out_buffer out = { .dst = writebuf, .size = szwritebuf };
+	zstd_frame_header fh;
+	zstd_dstream *zds;
+	ulong totalfilled = 0;
+	int iteration = 0;
+	size_t ret, wsize;
+	void *workspace;
+	u32 crc = 0;
+	bool done;
+	int r = -1;
+
+	ret = zstd_get_frame_header(&fh, src, len);
+	if (ret || fh.frameType != ZSTD_frame) {
+		puts("Error: Bad zstd data\n");
+		return -1;
+	}
+
+	if (!szexpected && fh.frameContentSize != ZSTD_CONTENTSIZE_UNKNOWN)
+		szexpected = fh.frameContentSize;
+	if (lldiv(szexpected, dev->blksz) > (dev->lba - outblock)) {
+		printf("%s: uncompressed size %lu exceeds device size\n",
+		       __func__, szexpected);
+		return -1;
+	}
+
+	/*
+	 * The workspace holds the whole window, so do not let the stream pick
+	 * its size. zstd itself refuses larger windows by default.
+	 */
+	if (fh.windowSize > (1ULL << ZSTD_WINDOWLOG_LIMIT_DEFAULT)) {
+		printf("Error: zstd window of %llu bytes is too large\n",
+		       fh.windowSize);
+		return -1;
+	}
+
+	/*
+	 * The window is kept by the stream, so the output can go anywhere.
+	 * blk_dwrite() is synchronous, so each buffer is written out before
+	 * the next one is decompressed; there is no queued block API to
+	 * overlap the two with.
+	 */
+	wsize = zstd_dstream_workspace_bound(fh.windowSize);
+	workspace = malloc(wsize);
+	if (!workspace) {
+		printf("Error: cannot allocate zstd workspace of %zu bytes\n",
+		       wsize);
+		return -1;
+	}
+	zds = zstd_init_dstream(fh.windowSize, workspace, wsize);
+	if (!zds) {
+		puts("Error: zstd_init_dstream() failed\n");
+		goto out_free;
+	}
+
+	gzwrite_progress_init(szexpected);
+
+	/* only write out partial buffers at the end of the input */
+	do {
+		ret = zstd_decompress_stream(zds, &out, &in);
+		if (zstd_is_error(ret)) {
+			printf("Error: zstd_decompress_stream() returned %d\n",
+			       zstd_get_error_code(ret));
+			goto out;
+		}
+		done = in.pos == in.size;
+		if (done && ret) {
+			puts("Error: zstd out of data\n");
+			goto out;
+		}
+		if (out.pos < out.size && !done)
+			continue;
+
+		crc = crc32(crc, writebuf, out.pos);
+		totalfilled += out.pos;
+		gzwrite_progress(iteration++, totalfilled, szexpected);
+		if (out.pos && gzwrite_blocks(dev, writebuf, out.pos, &outblock))
+			goto out;
+		out.pos = 0;
+		if (ctrlc()) {
+			puts("abort\n");
+			goto out;
+		}
+		schedule();
+	} while (!done);
+
+	/* zstd checks the content checksum itself, if there is one */
+	if (!szexpected || szexpected == totalfilled)
+		r = 0;
+
+out:
+	/* there is no CRC32 in a zstd frame to compare with */
+	gzwrite_progress_finish(r, totalfilled, szexpected, 0, crc, false);
+out_free:
+	free(workspace);
+
+	return r;
+}
+
 int gzwrite(unsigned char *src, int len,
 	    struct blk_desc *dev,
 	    unsigned long szwritebuf,
@@ -127,7 +259,7 @@ int gzwrite(unsigned char *src, int len,
 	unsigned char *writebuf;
 	unsigned crc = 0;
 	ulong totalfilled = 0;
-	lbaint_t blksperbuf, outblock;
+	lbaint_t outblock;
 	u32 expected_crc;
 	u32 payload_size;
 	int iteration = 0;
@@ -146,9 +278,20 @@ int gzwrite(unsigned char *src, int len,
 		return -1;
 	}
 
-	blksperbuf = szwritebuf / dev->blksz;
 	outblock = lldiv(startoffs, dev->blksz);
 
+	if (CONFIG_IS_ENABLED(ZSTD) && len >= 4 &&
+	    get_unaligned_le32(src) == ZSTD_MAGICNUMBER) {
+		writebuf = malloc_cache_aligned(szwritebuf);
+		if (!writebuf)
+			return -1;
+		r = zstdwrite(src, len, dev, writebuf, szwritebuf, outblock,
+			      szexpected);
+		free(writebuf);
+
+		return r;
+	}
+
 	/* skip header */
 	i = 10;
 	flags = src[3];
@@ -216,9 +359,7 @@ int gzwrite(unsigned char *src, int len,
 
 		/* run inflate() on input until output buffer not full */
 		do {
-			unsigned long blocks_written;
 			int numfilled;
-			lbaint_t writeblocks;
 
 			s.avail_out = szwritebuf;
 			s.next_out = writebuf;
@@ -231,21 +372,16 @@ int gzwrite(unsigned char *src, int len,
 			numfilled = szwritebuf - s.avail_out;
 			crc = crc32(crc, writebuf, numfilled);
 			totalfilled += numfilled;
-			if (numfilled < szwritebuf) {
-				writeblocks = (numfilled+dev->blksz-1)
-						/ dev->blksz;
-				memset(writebuf+numfilled, 0,
-				       dev->blksz-(numfilled%dev->blksz));
-			} else {
-				writeblocks = blksperbuf;
-			}
 
 			gzwrite_progress(iteration++,
 					 totalfilled,
 					 szexpected);
-			blocks_written = blk_dwrite(dev, outblock,
-						    writeblocks, writebuf);
-			outblock += blocks_written;
+			if (numfilled &&
+			    gzwrite_blocks(dev, writebuf, numfilled,
+					   &outblock)) {
+				r = -1;
+				goto out;
+			}
 			if (ctrlc()) {
 				puts("abort\n");
 				goto out;
@@ -263,7 +399,7 @@ int gzwrite(unsigned char *src, int len,
 
 out:
 	gzwrite_progress_finish(r, totalfilled, szexpected,
-				expected_crc, crc);
+				expected_crc, crc, true);
 	free(writebuf);
 	inflateEnd(&s);
 
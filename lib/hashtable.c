@@ -62,6 +62,12 @@ struct env_entry_node {
 static void _hdelete(const char *key, struct hsearch_data *htab,
 		     struct env_entry *ep, int idx);
 
+/*
+ * The table is grown once it is more than this many quarters full, since the
+ * probe sequences get long as it fills up
+ */
+#define HTAB_MAX_LOAD	3
+
 /*
  * hcreate()
  */
@@ -84,6 +90,53 @@ static int isprime(unsigned int number)
 	return number % div != 0;
 }
 
+/* Return the first prime number not smaller than nel */
+static unsigned int next_prime(unsigned int nel)
+{
+	nel |= 1;		/* make odd */
+	while (!isprime(nel))
+		nel += 2;
+
+	return nel;
+}
+
+/*
+ * First hash function: FNV-1a of the key modulo the table size, but prevent
+ * zero. All characters of the key take part, so that keys which only differ
+ * after a long common prefix still spread over the table.
+ */
+static unsigned int hhash(const char *key, unsigned int size)
+{
+	unsigned int hval = 2166136261U;
+
+	while (*key) {
+		hval ^= (unsigned char)*key++;
+		hval *= 16777619U;
+	}
+
+	hval %= size;
+	if (hval == 0)
+		++hval;
+
+	return hval;
+}
+
+/*
+ * Second hash function: the step between the indices tried, as suggested in
+ * [Knuth]. Because the table size is prime, stepping through the table from
+ * any index visits all of the entries.
+ */
+static unsigned int hstep(unsigned int idx, unsigned int hval,
+			  unsigned int size)
+{
+	unsigned int hval2 = 1 + hval % (size - 2);
+
+	if (idx <= hval2)
+		return size + idx - hval2;
+
+	return idx - hval2;
+}
+
 /*
  * Before using the hash table we must allocate memory for it.
  * Test for an existing table are done. We allocate one element
@@ -108,11 +161,7 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 	}
 
 	/* Change nel to the first prime number not smaller as nel. */
-	nel |= 1;		/* make odd */
-	while (!isprime(nel))
-		nel += 2;
-
-	htab->size = nel;
+	htab->size = next_prime(nel);
 	htab->filled = 0;
 
 	/* allocate memory and zero out */
@@ -128,6 +177,41 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 }
 
 
+/*
+ * Move all entries to a new table of at least nel elements. This drops the
+ * deleted entries, which lengthen the probe sequences just like used ones.
+ */
+static int hresize_r(size_t nel, struct hsearch_data *htab)
+{
+	struct env_entry_node *table;
+	unsigned int size, hval, idx;
+	int i;
+
+	size = next_prime(nel);
+	table = calloc(size + 1, sizeof(struct env_entry_node));
+	if (!table)
+		return -ENOMEM;
+
+	for (i = 1; i <= htab->size; ++i) {
+		if (htab->table[i].used <= 0)
+			continue;
+
+		hval = hhash(htab->table[i].entry.key, size);
+		for (idx = hval; table[idx].used; idx = hstep(idx, hval, size))
+			;
+		table[idx].used = hval;
+		table[idx].entry = htab->table[i].entry;
+	}
+	debug("hresize: %u -> %u entries for %u keys\n", htab->size, size,
+	      htab->filled);
+
+	free(htab->table);
+	htab->table = table;
+	htab->size = size;
+
+	return 0;
+}
+
 /*
  * hdestroy()
  */
@@ -219,17 +303,42 @@ int hmatch_r(const char *match, int last_idx, struct env_entry **retval,
 	return 0;
 }
 
+/*
+ * The callbacks may set other variables while the caller still holds an index
+ * into the table, so don't let the table be resized while they run.
+ */
 static int
-do_callback(const struct env_entry *e, const char *name, const char *value,
-	    enum env_op op, int flags)
+do_callback(struct hsearch_data *htab, const struct env_entry *e,
+	    const char *name, const char *value, enum env_op op, int flags)
 {
 #ifndef CONFIG_SPL_BUILD
-	if (e->callback)
-		return e->callback(name, value, op, flags);
+	int ret;
+
+	if (e->callback) {
+		htab->busy++;
+		ret = e->callback(name, value, op, flags);
+		htab->busy--;
+		return ret;
+	}
 #endif
 	return 0;
 }
 
+static int do_change_ok(struct hsearch_data *htab, const struct env_entry *e,
+			const char *newval, enum env_op op, int flag)
+{
+	int ret;
+
+	if (!htab->change_ok)
+		return 0;
+
+	htab->busy++;
+	ret = htab->change_ok(e, newval, op, flag);
+	htab->busy--;
+
+	return ret;
+}
+
 /*
  * Compare an existing entry with the desired key, and overwrite if the action
  * is ENV_ENTER.  This is simply a helper function for hsearch_r().
@@ -244,9 +353,8 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 		/* Overwrite existing value? */
 		if (action == ENV_ENTER && item.data) {
 			/* check for permission */
-			if (htab->change_ok != NULL && htab->change_ok(
-			    &htab->table[idx].entry, item.data,
-			    env_op_overwrite, flag)) {
+			if (do_change_ok(htab, &htab->table[idx].entry,
+					 item.data, env_op_overwrite, flag)) {
 				debug("change_ok() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EPERM);
@@ -255,8 +363,9 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 			}
 
 			/* If there is a callback, call it */
-			if (do_callback(&htab->table[idx].entry, item.key,
-					item.data, env_op_overwrite, flag)) {
+			if (do_callback(htab, &htab->table[idx].entry,
+					item.key, item.data, env_op_overwrite,
+					flag)) {
 				debug("callback() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EINVAL);
@@ -284,27 +393,16 @@ int hsearch_r(struct env_entry item, enum env_action action,
 	      struct env_entry **retval, struct hsearch_data *htab, int flag)
 {
 	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
 	unsigned int idx;
 	unsigned int first_deleted = 0;
 	int ret;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
+	/* Make room before looking for the slot of a new entry */
+	if (action == ENV_ENTER && !htab->busy &&
+	    (htab->filled + 1) * 4 > htab->size * HTAB_MAX_LOAD)
+		hresize_r(htab->size * 2, htab);
 
-	/*
-	 * First hash function:
-	 * simply take the modul but prevent zero.
-	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
+	hval = hhash(item.key, htab->size);
 
 	/* The first index tried. */
 	idx = hval;
@@ -314,8 +412,6 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		 * Further action might be required according to the
 		 * action value.
 		 */
-		unsigned hval2;
-
 		if (htab->table[idx].used == USED_DELETED)
 			first_deleted = idx;
 
@@ -324,21 +420,8 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		if (ret != -1)
 			return ret;
 
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
-
 		do {
-			/*
-			 * Because SIZE is prime this guarantees to
-			 * step through all available indices.
-			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
+			idx = hstep(idx, hval, htab->size);
 
 			/*
 			 * If we visited all entries leave the loop
@@ -397,8 +480,8 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		env_flags_init(&htab->table[idx].entry);
 
 		/* check for permission */
-		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
+		if (do_change_ok(htab, &htab->table[idx].entry, item.data,
+				 env_op_create, flag)) {
 			debug("change_ok() rejected setting variable "
 				"%s, skipping it!\n", item.key);
 			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
@@ -408,8 +491,8 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		}
 
 		/* If there is a callback, call it */
-		if (do_callback(&htab->table[idx].entry, item.key, item.data,
-				env_op_create, flag)) {
+		if (do_callback(htab, &htab->table[idx].entry, item.key,
+				item.data, env_op_create, flag)) {
 			debug("callback() rejected setting variable "
 				"%s, skipping it!\n", item.key);
 			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
@@ -468,8 +551,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* Check for permission */
-	if (htab->change_ok != NULL &&
-	    htab->change_ok(ep, NULL, env_op_delete, flag)) {
+	if (do_change_ok(htab, ep, NULL, env_op_delete, flag)) {
 		debug("change_ok() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EPERM);
@@ -477,7 +559,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
-	if (do_callback(&htab->table[idx].entry, key, NULL,
+	if (do_callback(htab, &htab->table[idx].entry, key, NULL,
 			env_op_delete, flag)) {
 		debug("callback() rejected deleting variable "
 			"%s, skipping it!\n", key);
@@ -603,7 +685,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 char **resp, size_t size,
 		 int argc, char *const argv[])
 {
-	struct env_entry *list[htab->size];
+	struct env_entry **list;
 	char *res, *p;
 	size_t totlen;
 	int i, n;
@@ -614,6 +696,13 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		return (-1);
 	}
 
+	/* the table grows with the environment, so keep this off the stack */
+	list = malloc((htab->filled + 1) * sizeof(*list));
+	if (!list) {
+		__set_errno(ENOMEM);
+		return (-1);
+	}
+
 	debug("EXPORT  table = %p, htab.size = %d, htab.filled = %d, size = %lu\n",
 	      htab, htab->size, htab->filled, (ulong)size);
 	/*
@@ -671,6 +760,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		if (size < totlen + 1) {	/* provided buffer too small */
 			printf("Env export buffer too small: %lu, but need %lu\n",
 			       (ulong)size, (ulong)totlen + 1);
+			free(list);
 			__set_errno(ENOMEM);
 			return (-1);
 		}
@@ -687,6 +777,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		/* no, allocate and clear one */
 		*resp = res = calloc(1, size);
 		if (res == NULL) {
+			free(list);
 			__set_errno(ENOMEM);
 			return (-1);
 		}
@@ -713,6 +804,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		*p++ = sep;
 	}
 	*p = '\0';		/* terminate result */
+	free(list);
 
 	return size;
 }
@@ -844,7 +936,8 @@ int himport_r(struct hsearch_data *htab,
 	 * environment size), so we clip it to a reasonable value.
 	 * On the other hand we need to add some more entries for free
 	 * space when importing very small buffers. Both boundaries can
-	 * be overwritten in the board config file if needed.
+	 * be overwritten in the board config file if needed. Bigger
+	 * environments are handled by growing the table as it fills up.
 	 */
 
 	if (!htab->table) {
@@ -982,6 +1075,40 @@ end:
 	return 1;		/* everything OK */
 }
 
+/*
+ * hstats_r()
+ */
+
+/*
+ * Count the indices tried before finding each entry, by following its probe
+ * sequence again.
+ */
+void hstats_r(struct hsearch_data *htab, struct hsearch_stats *stats)
+{
+	unsigned int hval, idx, probes;
+	int i;
+
+	memset(stats, '\0', sizeof(*stats));
+	stats->size = htab->size;
+	stats->filled = htab->filled;
+
+	for (i = 1; i <= htab->size; ++i) {
+		if (htab->table[i].used == USED_DELETED) {
+			stats->deleted++;
+			continue;
+		}
+		if (htab->table[i].used <= 0)
+			continue;
+
+		hval = htab->table[i].used;
+		for (idx = hval, probes = 1; idx != i; probes++)
+			idx = hstep(idx, hval, htab->size);
+		stats->probes += probes;
+		if (probes > stats->max_probes)
+			stats->max_probes = probes;
+	}
+}
+
 /*
  * hwalk_r()
  */
@@ -42,6 +42,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <sparse_format.h>
+#include <time.h>
 #include <asm/cache.h>
 
 #include <linux/math64.h>
@@ -58,7 +59,10 @@ static lbaint_t write_sparse_chunk_raw(struct sparse_storage *info,
 	lbaint_t aligned_buf_blks = FASTBOOT_MAX_BLK_WRITE;
 	uint32_t *aligned_buf = NULL;
 
-	if (CONFIG_IS_ENABLED(SYS_DCACHE_OFF)) {
+	/* write in place if the image data is suitable for DMA */
+	if (CONFIG_IS_ENABLED(SYS_DCACHE_OFF) ||
+	    (IS_ALIGNED((ulong)data, ARCH_DMA_MINALIGN) &&
+	     IS_ALIGNED(info->blksz, ARCH_DMA_MINALIGN))) {
 		write_blks = info->write(info, blk, n, data);
 		if (write_blks < n)
 			goto write_fail;
@@ -106,13 +110,92 @@ write_fail:
 	return -1;
 }
 
+static lbaint_t write_sparse_chunk_fill(struct sparse_storage *info,
+					lbaint_t blk, lbaint_t blkcnt,
+					void *fill_buf, int fill_buf_num_blks,
+					char *response)
+{
+	lbaint_t blks, total = 0;
+	int i;
+	int j;
+
+	for (i = 0; i < blkcnt;) {
+		j = blkcnt - i;
+		if (j > fill_buf_num_blks)
+			j = fill_buf_num_blks;
+		blks = info->write(info, blk + total, j, fill_buf);
+		/* blks might be > j (eg. NAND bad-blocks) */
+		if (blks < j) {
+			printf("%s: %s " LBAFU " [%d]\n", __func__,
+			       "Write failed, block #", blk + total, j);
+			info->mssg("flash write failure", response);
+			return -1;
+		}
+		total += blks;
+		i += j;
+	}
+
+	return total;
+}
+
+/*
+ * Zero blocks by erasing all the whole erase units in the range and writing
+ * the partial units at either end
+ */
+static lbaint_t write_sparse_chunk_zero(struct sparse_storage *info,
+					lbaint_t blk, lbaint_t blkcnt,
+					void *fill_buf, int fill_buf_num_blks,
+					lbaint_t *erasedp, char *response)
+{
+	lbaint_t head, body, blks;
+	u32 rem;
+
+	div_u64_rem(blk, info->erase_blks, &rem);
+	head = rem ? min_t(lbaint_t, info->erase_blks - rem, blkcnt) : 0;
+	body = blkcnt - head;
+	div_u64_rem(body, info->erase_blks, &rem);
+	body -= rem;
+	if (!body)
+		return write_sparse_chunk_fill(info, blk, blkcnt, fill_buf,
+					       fill_buf_num_blks, response);
+
+	if (head) {
+		blks = write_sparse_chunk_fill(info, blk, head, fill_buf,
+					       fill_buf_num_blks, response);
+		if (IS_ERR_VALUE(blks))
+			return blks;
+	}
+
+	blks = info->erase(info, blk + head, body);
+	if (blks != body) {
+		printf("%s: Erase failed, block #" LBAFU " [" LBAFU "]\n",
+		       __func__, blk + head, body);
+		info->mssg("flash erase failure", response);
+		return -1;
+	}
+	*erasedp += body;
+
+	if (rem) {
+		blks = write_sparse_chunk_fill(info, blk + head + body, rem,
+					       fill_buf, fill_buf_num_blks,
+					       response);
+		if (IS_ERR_VALUE(blks))
+			return blks;
+	}
+
+	return blkcnt;
+}
+
 int write_sparse_image(struct sparse_storage *info,
 		       const char *part_name, void *data, char *response)
 {
 	lbaint_t blk;
 	lbaint_t blkcnt;
 	lbaint_t blks;
+	lbaint_t erased = 0;
 	uint64_t bytes_written = 0;
+	ulong start_time;
+	ulong time_ms;
 	unsigned int chunk;
 	unsigned int offset;
 	uint64_t chunk_data_sz;
@@ -123,7 +206,6 @@ int write_sparse_image(struct sparse_storage *info,
 	uint32_t total_blocks = 0;
 	int fill_buf_num_blks;
 	int i;
-	int j;
 
 	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
 
@@ -165,6 +247,7 @@ int write_sparse_image(struct sparse_storage *info,
 	}
 
 	puts("Flashing Sparse Image\n");
+	start_time = get_timer(0);
 
 	/* Start processing chunks */
 	blk = info->start;
@@ -227,6 +310,15 @@ int write_sparse_image(struct sparse_storage *info,
 				return -1;
 			}
 
+			if (blk + blkcnt > info->start + info->size) {
+				printf(
+				    "%s: Request would exceed partition size!\n",
+				    __func__);
+				info->mssg("Request would exceed partition size!",
+					   response);
+				return -1;
+			}
+
 			fill_buf = (uint32_t *)
 				   memalign(ARCH_DMA_MINALIGN,
 					    ROUNDUP(
@@ -247,38 +339,25 @@ int write_sparse_image(struct sparse_storage *info,
 			     i++)
 				fill_buf[i] = fill_val;
 
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
+			if (!fill_val && info->erase)
+				blks = write_sparse_chunk_zero(info, blk, blkcnt,
+							       fill_buf,
+							       fill_buf_num_blks,
+							       &erased,
+							       response);
+			else
+				blks = write_sparse_chunk_fill(info, blk, blkcnt,
+							       fill_buf,
+							       fill_buf_num_blks,
+							       response);
+			free(fill_buf);
+			if (IS_ERR_VALUE(blks))
 				return -1;
-			}
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
+			blk += blks;
 			bytes_written += ((u64)blkcnt) * info->blksz;
 			total_blocks += DIV_ROUND_UP_ULL(chunk_data_sz,
 							 sparse_header->blk_sz);
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
@@ -308,6 +387,10 @@ int write_sparse_image(struct sparse_storage *info,
 	debug("Wrote %d blocks, expected to write %d blocks\n",
 	      total_blocks, sparse_header->total_blks);
 	printf("........ wrote %llu bytes to '%s'\n", bytes_written, part_name);
+	time_ms = max(get_timer(start_time), 1UL);
+	printf("........ took %lu ms (%llu KiB/s), erased %llu bytes\n",
+	       time_ms, div_u64(bytes_written, time_ms) * 1000 / 1024,
+	       (u64)erased * info->blksz);
 
 	if (total_blocks != sparse_header->total_blks) {
 		info->mssg("sparse image write failure", response);
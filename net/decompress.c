@@ -0,0 +1,554 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Decompress files as they are downloaded
+ *
+ * Data is passed to the decompressor as soon as it is received in order, and
+ * only the uncompressed data is written to the load address. Data received
+ * ahead of a gap is held back in a small buffer until the gap is filled.
+ */
+
+#include <env.h>
+#include <image.h>
+#include <log.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <net/decompress.h>
+#include <asm/unaligned.h>
+#include <linux/kernel.h>
+#include <linux/sizes.h>
+#include <linux/zstd.h>
+#include <u-boot/lz4.h>
+#include <u-boot/zlib.h>
+
+#define DECOMP_HOLD_SIZE	NET_DECOMP_HOLD_SIZE
+#define DECOMP_HOLD_RANGES	64
+
+/* Enough of the start of the file to tell which format it is in */
+#define DECOMP_MAGIC_SIZE	sizeof(u32)
+
+#define LZ4F_HDR_SIZE		7
+#define LZ4F_CSIZE_SIZE		8
+#define LZ4F_UNCOMPRESSED	0x80000000U
+
+enum decomp_type {
+	DECOMP_UNKNOWN,
+	DECOMP_NONE,
+	DECOMP_GZIP,
+	DECOMP_ZSTD,
+	DECOMP_LZ4,
+};
+
+static const char *const decomp_name[] = {
+	[DECOMP_NONE] = "none",
+	[DECOMP_GZIP] = "gzip",
+	[DECOMP_ZSTD] = "zstd",
+	[DECOMP_LZ4] = "lz4",
+};
+
+enum lz4_state {
+	LZ4_HEADER,
+	LZ4_BLOCK_SIZE,
+	LZ4_BLOCK,
+};
+
+/**
+ * struct decomp_range - part of the file held back
+ *
+ * @start: offset of the first byte in the file
+ * @end: offset of the byte after the last one
+ */
+struct decomp_range {
+	ulong start;
+	ulong end;
+};
+
+/**
+ * struct decomp_state - state of the file being decompressed
+ *
+ * @active: a file is being decompressed
+ * @done: the end of the compressed data was seen
+ * @type: compression format, DECOMP_UNKNOWN until @magic is filled
+ * @magic: start of the file, used to find the compression format
+ * @magic_len: number of bytes in @magic
+ * @dst: uncompressed data
+ * @size: space at @dst
+ * @out: number of bytes written to @dst
+ * @in: number of bytes of the file passed to the decompressor
+ * @hold: data received ahead of @in, indexed by offset modulo
+ *	DECOMP_HOLD_SIZE
+ * @ranges: parts of the file in @hold
+ * @num_ranges: number of entries in @ranges
+ * @zs: gzip stream
+ * @zws: zstd workspace
+ * @zds: zstd stream
+ * @zout: zstd output buffer, which covers all of @dst
+ * @buf: LZ4 frame header or block being collected
+ * @buf_size: size of @buf
+ * @need: number of bytes needed in @buf
+ * @have: number of bytes in @buf
+ * @lz4_state: what @buf is collecting
+ * @lz4_bsum: LZ4 blocks are followed by a checksum
+ * @lz4_bmax: largest LZ4 block allowed by the frame header
+ */
+static struct decomp_state {
+	bool active;
+	bool done;
+	enum decomp_type type;
+	uchar magic[DECOMP_MAGIC_SIZE];
+	ulong magic_len;
+	uchar *dst;
+	ulong size;
+	ulong out;
+	ulong in;
+	uchar *hold;
+	struct decomp_range ranges[DECOMP_HOLD_RANGES];
+	int num_ranges;
+	z_stream zs;
+	void *zws;
+	zstd_dstream *zds;
+	zstd_out_buffer zout;
+	uchar *buf;
+	ulong buf_size;
+	ulong need;
+	ulong have;
+	enum lz4_state lz4_state;
+	bool lz4_bsum;
+	u32 lz4_bmax;
+} decomp;
+
+bool net_decomp_enabled(void)
+{
+	return env_get_yesno("netdecompress") == 1;
+}
+
+bool net_decomp_active(void)
+{
+	return decomp.active;
+}
+
+static enum decomp_type decomp_detect(const uchar *src, ulong len)
+{
+	if (IS_ENABLED(CONFIG_GZIP) && len >= 2 && src[0] == 0x1f &&
+	    src[1] == 0x8b)
+		return DECOMP_GZIP;
+	if (len < DECOMP_MAGIC_SIZE)
+		return DECOMP_NONE;
+	if (IS_ENABLED(CONFIG_ZSTD) &&
+	    get_unaligned_le32(src) == ZSTD_MAGICNUMBER)
+		return DECOMP_ZSTD;
+	if (IS_ENABLED(CONFIG_LZ4) && get_unaligned_le32(src) == LZ4F_MAGIC)
+		return DECOMP_LZ4;
+
+	return DECOMP_NONE;
+}
+
+static int decomp_init(enum decomp_type type)
+{
+	size_t wsize, ret;
+
+	decomp.type = type;
+	switch (type) {
+	case DECOMP_GZIP:
+		decomp.zs.zalloc = gzalloc;
+		decomp.zs.zfree = gzfree;
+		/* let zlib check the gzip header and trailer */
+		if (inflateInit2(&decomp.zs, 16 + MAX_WBITS) != Z_OK)
+			return -ENOMEM;
+		break;
+	case DECOMP_ZSTD:
+		/*
+		 * The output buffer doubles as the window, so only room for
+		 * one block of input is needed, whatever the window size.
+		 */
+		wsize = zstd_dstream_workspace_bound(ZSTD_BLOCKSIZE_MAX);
+		decomp.zws = malloc(wsize);
+		if (!decomp.zws)
+			return -ENOMEM;
+		decomp.zds = zstd_init_dstream(ZSTD_BLOCKSIZE_MAX, decomp.zws,
+					       wsize);
+		if (!decomp.zds)
+			return -EINVAL;
+		ret = ZSTD_DCtx_setParameter(decomp.zds, ZSTD_d_stableOutBuffer,
+					     1);
+		if (zstd_is_error(ret))
+			return -EINVAL;
+		decomp.zout.dst = decomp.dst;
+		decomp.zout.size = decomp.size;
+		decomp.zout.pos = 0;
+		break;
+	case DECOMP_LZ4:
+		decomp.buf_size = LZ4F_HDR_SIZE + LZ4F_CSIZE_SIZE;
+		decomp.buf = malloc(decomp.buf_size);
+		if (!decomp.buf)
+			return -ENOMEM;
+		decomp.lz4_state = LZ4_HEADER;
+		decomp.need = LZ4F_HDR_SIZE;
+		decomp.have = 0;
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static int decomp_gzip(const uchar *src, ulong len)
+{
+	z_stream *zs = &decomp.zs;
+	int ret;
+
+	zs->next_in = (uchar *)src;
+	zs->avail_in = len;
+	while (zs->avail_in) {
+		zs->next_out = decomp.dst + decomp.out;
+		zs->avail_out = min_t(ulong, decomp.size - decomp.out,
+				      UINT_MAX);
+		ret = inflate(zs, Z_SYNC_FLUSH);
+		decomp.out = zs->next_out - decomp.dst;
+		if (ret == Z_STREAM_END) {
+			decomp.done = true;
+			break;
+		}
+		if (ret != Z_OK)
+			return ret == Z_BUF_ERROR ? -ENOSPC : -EPROTO;
+	}
+
+	return 0;
+}
+
+static int decomp_zstd(const uchar *src, ulong len)
+{
+	zstd_in_buffer in = { .src = src, .size = len };
+	size_t ret;
+
+	while (in.pos < in.size) {
+		ret = zstd_decompress_stream(decomp.zds, &decomp.zout, &in);
+		decomp.out = decomp.zout.pos;
+		if (zstd_is_error(ret))
+			return -EPROTO;
+		if (!ret) {
+			decomp.done = true;
+			break;
+		}
+		if (decomp.zout.pos == decomp.zout.size)
+			return -ENOSPC;
+	}
+
+	return 0;
+}
+
+/* Act on the LZ4 frame header or block collected in decomp.buf */
+static int decomp_lz4_step(void)
+{
+	ulong space = decomp.size - decomp.out;
+	u32 block, size;
+	u8 flags, bsize_id;
+	int ret;
+
+	switch (decomp.lz4_state) {
+	case LZ4_HEADER:
+		flags = decomp.buf[4];
+		bsize_id = (decomp.buf[5] >> 4) & 0x7;
+		/* same restrictions as ulz4fn() */
+		if ((flags >> 6) != 1 || (flags & 0x03) ||
+		    (decomp.buf[5] & 0x8f) || bsize_id < 4)
+			return -EINVAL;
+		if (!(flags & 0x20))
+			return -EPROTONOSUPPORT;
+		if ((flags & 0x08) && decomp.need == LZ4F_HDR_SIZE) {
+			decomp.need += LZ4F_CSIZE_SIZE;
+			return 0;
+		}
+		decomp.lz4_bsum = flags & 0x10;
+		/* 64KiB, 256KiB, 1MiB or 4MiB */
+		decomp.lz4_bmax = 1U << (8 + 2 * bsize_id);
+		decomp.lz4_state = LZ4_BLOCK_SIZE;
+		decomp.need = sizeof(u32);
+		break;
+	case LZ4_BLOCK_SIZE:
+		block = get_unaligned_le32(decomp.buf);
+		size = block & ~LZ4F_UNCOMPRESSED;
+		if (!size) {
+			/* ignore the content checksum */
+			decomp.done = true;
+			break;
+		}
+		if (size > decomp.lz4_bmax)
+			return -EPROTO;
+		decomp.need = size + (decomp.lz4_bsum ? sizeof(u32) : 0);
+		if (decomp.need + sizeof(u32) > decomp.buf_size) {
+			free(decomp.buf);
+			decomp.buf_size = decomp.need + sizeof(u32);
+			decomp.buf = malloc(decomp.buf_size);
+			if (!decomp.buf)
+				return -ENOMEM;
+		}
+		/* keep the block header in front of the block */
+		put_unaligned_le32(block, decomp.buf);
+		decomp.have = sizeof(u32);
+		decomp.need += sizeof(u32);
+		decomp.lz4_state = LZ4_BLOCK;
+		return 0;
+	case LZ4_BLOCK:
+		block = get_unaligned_le32(decomp.buf);
+		size = block & ~LZ4F_UNCOMPRESSED;
+		if (block & LZ4F_UNCOMPRESSED) {
+			if (size > space)
+				return -ENOSPC;
+			memcpy(decomp.dst + decomp.out, decomp.buf + sizeof(u32),
+			       size);
+			ret = size;
+		} else {
+			ret = LZ4_decompress_safe((char *)decomp.buf + sizeof(u32),
+						  (char *)decomp.dst + decomp.out,
+						  size, min_t(ulong, space,
+							      INT_MAX));
+			if (ret < 0)
+				return -EPROTO;
+		}
+		decomp.out += ret;
+		decomp.lz4_state = LZ4_BLOCK_SIZE;
+		decomp.need = sizeof(u32);
+		break;
+	}
+	decomp.have = 0;
+
+	return 0;
+}
+
+static int decomp_lz4(const uchar *src, ulong len)
+{
+	ulong count;
+	int ret;
+
+	while (len && !decomp.done) {
+		count = min(len, decomp.need - decomp.have);
+		memcpy(decomp.buf + decomp.have, src, count);
+		decomp.have += count;
+		src += count;
+		len -= count;
+		if (decomp.have < decomp.need)
+			break;
+		ret = decomp_lz4_step();
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Pass @len bytes to the decompressor for the format in use */
+static int decomp_process(const uchar *src, ulong len)
+{
+	if (decomp.done)
+		return 0;
+
+	switch (decomp.type) {
+	case DECOMP_GZIP:
+		return decomp_gzip(src, len);
+	case DECOMP_ZSTD:
+		return decomp_zstd(src, len);
+	case DECOMP_LZ4:
+		return decomp_lz4(src, len);
+	default:
+		if (len > decomp.size - decomp.out)
+			return -ENOSPC;
+		memcpy(decomp.dst + decomp.out, src, len);
+		decomp.out += len;
+		return 0;
+	}
+}
+
+/* Set up for the format found from the start of the file and process it */
+static int decomp_detected(void)
+{
+	int ret;
+
+	ret = decomp_init(decomp_detect(decomp.magic, decomp.magic_len));
+	if (ret)
+		return ret;
+
+	return decomp_process(decomp.magic, decomp.magic_len);
+}
+
+/* Pass the next @len bytes of the file to the decompressor */
+static int decomp_feed(const uchar *src, ulong len)
+{
+	ulong count;
+	int ret;
+
+	if (decomp.type == DECOMP_UNKNOWN) {
+		/* the first packet may be too short to tell the format */
+		count = min(len, DECOMP_MAGIC_SIZE - decomp.magic_len);
+		memcpy(decomp.magic + decomp.magic_len, src, count);
+		decomp.magic_len += count;
+		decomp.in += count;
+		src += count;
+		len -= count;
+		if (decomp.magic_len < DECOMP_MAGIC_SIZE)
+			return 0;
+		ret = decomp_detected();
+		if (ret)
+			return ret;
+	}
+	decomp.in += len;
+
+	return decomp_process(src, len);
+}
+
+/*
+ * Keep data which comes after a gap until the gap is filled. Ranges which
+ * overlap or touch are merged, so that data received more than once does not
+ * use up more of them.
+ */
+static int decomp_hold(ulong offset, const uchar *src, ulong len)
+{
+	struct decomp_range *range;
+	ulong start = offset, end = offset + len;
+	ulong pos, count;
+	int i;
+
+	if (end - decomp.in > DECOMP_HOLD_SIZE)
+		return -ENOSPC;
+	/* a new range is needed unless this touches one already held */
+	for (i = 0; i < decomp.num_ranges; i++) {
+		range = &decomp.ranges[i];
+		if (range->start <= end && range->end >= start)
+			break;
+	}
+	if (i == DECOMP_HOLD_RANGES)
+		return -ENOSPC;
+	if (!decomp.hold) {
+		decomp.hold = malloc(DECOMP_HOLD_SIZE);
+		if (!decomp.hold)
+			return -ENOSPC;
+	}
+
+	while (len) {
+		pos = offset % DECOMP_HOLD_SIZE;
+		count = min(len, DECOMP_HOLD_SIZE - pos);
+		memcpy(decomp.hold + pos, src, count);
+		offset += count;
+		src += count;
+		len -= count;
+	}
+
+	for (i = 0; i < decomp.num_ranges;) {
+		range = &decomp.ranges[i];
+		if (range->start > end || range->end < start) {
+			i++;
+			continue;
+		}
+		start = min(start, range->start);
+		end = max(end, range->end);
+		*range = decomp.ranges[--decomp.num_ranges];
+	}
+	range = &decomp.ranges[decomp.num_ranges++];
+	range->start = start;
+	range->end = end;
+
+	return 0;
+}
+
+/* Pass on the data held back which now follows on from decomp.in */
+static int decomp_release(void)
+{
+	struct decomp_range *range;
+	ulong pos, count;
+	int i, ret;
+
+	for (i = 0; i < decomp.num_ranges;) {
+		range = &decomp.ranges[i];
+		if (range->start > decomp.in) {
+			i++;
+			continue;
+		}
+		while (range->end > decomp.in) {
+			pos = decomp.in % DECOMP_HOLD_SIZE;
+			count = min(range->end - decomp.in,
+				    DECOMP_HOLD_SIZE - pos);
+			ret = decomp_feed(decomp.hold + pos, count);
+			if (ret)
+				return ret;
+		}
+		/* drop this range and look at the others again */
+		*range = decomp.ranges[--decomp.num_ranges];
+		i = 0;
+	}
+
+	return 0;
+}
+
+int net_decomp_write(ulong offset, const void *src, ulong len)
+{
+	int ret;
+
+	if (!decomp.active)
+		return -EINVAL;
+	if (offset + len <= decomp.in)
+		return 0;
+	if (offset > decomp.in)
+		return decomp_hold(offset, src, len);
+
+	ret = decomp_feed(src + decomp.in - offset, offset + len - decomp.in);
+	if (!ret)
+		ret = decomp_release();
+	if (ret) {
+		printf("\n%s: decompression failed at offset %lu (err=%d)\n",
+		       decomp_name[decomp.type], decomp.in, ret);
+		net_decomp_abort();
+		return ret == -ENOSPC ? -EFBIG : ret;
+	}
+
+	return 0;
+}
+
+int net_decomp_start(ulong addr, ulong size)
+{
+	net_decomp_abort();
+	if (!net_decomp_enabled())
+		return 0;
+
+	decomp.dst = map_sysmem(addr, size);
+	decomp.size = size ? size : ULONG_MAX - (ulong)decomp.dst;
+	decomp.active = true;
+
+	return 0;
+}
+
+int net_decomp_finish(ulong *sizep)
+{
+	int ret = 0;
+
+	if (!decomp.active)
+		return -EINVAL;
+
+	/* the file was shorter than the magic number of any format */
+	if (decomp.type == DECOMP_UNKNOWN)
+		ret = decomp_detected();
+	if (!ret && decomp.type != DECOMP_NONE && !decomp.done) {
+		printf("%s: compressed data is truncated\n",
+		       decomp_name[decomp.type]);
+		ret = -EIO;
+	}
+	if (!ret && decomp.type != DECOMP_NONE)
+		printf("%s: %lu bytes uncompressed to %lu (%lx hex)\n",
+		       decomp_name[decomp.type], decomp.in, decomp.out,
+		       decomp.out);
+	*sizep = decomp.out;
+	net_decomp_abort();
+
+	return ret;
+}
+
+void net_decomp_abort(void)
+{
+	if (decomp.type == DECOMP_GZIP)
+		inflateEnd(&decomp.zs);
+	free(decomp.zws);
+	free(decomp.buf);
+	free(decomp.hold);
+	if (decomp.dst)
+		unmap_sysmem(decomp.dst);
+	memset(&decomp, '\0', sizeof(decomp));
+}
@@ -400,6 +400,21 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+/* Fetch up to 32 packets from the driver in one call and process them */
+static int eth_rx_batch(struct udevice *current)
+{
+	struct eth_rx_pkt pkts[ETH_PACKETS_BATCH_RECV];
+	int ret;
+	int i;
+
+	ret = eth_get_ops(current)->recv_batch(current, ETH_RECV_CHECK_DEVICE,
+					       pkts, ARRAY_SIZE(pkts));
+	for (i = 0; i < ret; i++)
+		net_process_received_packet(pkts[i].packet, pkts[i].length);
+
+	return ret;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
@@ -415,6 +430,11 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
+	if (eth_get_ops(current)->recv_batch) {
+		ret = eth_rx_batch(current);
+		goto done;
+	}
+
 	/* Process up to 32 packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
 	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
@@ -427,6 +447,7 @@ int eth_rx(void)
 		if (ret <= 0)
 			break;
 	}
+done:
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
@@ -29,6 +29,7 @@
 #include <common.h>
 #include <command.h>
 #include <display_options.h>
+#include <env.h>
 #ifdef CONFIG_SYS_DIRECT_FLASH_NFS
 #include <flash.h>
 #endif
@@ -40,6 +41,7 @@
 #include "nfs.h"
 #include "bootp.h"
 #include <time.h>
+#include <linux/log2.h>
 
 #define HASHES_PER_LINE 65	/* Number of "loading" hashes per line	*/
 #define NFS_RETRY_COUNT 30
@@ -47,12 +49,44 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+#define NFS_READ_WINDOW_MAX	16
+
+/*
+ * Largest NFSv3 read whose reply, with its UDP, RPC and NFS headers, fits in a
+ * reassembled IP datagram
+ */
+#ifdef CONFIG_IP_DEFRAG
+#define NFS3_READ_SIZE_MAX	rounddown_pow_of_two(CONFIG_NET_MAXDEFRAG - \
+				IP_UDP_HDR_SIZE - \
+				(sizeof(struct rpc_t) - NFS_READ_SIZE))
+#else
+#define NFS3_READ_SIZE_MAX	NFS_READ_SIZE
+#endif
+
+/**
+ * struct nfs_read_slot - A READ request waiting for its reply
+ *
+ * @id: RPC transaction ID of the request, 0 if the slot is free
+ * @offset: Offset in the file of the first byte requested
+ * @len: Number of bytes requested
+ */
+struct nfs_read_slot {
+	unsigned long id;
+	unsigned int offset;
+	unsigned int len;
+};
+
 static int fs_mounted;
 static unsigned long rpc_id;
 static int nfs_offset = -1;
-static int nfs_len;
 static const ulong nfs_timeout = CONFIG_NFS_TIMEOUT;
 
+static struct nfs_read_slot nfs_read_slots[NFS_READ_WINDOW_MAX];
+static int nfs_read_window;		/* Number of slots in use */
+static unsigned int nfs_read_size;	/* Bytes to ask for in each READ */
+static unsigned int nfs_received;	/* Bytes received so far */
+static bool nfs_eof;			/* Seen the end of the file */
+
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
 static unsigned int filefh3_length;	/* (variable) length of filefh when NFSv3 */
@@ -71,6 +105,7 @@ static int nfs_state;
 #define STATE_LOOKUP_REQ		5
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
+#define STATE_FSINFO_REQ		8
 
 static char *nfs_filename;
 static char *nfs_path;
@@ -401,6 +436,79 @@ static void nfs_read_req(int offset, int readlen)
 	rpc_req(PROG_NFS, NFS_READ, data, len);
 }
 
+/* Send the READ request for a slot, under a new transaction ID */
+static void nfs_read_slot_send(struct nfs_read_slot *slot)
+{
+	nfs_read_req(slot->offset, slot->len);
+	slot->id = rpc_id;
+}
+
+/* Ask for the next part of the file in each free slot */
+static void nfs_read_fill(void)
+{
+	struct nfs_read_slot *slot;
+
+	for (slot = nfs_read_slots;
+	     slot < nfs_read_slots + nfs_read_window && !nfs_eof; slot++) {
+		if (slot->id)
+			continue;
+		slot->offset = nfs_offset;
+		slot->len = nfs_read_size;
+		nfs_offset += nfs_read_size;
+		nfs_read_slot_send(slot);
+	}
+}
+
+/* (Re)send all outstanding READ requests and fill the window */
+static void nfs_read_send(void)
+{
+	struct nfs_read_slot *slot;
+
+	for (slot = nfs_read_slots; slot < nfs_read_slots + nfs_read_window;
+	     slot++) {
+		if (slot->id)
+			nfs_read_slot_send(slot);
+	}
+	nfs_read_fill();
+}
+
+/* Check whether the whole file has been received */
+static bool nfs_read_done(void)
+{
+	struct nfs_read_slot *slot;
+
+	if (!nfs_eof)
+		return false;
+	for (slot = nfs_read_slots; slot < nfs_read_slots + nfs_read_window;
+	     slot++) {
+		if (slot->id)
+			return false;
+	}
+
+	return true;
+}
+
+/**************************************************************************
+NFS3_FSINFO - Find out the server's preferred read size
+**************************************************************************/
+static void nfs3_fsinfo_req(void)
+{
+	uint32_t data[1024];
+	uint32_t *p;
+	int len;
+
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	*p++ = htonl(filefh3_length);
+	memcpy(p, filefh, filefh3_length);
+	p += (filefh3_length / 4);
+
+	len = (uint32_t *)p - (uint32_t *)&(data[0]);
+
+	rpc_req(PROG_NFS, NFS3PROC_FSINFO, data, len);
+}
+
 /**************************************************************************
 RPC request dispatcher
 **************************************************************************/
@@ -431,11 +539,14 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_send();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
 		break;
+	case STATE_FSINFO_REQ:
+		nfs3_fsinfo_req();
+		break;
 	}
 }
 
@@ -680,21 +791,75 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs3_fsinfo_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
-	uchar *data_ptr;
+	int nfsv3_data_offset;
+	unsigned int size;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	memcpy((unsigned char *)&rpc_pkt, pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
 	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
 		return -NFS_RPC_DROP;
 
+	if (rpc_pkt.u.reply.rstatus  ||
+	    rpc_pkt.u.reply.verifier ||
+	    rpc_pkt.u.reply.astatus  ||
+	    rpc_pkt.u.reply.data[0])
+		return -1;
+
+	nfsv3_data_offset = nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
+	if (((uchar *)&(rpc_pkt.u.reply.data[3 + nfsv3_data_offset]) -
+	     (uchar *)(&rpc_pkt)) > len)
+		return -1;
+
+	/* Skip rtmax and use rtpref, within what we can reassemble */
+	size = ntohl(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]);
+
+	return clamp_t(unsigned int, size, NFS_READ_SIZE, NFS3_READ_SIZE_MAX);
+}
+
+/* Print a hash for each 5KiB of the file, in whatever order it arrives */
+static void nfs_show_progress(unsigned int len)
+{
+	const unsigned int step = NFS_READ_SIZE / 2 * 10;
+	unsigned int hash;
+
+	for (hash = DIV_ROUND_UP(nfs_received, step);
+	     hash * step < nfs_received + len; hash++) {
+		if (hash && !(hash % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+	}
+	nfs_received += len;
+}
+
+static int nfs_read_reply(uchar *pkt, unsigned len)
+{
+	struct nfs_read_slot *slot, *other;
+	struct rpc_t rpc_pkt;
+	unsigned long id;
+	uchar *data_ptr;
+	bool eof;
+	int rlen;
+
+	debug("%s\n", __func__);
+
+	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+
+	id = ntohl(rpc_pkt.u.reply.id);
+	for (slot = nfs_read_slots; slot < nfs_read_slots + nfs_read_window;
+	     slot++) {
+		if (id && slot->id == id)
+			break;
+	}
+	if (slot == nfs_read_slots + nfs_read_window)
+		return -NFS_RPC_DROP;
+
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
 	    rpc_pkt.u.reply.astatus  ||
@@ -706,38 +871,71 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (choosen_nfs_version == NFS_V2) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
 		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		/* There is no EOF flag, but only the last read is short */
+		eof = rlen < slot->len;
 	} else {  /* NFS_V3 */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+		eof = ntohl(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]);
 		/* Skip unused values :
-			EOF:		32 bits value,
 			data_size:	32 bits value,
 		*/
 		data_ptr = (uchar *)
 			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
 	}
 
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
-			return -9999;
-
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
+	/* Large reads do not fit in rpc_pkt, so take the data from pkt */
+	data_ptr = pkt + (data_ptr - (uchar *)&rpc_pkt);
+	if (rlen < 0 || rlen > slot->len || data_ptr + rlen > pkt + len)
+		return -9999;
+
+	if (store_block(data_ptr, slot->offset, rlen))
+		return -9999;
+	nfs_show_progress(rlen);
+
+	if (eof || !rlen) {
+		/* Requests beyond the end of the file are not needed */
+		nfs_eof = true;
+		for (other = nfs_read_slots;
+		     other < nfs_read_slots + nfs_read_window; other++) {
+			if (other->offset >= slot->offset + rlen)
+				other->id = 0;
+		}
+		slot->id = 0;
+	} else if (rlen < slot->len) {
+		/* Ask for the rest, using smaller requests from now on */
+		slot->offset += rlen;
+		slot->len -= rlen;
+		nfs_read_size = min_t(unsigned int, nfs_read_size, rlen);
+		nfs_read_slot_send(slot);
+	} else {
+		slot->id = 0;
+	}
 
 	return rlen;
 }
 
+/* Start reading the file, keeping up to nfswindowsize requests in flight */
+static void nfs_read_start(unsigned int size)
+{
+	nfs_state = STATE_READ_REQ;
+	nfs_offset = 0;
+	nfs_read_size = size;
+	nfs_received = 0;
+	nfs_eof = false;
+	nfs_read_window = clamp_t(ulong, env_get_ulong("nfswindowsize", 10,
+						       CONFIG_NFS_READ_WINDOW),
+				  1, NFS_READ_WINDOW_MAX);
+	memset(nfs_read_slots, 0, sizeof(nfs_read_slots));
+	nfs_send();
+}
+
 /**************************************************************************
 Interfaces of U-BOOT
 **************************************************************************/
@@ -763,7 +961,8 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	debug("%s\n", __func__);
 
-	if (len > sizeof(struct rpc_t))
+	/* Only READ replies may be larger, when they were reassembled */
+	if (len > sizeof(struct rpc_t) && nfs_state != STATE_READ_REQ)
 		return;
 
 	if (dest != nfs_our_port)
@@ -832,14 +1031,23 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			/* And retry with another supported version */
 			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 			nfs_send();
-		} else {
-			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
+		} else if (choosen_nfs_version == NFS_V3 &&
+			   IS_ENABLED(CONFIG_IP_DEFRAG)) {
+			nfs_state = STATE_FSINFO_REQ;
 			nfs_send();
+		} else {
+			nfs_read_start(NFS_READ_SIZE);
 		}
 		break;
 
+	case STATE_FSINFO_REQ:
+		reply = nfs3_fsinfo_reply(pkt, len);
+		if (reply == -NFS_RPC_DROP)
+			break;
+		/* Fall back to the default size if the server does not say */
+		nfs_read_start(reply > 0 ? reply : NFS_READ_SIZE);
+		break;
+
 	case STATE_READLINK_REQ:
 		reply = nfs_readlink_reply(pkt, len);
 		if (reply == -NFS_RPC_DROP) {
@@ -863,18 +1071,20 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
+		if (rlen >= 0) {
+			if (nfs_read_done()) {
+				nfs_download_state = NETLOOP_SUCCESS;
+				nfs_state = STATE_UMOUNT_REQ;
+				nfs_send();
+			} else {
+				nfs_read_fill();
+			}
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
@@ -20,10 +20,13 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <env.h>
 #include <env_internal.h>
 #include <errno.h>
 #include <net.h>
 #include <net/tcp.h>
+#include <linux/kernel.h>
+#include <linux/sizes.h>
 
 /*
  * TCP sliding window  control used by us to request re-TX
@@ -39,6 +42,20 @@ static u32 tcp_ack_edge;
 
 static int tcp_activity_count;
 
+/*
+ * Receive window. Data is stored by the application as it comes in, so the
+ * window is not backed by a buffer here; it only limits how much the
+ * server may send ahead of our acknowledgments.
+ */
+static u32 tcp_rx_window;	/* receive window in bytes */
+static u8 tcp_rx_scale;		/* shift applied to the advertised window */
+static bool tcp_wscale_ok;	/* the server accepted window scaling */
+static ulong tcp_rx_window_max;	/* limit set by the application, 0 if none */
+
+/* Delayed acknowledgments */
+static unsigned int tcp_unacked;	/* segments not acknowledged yet */
+static bool tcp_ack_delay;		/* the last segment may wait */
+
 /*
  * Search for TCP_SACK and review the comments before the code section
  * TCP_SACK is the number of packets at the front of the stream
@@ -210,16 +227,29 @@ int net_set_ack_options(union tcp_build_pkt *b)
  */
 void net_set_syn_options(union tcp_build_pkt *b)
 {
+	ulong win;
+
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK))
 		tcp_lost.len = 0;
 
+	win = env_get_ulong("tcpwindowsize", 10,
+			    CONFIG_PROT_TCP_RX_WINDOW * SZ_1K);
+	if (tcp_rx_window_max)
+		win = min(win, tcp_rx_window_max);
+	tcp_rx_window = clamp_t(ulong, win, TCP_MSS,
+				(ulong)U16_MAX << TCP_MAX_SCALE);
+	for (tcp_rx_scale = 0; tcp_rx_window >> tcp_rx_scale > U16_MAX;)
+		tcp_rx_scale++;
+	tcp_wscale_ok = false;
+	tcp_unacked = 0;
+
 	b->ip.hdr.tcp_hlen = 0xa0;
 
 	b->ip.mss.kind = TCP_O_MSS;
 	b->ip.mss.len = TCP_OPT_LEN_4;
 	b->ip.mss.mss = htons(TCP_MSS);
 	b->ip.scale.kind = TCP_O_SCL;
-	b->ip.scale.scale = TCP_SCALE;
+	b->ip.scale.scale = tcp_rx_scale;
 	b->ip.scale.len = TCP_OPT_LEN_3;
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
 		b->ip.sack_p.kind = TCP_P_SACK;
@@ -319,6 +349,7 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	tcp_len	= pkt_len - IP_HDR_SIZE;
 
 	tcp_ack_edge = tcp_ack_num;
+	tcp_unacked = 0;
 	/* TCP Header */
 	b->ip.hdr.tcp_ack = htonl(tcp_ack_edge);
 	b->ip.hdr.tcp_src = htons(sport);
@@ -339,8 +370,15 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	 * SOCs is may not be considered a constraint to buffer space, if
 	 * it is, then the u-boot tftp or nfs kernel netboot should be
 	 * considered.
+	 *
+	 * The window is set by CONFIG_PROT_TCP_RX_WINDOW or the tcpwindowsize
+	 * environment variable. The window in a SYN is never scaled, later
+	 * ones are if the server agreed to it (RFC 7323).
 	 */
-	b->ip.hdr.tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	if ((b->ip.hdr.tcp_flags & TCP_SYN) || !tcp_wscale_ok)
+		b->ip.hdr.tcp_win = htons(min_t(u32, tcp_rx_window, U16_MAX));
+	else
+		b->ip.hdr.tcp_win = htons(tcp_rx_window >> tcp_rx_scale);
 
 	b->ip.hdr.tcp_xsum = 0;
 	b->ip.hdr.tcp_ugr = 0;
@@ -470,36 +508,76 @@ void tcp_hole(u32 tcp_seq_num, u32 len)
 void tcp_parse_options(uchar *o, int o_len)
 {
 	struct tcp_t_opt  *tsopt;
+	uchar *end = o + o_len;
 	uchar *p = o;
 
 	/*
 	 * NOPs are options with a zero length, and thus are special.
 	 * All other options have length fields.
 	 */
-	for (p = o; p < (o + o_len); p = p + p[1]) {
-		if (!p[1])
-			return; /* Finished processing options */
-
+	while (p < end) {
 		switch (p[0]) {
 		case TCP_O_END:
 			return;
-		case TCP_O_MSS:
+		case TCP_1_NOP:
+			p++;
+			continue;
 		case TCP_O_SCL:
-		case TCP_P_SACK:
-		case TCP_V_SACK:
+			/* only sent in a SYN, with the shift for its sender */
+			tcp_wscale_ok = true;
 			break;
 		case TCP_O_TS:
 			tsopt = (struct tcp_t_opt *)p;
 			rmt_timestamp = tsopt->t_snd;
-			return;
+			break;
 		}
 
-		/* Process optional NOPs */
-		if (p[0] == TCP_O_NOP)
-			p++;
+		if (p + 1 >= end || p[1] < TCP_OPT_LEN_2)
+			return;
+		p += p[1];
 	}
 }
 
+/**
+ * tcp_can_delay_ack() - check whether a data segment can be ACKed later
+ * @tcp_seq_num: TCP sequence number of the segment
+ * @len: length of the segment
+ *
+ * Every CONFIG_PROT_TCP_ACK_SEGMENTS-th segment is acknowledged, as is any
+ * segment which leaves or fills a hole in the stream, so that the server
+ * learns about losses at once (RFC 5681, section 4.2).
+ *
+ * Return: true if the ACK can wait, false if it must be sent now
+ */
+static bool tcp_can_delay_ack(u32 tcp_seq_num, int len)
+{
+	if (tcp_ack_edge != tcp_seq_num + len)
+		return false;
+	if (IS_ENABLED(CONFIG_PROT_TCP_SACK) && tcp_lost.len > TCP_OPT_LEN_2)
+		return false;
+
+	return ++tcp_unacked < CONFIG_PROT_TCP_ACK_SEGMENTS;
+}
+
+void tcp_limit_rx_window(ulong max)
+{
+	tcp_rx_window_max = max;
+}
+
+/**
+ * tcp_delay_ack() - check whether the ACK of the last segment can wait
+ *
+ * Called by the packet handler for a data segment. If this returns true,
+ * the handler may hold back the ACK until the next segment comes in, or for
+ * at most TCP_DELACK_TIMEOUT.
+ *
+ * Return: true if the ACK can wait, false if it must be sent now
+ */
+bool tcp_delay_ack(void)
+{
+	return tcp_ack_delay;
+}
+
 static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 {
 	u8 tcp_fin = tcp_flags & TCP_FIN;
@@ -520,6 +598,7 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 	 * congestion, the network is broken.
 	 */
 	debug_cond(DEBUG_INT_STATE, "TCP STATE ENTRY %x\n", action);
+	tcp_ack_delay = false;
 	if (tcp_rst) {
 		action = TCP_DATA;
 		current_tcp_state = TCP_CLOSED;
@@ -569,6 +648,8 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 		debug_cond(DEBUG_INT_STATE, "TCP_ESTABLISHED %x\n", tcp_flags);
 		if (payload_len > 0) {
 			tcp_hole(tcp_seq_num, payload_len);
+			tcp_ack_delay = tcp_can_delay_ack(tcp_seq_num,
+							  payload_len);
 			tcp_fin = TCP_DATA;  /* cause standalone FIN */
 		}
 
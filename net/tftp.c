@@ -17,6 +17,8 @@
 #include <net.h>
 #include <net6.h>
 #include <asm/global_data.h>
+#include <linux/bitmap.h>
+#include <net/decompress.h>
 #include <net/tftp.h>
 #include "bootp.h"
 
@@ -98,6 +100,23 @@ static ushort	tftp_windowsize;
 static ushort	tftp_next_ack;
 /* Last nack block we send */
 static ushort	tftp_last_nack;
+/*
+ * Blocks which arrived ahead of a missing one are stored straight away and
+ * marked here, indexed by absolute block number modulo TFTP_EARLY_BLOCKS, so
+ * that they need not be received again once the gap is filled.
+ */
+#define TFTP_EARLY_BLOCKS	256
+static DECLARE_BITMAP(tftp_early, TFTP_EARLY_BLOCKS);
+/* Number of bits set in tftp_early */
+static int	tftp_early_count;
+/* Absolute number of the final (short) block if it arrived early, else 0 */
+static ulong	tftp_final_block;
+/* Transfer statistics, shown when the window size is more than 1 */
+static ulong	tftp_stat_blocks;
+static ulong	tftp_stat_early;
+static ulong	tftp_stat_dups;
+static ulong	tftp_stat_nacks;
+static ulong	tftp_stat_timeouts;
 #ifdef CONFIG_CMD_TFTPPUT
 /* 1 if writing, else 0 */
 static int	tftp_put_active;
@@ -152,15 +171,46 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
+/* Window size requested, adapted to the loss seen by earlier transfers */
+static unsigned short tftp_window_size_adapt;
 
-static inline int store_block(int block, uchar *src, unsigned int len)
+/* Absolute (unwrapped) number of the last in-order block received */
+static ulong tftp_abs_block(void)
 {
-	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
-			tftp_block_size;
+	return tftp_block_wrap * TFTP_SEQUENCE_SIZE + tftp_cur_block;
+}
+
+/* Space for the file at the load address, 0 if not known */
+static ulong tftp_load_limit(void)
+{
+#ifdef CONFIG_LMB
+	return tftp_load_size;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * store_block() - Store a received data block in memory
+ *
+ * @block: Absolute block number, starting at 1 and not wrapped
+ * @src: Block data
+ * @len: Number of bytes in the block
+ * Return: 0 if OK, -1 if the block is outside the load area
+ */
+static inline int store_block(ulong block, uchar *src, unsigned int len)
+{
+	ulong offset = (block - 1) * tftp_block_size;
 	ulong newsize = offset + len;
 	ulong store_addr = tftp_load_addr + offset;
 	void *ptr;
 
+	if (net_decomp_active()) {
+		if (net_decomp_write(offset, src, len))
+			return -1;
+		goto stored;
+	}
+
 #ifdef CONFIG_LMB
 	ulong end_addr = tftp_load_addr + tftp_load_size;
 
@@ -178,6 +228,7 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 	memcpy(ptr, src, len);
 	unmap_sysmem(ptr);
 
+stored:
 	if (net_boot_file_size < newsize)
 		net_boot_file_size = newsize;
 
@@ -190,6 +241,9 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	bitmap_zero(tftp_early, TFTP_EARLY_BLOCKS);
+	tftp_early_count = 0;
+	tftp_final_block = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -283,9 +337,84 @@ static void update_block_number(void)
 	show_block_marker();
 }
 
+/**
+ * tftp_store_early() - Store a block which arrived before an earlier one
+ *
+ * @block: Absolute block number
+ * @src: Block data
+ * @len: Number of bytes in the block
+ */
+static void tftp_store_early(ulong block, uchar *src, unsigned int len)
+{
+	int bit = block % TFTP_EARLY_BLOCKS;
+
+	if (tftp_state != STATE_DATA ||
+	    block - tftp_abs_block() >= TFTP_EARLY_BLOCKS ||
+	    test_bit(bit, tftp_early)) {
+		tftp_stat_dups++;
+		return;
+	}
+	if (len > tftp_block_size || store_block(block, src, len))
+		return;
+
+	__set_bit(bit, tftp_early);
+	tftp_early_count++;
+	tftp_stat_early++;
+	if (len < tftp_block_size)
+		tftp_final_block = block;
+}
+
+/**
+ * tftp_take_early() - Advance over blocks which were stored early
+ *
+ * Return: true if any blocks were taken
+ */
+static bool tftp_take_early(void)
+{
+	bool taken = false;
+	int bit;
+
+	while (tftp_early_count) {
+		bit = (tftp_abs_block() + 1) % TFTP_EARLY_BLOCKS;
+		if (!test_bit(bit, tftp_early))
+			break;
+		__clear_bit(bit, tftp_early);
+		tftp_early_count--;
+		tftp_stat_blocks++;
+		tftp_cur_block = (tftp_cur_block + 1) % TFTP_SEQUENCE_SIZE;
+		update_block_number();
+		tftp_prev_block = tftp_cur_block;
+		taken = true;
+	}
+
+	return taken;
+}
+
+/*
+ * Pick the window size to request next time: shrink it when this transfer
+ * had to recover from more than a little loss and grow it back towards the
+ * configured size when there was none.
+ */
+static void tftp_adapt_window_size(void)
+{
+	ulong lost, limit = tftp_window_size_option;
+
+	if (!IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPTIVE) || !tftp_stat_blocks)
+		return;
+
+	lost = tftp_stat_nacks + tftp_stat_timeouts;
+	if (lost * 500 >= tftp_stat_blocks)
+		tftp_window_size_adapt = max(tftp_windowsize / 2, 1);
+	else if (!lost)
+		tftp_window_size_adapt = min((ulong)tftp_windowsize * 2, limit);
+	debug("next windowsize = %d\n", tftp_window_size_adapt);
+}
+
 /* The TFTP get or put is complete */
 static void tftp_complete(void)
 {
+	ulong size;
+
 #ifdef CONFIG_TFTP_TSIZE
 	/* Print hash marks for the last packet received */
 	while (tftp_tsize && tftp_tsize_num_hash < 49) {
@@ -301,7 +430,20 @@ static void tftp_complete(void)
 		print_size(net_boot_file_size /
 			time_start * 1000, "/s");
 	}
+	if (!tftp_put_active && tftp_windowsize > 1)
+		printf("\n\t Window %d: %lu blocks, %lu early, %lu duplicate, %lu gaps, %lu timeouts",
+		       tftp_windowsize, tftp_stat_blocks, tftp_stat_early,
+		       tftp_stat_dups, tftp_stat_nacks, tftp_stat_timeouts);
+	if (!tftp_put_active)
+		tftp_adapt_window_size();
 	puts("\ndone\n");
+	if (!tftp_put_active && net_decomp_active()) {
+		if (net_decomp_finish(&size)) {
+			net_set_state(NETLOOP_FAIL);
+			return;
+		}
+		net_boot_file_size = size;
+	}
 	if (!tftp_put_active)
 		efi_set_bootdev("Net", "", tftp_filename,
 				map_sysmem(tftp_load_addr, 0),
@@ -360,9 +502,9 @@ static void tftp_send(void)
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
 		 */
-		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_adapt > 1)
 			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
-					0, tftp_window_size_option, 0);
+					0, tftp_window_size_adapt, 0);
 		len = pkt - xp;
 		break;
 
@@ -459,6 +601,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	__be16 *s;
 	int i;
 	u16 timeout_val_rcvd;
+	bool early;
 
 	if (dest != tftp_our_port) {
 			return;
@@ -587,6 +730,9 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 
 		if (ntohs(*(__be16 *)pkt) != (ushort)(tftp_cur_block + 1)) {
+			ushort ahead = ntohs(*(__be16 *)pkt) -
+				       (ushort)(tftp_cur_block + 1);
+
 			debug("Received unexpected block: %d, expected: %d\n",
 			      ntohs(*(__be16 *)pkt),
 			      (ushort)(tftp_cur_block + 1));
@@ -596,8 +742,12 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 * (required to properly handle the server retransmitting
 			 *  the window)
 			 */
-			if ((ushort)(tftp_cur_block + 1) - (short)(ntohs(*(__be16 *)pkt)) > 0)
+			if ((short)ahead < 0) {
+				tftp_stat_dups++;
 				break;
+			}
+			tftp_store_early(tftp_abs_block() + 1 + ahead, pkt + 2,
+					 len);
 			/*
 			 * If one packet is dropped most likely
 			 * all other buffers in the window
@@ -609,6 +759,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				tftp_last_nack = tftp_cur_block;
 				tftp_next_ack = (ushort)(tftp_cur_block +
 							 tftp_windowsize);
+				tftp_stat_nacks++;
 			}
 			break;
 		}
@@ -627,6 +778,10 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			tftp_state = STATE_DATA;
 			tftp_remote_port = src;
 			new_transfer();
+			if (net_decomp_start(tftp_load_addr, tftp_load_limit())) {
+				net_set_state(NETLOOP_FAIL);
+				break;
+			}
 
 			if (tftp_cur_block != 1) {	/* Assertion */
 				puts("\nTFTP error: ");
@@ -648,13 +803,18 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		timeout_count_max = tftp_timeout_count_max;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-		if (store_block(tftp_cur_block, pkt + 2, len)) {
+		if (store_block(tftp_abs_block(), pkt + 2, len)) {
 			eth_halt();
 			net_set_state(NETLOOP_FAIL);
 			break;
 		}
+		tftp_stat_blocks++;
 
-		if (len < tftp_block_size) {
+		/* Move past any blocks which filled the rest of a gap */
+		early = tftp_take_early();
+
+		if (len < tftp_block_size ||
+		    (tftp_final_block && tftp_abs_block() == tftp_final_block)) {
 			tftp_send();
 			tftp_complete();
 			break;
@@ -662,11 +822,14 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 		/*
 		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
+		 *	the remote for the next one. After a gap has been
+		 *	filled, acknowledge at once so that the server does not
+		 *	resend the blocks we already have.
 		 */
-		if (tftp_cur_block == tftp_next_ack) {
+		if (early || (short)(tftp_cur_block - tftp_next_ack) >= 0) {
 			tftp_send();
-			tftp_next_ack += tftp_windowsize;
+			tftp_next_ack = (ushort)(tftp_cur_block +
+						 tftp_windowsize);
 		}
 		break;
 
@@ -698,6 +861,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 static void tftp_timeout_handler(void)
 {
+	tftp_stat_timeouts++;
 	if (++timeout_count > timeout_count_max) {
 		restart("Retry count exceeded");
 	} else {
@@ -712,12 +876,9 @@ static void tftp_timeout_handler(void)
 static int tftp_init_load_addr(void)
 {
 #ifdef CONFIG_LMB
-	struct lmb lmb;
 	phys_size_t max_size;
 
-	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
-
-	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	max_size = lmb_get_free_size(lmb_get(), image_load_addr);
 	if (!max_size)
 		return -1;
 
@@ -813,6 +974,11 @@ void tftp_start(enum proto_t protocol)
 
 	sanitize_tftp_block_size_option(protocol);
 
+	if (!IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPTIVE) ||
+	    !tftp_window_size_adapt ||
+	    tftp_window_size_adapt > tftp_window_size_option)
+		tftp_window_size_adapt = tftp_window_size_option;
+
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
 	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
 
@@ -944,6 +1110,11 @@ void tftp_start(enum proto_t protocol)
 	tftp_cur_block = 0;
 	tftp_windowsize = 1;
 	tftp_last_nack = 0;
+	tftp_stat_blocks = 0;
+	tftp_stat_early = 0;
+	tftp_stat_dups = 0;
+	tftp_stat_nacks = 0;
+	tftp_stat_timeouts = 0;
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
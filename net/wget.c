@@ -13,6 +13,7 @@
 #include <lmb.h>
 #include <mapmem.h>
 #include <net.h>
+#include <net/decompress.h>
 #include <net/tcp.h>
 #include <net/wget.h>
 #include <stdlib.h>
@@ -22,11 +23,7 @@ DECLARE_GLOBAL_DATA_PTR;
 /* The default, change with environment variable 'httpdstp' */
 #define SERVER_PORT		80
 
-static const char bootfile1[] = "GET ";
-static const char bootfile3[] = " HTTP/1.0\r\n\r\n";
 static const char http_eom[] = "\r\n\r\n";
-static const char http_ok[] = "200";
-static const char content_len[] = "Content-Length";
 static const char linefeed[] = "\r\n";
 static struct in_addr web_server_ip;
 static int our_port;
@@ -63,9 +60,26 @@ static u8 retry_action;			/* actions for TCP retry */
 static unsigned int retry_tcp_ack_num;	/* TCP retry acknowledge number*/
 static unsigned int retry_tcp_seq_num;	/* TCP retry sequence number */
 static int retry_len;			/* TCP retry length */
+static bool wget_ack_pending;		/* ACK held back by tcp_delay_ack() */
 
 static ulong wget_load_size;
 
+static ulong wget_range_start;	/* offset of the response body in the file */
+static ulong wget_contig;	/* body bytes received without a gap */
+static bool wget_keep_alive;	/* server keeps the connection open */
+static bool wget_resume;	/* ask for the rest of a partial file */
+static bool wget_restart;	/* carry on with the current file */
+
+/* Further files fetched from the same server */
+struct wget_file {
+	ulong addr;
+	char *path;
+};
+
+static struct wget_file wget_files[WGET_MAX_FILES];
+static int wget_file_count;
+static int wget_file_idx;
+
 /**
  * wget_init_max_size() - initialize maximum load size
  *
@@ -73,12 +87,9 @@ static ulong wget_load_size;
  */
 static int wget_init_load_size(void)
 {
-	struct lmb lmb;
 	phys_size_t max_size;
 
-	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
-
-	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	max_size = lmb_get_free_size(lmb_get(), image_load_addr);
 	if (!max_size)
 		return -1;
 
@@ -92,12 +103,23 @@ static int wget_init_load_size(void)
  * @src: source of data
  * @offset: offset
  * @len: length
+ *
+ * Return: 0 if OK, -ENOSPC if the block must be sent again later, other -ve
+ * value on error
  */
 static inline int store_block(uchar *src, unsigned int offset, unsigned int len)
 {
-	ulong store_addr = image_load_addr + offset;
-	ulong newsize = offset + len;
+	ulong store_addr = image_load_addr + wget_range_start + offset;
+	ulong newsize = wget_range_start + offset + len;
 	uchar *ptr;
+	int ret;
+
+	if (net_decomp_active()) {
+		ret = net_decomp_write(offset, src, len);
+		if (ret)
+			return ret;
+		goto stored;
+	}
 
 	if (IS_ENABLED(CONFIG_LMB)) {
 		ulong end_addr = image_load_addr + wget_load_size;
@@ -117,12 +139,49 @@ static inline int store_block(uchar *src, unsigned int offset, unsigned int len)
 	memcpy(ptr, src, len);
 	unmap_sysmem(ptr);
 
-	if (net_boot_file_size < (offset + len))
+stored:
+	if (net_boot_file_size < newsize)
 		net_boot_file_size = newsize;
+	if (offset <= wget_contig && offset + len > wget_contig)
+		wget_contig = offset + len;
 
 	return 0;
 }
 
+/**
+ * wget_build_request() - build the HTTP request for the current file
+ * @buf: buffer for the request
+ * @size: size of @buf
+ * @port: destination port of the server
+ *
+ * The connection is kept open as long as more files are to be fetched.
+ *
+ * Return: length of the request
+ */
+static int wget_build_request(char *buf, int size, unsigned int port)
+{
+	char host_port[8] = "";
+	char range[32] = "";
+	int len;
+
+	if (port != SERVER_PORT)
+		snprintf(host_port, sizeof(host_port), ":%u", port);
+	if (wget_range_start)
+		snprintf(range, sizeof(range), "Range: bytes=%lu-\r\n",
+			 wget_range_start);
+
+	len = snprintf(buf, size,
+		       "GET %s HTTP/1.1\r\n"
+		       "Host: %pI4%s\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "%s"
+		       "Connection: %s\r\n\r\n",
+		       image_url, &web_server_ip, host_port, range,
+		       wget_file_idx < wget_file_count ? "keep-alive" : "close");
+
+	return min(len, size - 1);
+}
+
 /**
  * wget_send_stored() - wget response dispatcher
  *
@@ -138,7 +197,8 @@ static void wget_send_stored(void)
 	unsigned int tcp_ack_num = retry_tcp_seq_num + (len == 0 ? 1 : len);
 	unsigned int tcp_seq_num = retry_tcp_ack_num;
 	unsigned int server_port;
-	uchar *ptr, *offset;
+	int req_len;
+	uchar *ptr;
 
 	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
 
@@ -157,17 +217,10 @@ static void wget_send_stored(void)
 
 		ptr = net_tx_packet + net_eth_hdr_size() +
 			IP_TCP_HDR_SIZE + TCP_TSOPT_SIZE + 2;
-		offset = ptr;
-
-		memcpy(offset, &bootfile1, strlen(bootfile1));
-		offset += strlen(bootfile1);
-
-		memcpy(offset, image_url, strlen(image_url));
-		offset += strlen(image_url);
-
-		memcpy(offset, &bootfile3, strlen(bootfile3));
-		offset += strlen(bootfile3);
-		net_send_tcp_packet((offset - ptr), server_port, our_port,
+		req_len = wget_build_request((char *)ptr,
+					     PKTSIZE - (ptr - net_tx_packet),
+					     server_port);
+		net_send_tcp_packet(req_len, server_port, our_port,
 				    TCP_PUSH, tcp_seq_num, tcp_ack_num);
 		current_wget_state = WGET_CONNECTED;
 		break;
@@ -187,6 +240,7 @@ static void wget_send(u8 action, unsigned int tcp_seq_num,
 	retry_tcp_ack_num = tcp_ack_num;
 	retry_tcp_seq_num = tcp_seq_num;
 	retry_len = len;
+	wget_ack_pending = false;
 
 	wget_send_stored();
 }
@@ -206,15 +260,66 @@ void wget_success(u8 action, unsigned int tcp_seq_num,
 	wget_send(action, tcp_seq_num, tcp_ack_num, len);
 }
 
+/**
+ * wget_save_partial() - record what was received of an interrupted file
+ *
+ * filesize and fileaddr are set to the data received so far, so that the
+ * download carries on from there when it is started again.
+ */
+static void wget_save_partial(void)
+{
+	ulong size = wget_range_start + wget_contig;
+
+	/* a download being decompressed cannot be resumed */
+	if (current_wget_state != WGET_TRANSFERRING || !size ||
+	    net_decomp_active())
+		return;
+
+	env_set_hex("filesize", size);
+	env_set_hex("fileaddr", image_load_addr);
+	wget_resume = true;
+}
+
 /*
  * Interfaces of U-BOOT
  */
+static void wget_timeout_handler(void);
+
+/**
+ * wget_delay_ack() - hold back the ACK of a segment
+ * @tcp_seq_num: TCP sequence number of the segment
+ * @tcp_ack_num: TCP acknowledgment number of the segment
+ * @len: length of the segment
+ *
+ * The ACK goes out with that of the next segment, or when the delayed ACK
+ * timer expires.
+ */
+static void wget_delay_ack(unsigned int tcp_seq_num,
+			   unsigned int tcp_ack_num, int len)
+{
+	retry_action = TCP_ACK;
+	retry_tcp_ack_num = tcp_ack_num;
+	retry_tcp_seq_num = tcp_seq_num;
+	retry_len = len;
+	wget_ack_pending = true;
+
+	net_set_timeout_handler(TCP_DELACK_TIMEOUT, wget_timeout_handler);
+}
+
 static void wget_timeout_handler(void)
 {
-	if (++wget_timeout_count > WGET_RETRY_COUNT) {
+	if (wget_ack_pending) {
+		wget_ack_pending = false;
+		net_set_timeout_handler(wget_timeout, wget_timeout_handler);
+		wget_send_stored();
+	} else if (++wget_timeout_count > WGET_RETRY_COUNT) {
 		puts("\nRetry count exceeded; starting again\n");
+		wget_save_partial();
 		wget_send(TCP_RST, 0, 0, 0);
+		wget_restart = true;
 		net_start_again();
+		if (net_state != NETLOOP_RESTART)
+			wget_restart = false;
 	} else {
 		puts("T ");
 		net_set_timeout_handler(wget_timeout +
@@ -224,16 +329,213 @@ static void wget_timeout_handler(void)
 	}
 }
 
+#define RANDOM_PORT_START 1024
+#define RANDOM_PORT_RANGE 0x4000
+
+/**
+ * random_port() - make port a little random (1024-17407)
+ *
+ * Return: random port number from 1024 to 17407
+ *
+ * This keeps the math somewhat trivial to compute, and seems to work with
+ * all supported protocols/clients/servers
+ */
+static unsigned int random_port(void)
+{
+	return RANDOM_PORT_START + (get_timer(0) % RANDOM_PORT_RANGE);
+}
+
 #define PKT_QUEUE_OFFSET 0x20000
 #define PKT_QUEUE_PACKET_SIZE 0x800
 
+/**
+ * wget_find_header() - find a field in the header of an HTTP response
+ * @hdr: response header, NUL-terminated
+ * @name: field name, without the colon
+ *
+ * Return: pointer to the field value, or NULL if the field is not present
+ */
+static char *wget_find_header(char *hdr, const char *name)
+{
+	size_t len = strlen(name);
+	char *line = strstr(hdr, linefeed);
+
+	while (line) {
+		line += strlen(linefeed);
+		if (!strncasecmp(line, name, len) && line[len] == ':') {
+			line += len + 1;
+			while (*line == ' ')
+				line++;
+			return line;
+		}
+		line = strstr(line, linefeed);
+	}
+
+	return NULL;
+}
+
+/**
+ * wget_parse_header() - check the header of an HTTP response
+ * @hdr: response header, NUL-terminated
+ *
+ * Accept a complete file, or the rest of it if a range was requested, and
+ * note the length of the body and whether the connection stays open.
+ *
+ * Return: 0 if the body is to be stored, -ve on error
+ */
+static int wget_parse_header(char *hdr)
+{
+	char *pos;
+	int status;
+
+	if (strncmp(hdr, "HTTP/1.", 7))
+		return -EPROTO;
+	status = simple_strtoul(hdr + 9, NULL, 10);
+
+	pos = wget_find_header(hdr, "Connection");
+	wget_keep_alive = hdr[7] == '1' &&
+			  !(pos && !strncasecmp(pos, "close", 5));
+
+	if (status == 200) {
+		/* the whole file is coming, whatever was asked for */
+		wget_range_start = 0;
+	} else if (status == 206) {
+		pos = wget_find_header(hdr, "Content-Range");
+		if (!pos || strncasecmp(pos, "bytes ", 6) ||
+		    simple_strtoul(pos + 6, NULL, 10) != wget_range_start) {
+			printf("\nwget: unexpected Content-Range\n");
+			return -EPROTO;
+		}
+	} else {
+		return -EPROTO;
+	}
+
+	pos = wget_find_header(hdr, "Transfer-Encoding");
+	if (pos && strncasecmp(pos, "identity", 8)) {
+		printf("\nwget: transfer encoding not supported\n");
+		return -EPROTO;
+	}
+
+	pos = wget_find_header(hdr, "Content-Length");
+	content_length = pos ? simple_strtoul(pos, NULL, 10) : -1;
+	debug_cond(DEBUG_WGET, "wget: Connected Len %lu\n", content_length);
+
+	return 0;
+}
+
+/**
+ * wget_body_done() - check whether the whole body has been received
+ *
+ * Return: true if the body has a known length and all of it is in
+ */
+static bool wget_body_done(void)
+{
+	return content_length != -1 &&
+	       net_boot_file_size >= wget_range_start + content_length;
+}
+
+/**
+ * wget_decomp_finish() - finish decompressing the file just received
+ *
+ * If the file was decompressed, net_boot_file_size is set to the size of
+ * the uncompressed data.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+static int wget_decomp_finish(void)
+{
+	ulong size;
+	int ret;
+
+	if (!net_decomp_active())
+		return 0;
+
+	ret = net_decomp_finish(&size);
+	if (ret) {
+		wget_loop_state = NETLOOP_FAIL;
+		return ret;
+	}
+	net_boot_file_size = size;
+
+	return 0;
+}
+
+/**
+ * wget_next_file() - move on to the next file of the command
+ *
+ * Return: true if there is another file to fetch, false otherwise
+ */
+static bool wget_next_file(void)
+{
+	struct wget_file *f;
+
+	if (wget_file_idx >= wget_file_count)
+		return false;
+
+	if (wget_decomp_finish()) {
+		net_set_state(NETLOOP_FAIL);
+		return false;
+	}
+	printf("\nPackets received %d, Transfer Successful\n", packets);
+	printf("Bytes transferred = %u (%x hex)\n",
+	       net_boot_file_size, net_boot_file_size);
+
+	f = &wget_files[wget_file_idx++];
+	image_load_addr = f->addr;
+	image_url = f->path;
+	wget_range_start = 0;
+	net_boot_file_size = 0;
+	packets = 0;
+
+	if (IS_ENABLED(CONFIG_LMB) && wget_init_load_size()) {
+		printf("\nwget error: ");
+		printf("trying to overwrite reserved memory...\n");
+		wget_loop_state = NETLOOP_FAIL;
+		net_set_state(NETLOOP_FAIL);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * wget_reuse_connection() - check whether to ask for the next file
+ *
+ * Once a file is complete, the next one is requested on the same connection
+ * if the server keeps it open.
+ *
+ * Return: true if the next file is to be requested on this connection
+ */
+static bool wget_reuse_connection(void)
+{
+	return wget_loop_state == NETLOOP_SUCCESS && wget_keep_alive &&
+	       wget_body_done() && wget_next_file();
+}
+
+/**
+ * wget_connect() - open a new connection to the server
+ */
+static void wget_connect(void)
+{
+	unsigned int port = our_port;
+
+	/* don't mistake late packets of the last connection for new ones */
+	our_port = random_port();
+	if (our_port == port)
+		our_port++;
+
+	current_wget_state = WGET_CLOSED;
+	wget_send(TCP_SYN, 0, 0, 0);
+}
+
 static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 			   u8 action, unsigned int tcp_ack_num, unsigned int len)
 {
 	uchar *pkt_in_q;
 	char *pos;
-	int hlen, i;
+	int hlen, i, ret;
 	uchar *ptr1;
+	uchar c;
 
 	pkt[len] = '\0';
 	pos = strstr((char *)pkt, http_eom);
@@ -241,8 +543,8 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 	if (!pos) {
 		debug_cond(DEBUG_WGET,
 			   "wget: Connected, data before Header %p\n", pkt);
-		pkt_in_q = (void *)image_load_addr + PKT_QUEUE_OFFSET +
-			(pkt_q_idx * PKT_QUEUE_PACKET_SIZE);
+		pkt_in_q = (void *)image_load_addr + wget_range_start +
+			PKT_QUEUE_OFFSET + (pkt_q_idx * PKT_QUEUE_PACKET_SIZE);
 
 		ptr1 = map_sysmem((phys_addr_t)pkt_in_q, len);
 		memcpy(ptr1, pkt, len);
@@ -271,31 +573,28 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 		printf("%.*s", i,  pkt);
 
 		current_wget_state = WGET_TRANSFERRING;
+		initial_data_seq_num = tcp_seq_num + hlen;
+
+		c = pkt[hlen];
+		pkt[hlen] = '\0';
+		ret = wget_parse_header((char *)pkt);
+		pkt[hlen] = c;
 
-		if (strstr((char *)pkt, http_ok) == 0) {
+		if (ret) {
 			debug_cond(DEBUG_WGET,
 				   "wget: Connected Bad Xfer\n");
-			initial_data_seq_num = tcp_seq_num + hlen;
 			wget_loop_state = NETLOOP_FAIL;
 			wget_send(action, tcp_seq_num, tcp_ack_num, len);
 		} else {
 			debug_cond(DEBUG_WGET,
 				   "wget: Connctd pkt %p  hlen %x\n",
 				   pkt, hlen);
-			initial_data_seq_num = tcp_seq_num + hlen;
 
-			pos = strstr((char *)pkt, content_len);
-			if (!pos) {
-				content_length = -1;
-			} else {
-				pos += sizeof(content_len) + 2;
-				strict_strtoul(pos, 10, &content_length);
-				debug_cond(DEBUG_WGET,
-					   "wget: Connected Len %lu\n",
-					   content_length);
-			}
-
-			net_boot_file_size = 0;
+			net_boot_file_size = wget_range_start;
+			wget_contig = 0;
+			wget_loop_state = NETLOOP_SUCCESS;
+			if (net_decomp_start(image_load_addr, wget_load_size))
+				wget_loop_state = NETLOOP_FAIL;
 
 			if (len > hlen) {
 				if (store_block(pkt + hlen, 0, len - hlen) != 0) {
@@ -333,6 +632,8 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 			}
 		}
 	}
+	if (current_wget_state == WGET_TRANSFERRING && wget_reuse_connection())
+		current_wget_state = WGET_CONNECTING;
 	wget_send(action, tcp_seq_num, tcp_ack_num, len);
 }
 
@@ -356,6 +657,7 @@ static void wget_handler(uchar *pkt, u16 dport,
 			 u8 action, unsigned int len)
 {
 	enum tcp_state wget_tcp_state = tcp_get_tcp_state();
+	int ret;
 
 	net_set_timeout_handler(wget_timeout, wget_timeout_handler);
 	packets++;
@@ -396,9 +698,22 @@ static void wget_handler(uchar *pkt, u16 dport,
 			   "wget: Transferring, seq=%x, ack=%x,len=%x\n",
 			   tcp_seq_num, tcp_ack_num, len);
 
-		if (tcp_seq_num >= initial_data_seq_num &&
-		    store_block(pkt, tcp_seq_num - initial_data_seq_num,
-				len) != 0) {
+		if (tcp_seq_num >= initial_data_seq_num)
+			ret = store_block(pkt, tcp_seq_num - initial_data_seq_num,
+					  len);
+		else
+			ret = 0;
+		if (ret == -ENOSPC) {
+			/*
+			 * There is no room to hold this back until the gap
+			 * before it is filled, so drop it without an ACK and
+			 * let the server send it again
+			 */
+			debug_cond(DEBUG_WGET, "wget: dropped seq=%x\n",
+				   tcp_seq_num);
+			return;
+		}
+		if (ret) {
 			wget_fail("wget: store error\n",
 				  tcp_seq_num, tcp_ack_num, action);
 			net_set_state(NETLOOP_FAIL);
@@ -417,9 +732,15 @@ static void wget_handler(uchar *pkt, u16 dport,
 			net_set_state(NETLOOP_FAIL);
 			break;
 		case TCP_ESTABLISHED:
+			if (wget_reuse_connection()) {
+				current_wget_state = WGET_CONNECTING;
+			} else if (!wget_body_done() && tcp_delay_ack()) {
+				/* the end of the body is ACKed at once */
+				wget_delay_ack(tcp_seq_num, tcp_ack_num, len);
+				break;
+			}
 			wget_send(TCP_ACK, tcp_seq_num, tcp_ack_num,
 				  len);
-			wget_loop_state = NETLOOP_SUCCESS;
 			break;
 		case TCP_CLOSE_WAIT:     /* End of transfer */
 			current_wget_state = WGET_TRANSFERRED;
@@ -429,41 +750,47 @@ static void wget_handler(uchar *pkt, u16 dport,
 		}
 		break;
 	case WGET_TRANSFERRED:
+		/* the server closed the connection, open another one */
+		if (wget_loop_state == NETLOOP_SUCCESS && wget_next_file()) {
+			wget_connect();
+			break;
+		}
+		if (wget_loop_state == NETLOOP_SUCCESS)
+			wget_decomp_finish();
 		printf("Packets received %d, Transfer Successful\n", packets);
 		net_set_state(wget_loop_state);
 		break;
 	}
 }
 
-#define RANDOM_PORT_START 1024
-#define RANDOM_PORT_RANGE 0x4000
-
-/**
- * random_port() - make port a little random (1024-17407)
- *
- * Return: random port number from 1024 to 17407
- *
- * This keeps the math somewhat trivial to compute, and seems to work with
- * all supported protocols/clients/servers
- */
-static unsigned int random_port(void)
-{
-	return RANDOM_PORT_START + (get_timer(0) % RANDOM_PORT_RANGE);
-}
-
 #define BLOCKSIZE 512
 
 void wget_start(void)
 {
-	image_url = strchr(net_boot_file_name, ':');
-	if (image_url > 0) {
-		web_server_ip = string_to_ip(net_boot_file_name);
-		++image_url;
-		net_server_ip = web_server_ip;
-	} else {
-		web_server_ip = net_server_ip;
-		image_url = net_boot_file_name;
+	/* after a restart, carry on with the file that was interrupted */
+	if (!wget_restart) {
+		image_url = strchr(net_boot_file_name, ':');
+		if (image_url > 0) {
+			web_server_ip = string_to_ip(net_boot_file_name);
+			++image_url;
+			net_server_ip = web_server_ip;
+		} else {
+			web_server_ip = net_server_ip;
+			image_url = net_boot_file_name;
+		}
+		wget_file_idx = 0;
 	}
+	wget_restart = false;
+
+	wget_range_start = 0;
+	if (wget_resume && !net_decomp_enabled() &&
+	    env_get_hex("fileaddr", 0) == image_load_addr)
+		wget_range_start = env_get_hex("filesize", 0);
+	wget_resume = false;
+	if (wget_range_start)
+		printf("Resuming at %lu bytes\n", wget_range_start);
+	net_boot_file_size = 0;
+	wget_loop_state = NETLOOP_FAIL;
 
 	debug_cond(DEBUG_WGET,
 		   "wget: Transfer HTTP Server %pI4; our IP %pI4\n",
@@ -509,6 +836,9 @@ void wget_start(void)
 
 	our_port = random_port();
 
+	/* the server must not get further ahead than can be held back */
+	tcp_limit_rx_window(net_decomp_enabled() ? NET_DECOMP_HOLD_SIZE : 0);
+
 	/*
 	 * Zero out server ether to force arp resolution in case
 	 * the server ip for the previous u-boot command, for example dns
@@ -520,6 +850,41 @@ void wget_start(void)
 	wget_send(TCP_SYN, 0, 0, 0);
 }
 
+void wget_set_resume(bool resume)
+{
+	wget_resume = resume;
+}
+
+int wget_add_file(ulong addr, const char *path)
+{
+	const char *s = strchr(path, ':');
+	struct wget_file *f;
+
+	if (wget_file_count >= WGET_MAX_FILES)
+		return -ENOSPC;
+
+	/* all files come from the server of the first one */
+	if (s)
+		path = s + 1;
+
+	f = &wget_files[wget_file_count];
+	f->path = strdup(path);
+	if (!f->path)
+		return -ENOMEM;
+	f->addr = addr;
+	wget_file_count++;
+
+	return 0;
+}
+
+void wget_clear_files(void)
+{
+	while (wget_file_count)
+		free(wget_files[--wget_file_count].path);
+	wget_file_idx = 0;
+	wget_resume = false;
+}
+
 #if (IS_ENABLED(CONFIG_CMD_DNS))
 int wget_with_dns(ulong dst_addr, char *uri)
 {
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the 'hash bench' command
+ */
+
+#include <command.h>
+#include <hash.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Check the output and the digests, since the throughput depends on the host */
+static int hash_test_bench_run(struct unit_test_state *uts, uint size,
+			       uint chunk)
+{
+	struct hash_algo *algo;
+	int i;
+
+	ut_assertok(run_commandf("hash bench -t 1 %#x %u", size, chunk));
+	ut_assert_nextline("Algorithm    Impl             Size    Chunk     MB/s  Call ns");
+	for (i = 0; !hash_get_algo(i, &algo); i++) {
+		ut_assert_nextlinen("%-12s oneshot     %9u %8u", algo->name,
+				    size, chunk);
+		if (algo->hash_init)
+			ut_assert_nextlinen("%-12s progressive %9u %8u",
+					    algo->name, size, chunk);
+	}
+	if (!IS_ENABLED(CONFIG_DM_HASH))
+		ut_assert_console_end();
+	console_record_reset();
+
+	return 0;
+}
+
+static int lib_test_hash_bench(struct unit_test_state *uts)
+{
+	ut_assertok(hash_test_bench_run(uts, 0x10000, 0x1000));
+
+	/* chunks which do not divide the size */
+	ut_assertok(hash_test_bench_run(uts, 0x10001, 1000));
+
+	ut_asserteq(1, run_command("hash bench -a nosuch", 0));
+	ut_assert_nextline("Unknown hash algorithm 'nosuch'");
+	ut_assert_console_end();
+
+	return 0;
+}
+LIB_TEST(lib_test_hash_bench, UT_TESTF_CONSOLE_REC);
@@ -0,0 +1,318 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the nfs command, against a minimal NFSv3 server
+ */
+
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/eth.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include "../../net/nfs.h"
+
+#define SB_NFS_PORT		2049
+#define SB_NFS_MOUNT_PORT	635
+#define SB_NFS_DGRAM_MAX	8192
+/* Largest fragment payload which fits an Ethernet frame, a multiple of 8 */
+#define SB_NFS_FRAG_SIZE	1480
+
+/**
+ * struct sb_nfs - State of the fake NFS server
+ *
+ * @size: Size of the file being served
+ * @rtpref: Preferred read size to report in the FSINFO reply
+ * @max_count: Largest number of bytes to return from a READ, 0 for no limit
+ * @swap: Send the replies to each pair of READ requests in reverse order
+ * @reads: Number of READ requests received
+ * @sent: Number of bytes of the file sent, counting any sent twice
+ * @max_read: Largest READ request seen
+ * @drops: Number of packets dropped because the receive buffer was full
+ * @held: Reply being held back to send after the next one
+ * @held_len: Length of @held, 0 if nothing is held back
+ */
+static struct sb_nfs {
+	uint size;
+	uint rtpref;
+	uint max_count;
+	bool swap;
+	int reads;
+	uint sent;
+	uint max_read;
+	int drops;
+	u32 held[SB_NFS_DGRAM_MAX / sizeof(u32)];
+	uint held_len;
+} sb_nfs;
+
+static uchar sb_nfs_byte(uint ofs)
+{
+	return ofs * 7 + (ofs >> 8);
+}
+
+static int sb_nfs_arp_handler(struct udevice *dev, void *packet,
+			      unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
+
+	if (ntohs(arp->ar_op) != ARPOP_REQUEST)
+		return -EPROTONOSUPPORT;
+	priv->fake_host_ipaddr = net_read_ip(&arp->ar_spa);
+
+	return sandbox_eth_arp_req_to_reply(dev, packet, len);
+}
+
+/* Send an RPC reply, as IP fragments if it does not fit in one frame */
+static void sb_nfs_send(struct udevice *dev, void *packet, const void *rpc,
+			uint len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *req = packet + ETHER_HDR_SIZE;
+	static uchar dgram[IP_UDP_HDR_SIZE + SB_NFS_DGRAM_MAX];
+	struct ip_udp_hdr *ip = (struct ip_udp_hdr *)dgram;
+	uint total = IP_UDP_HDR_SIZE + len;
+	uint ofs, frag;
+
+	ip->ip_hl_v = 0x45;
+	ip->ip_tos = 0;
+	ip->ip_id = htons(sb_nfs.reads);
+	ip->ip_ttl = 255;
+	ip->ip_p = IPPROTO_UDP;
+	net_copy_ip(&ip->ip_src, &req->ip_dst);
+	net_copy_ip(&ip->ip_dst, &req->ip_src);
+	ip->udp_src = req->udp_dst;
+	ip->udp_dst = req->udp_src;
+	ip->udp_len = htons(UDP_HDR_SIZE + len);
+	ip->udp_xsum = 0;
+	memcpy(dgram + IP_UDP_HDR_SIZE, rpc, len);
+
+	for (ofs = IP_HDR_SIZE; ofs < total; ofs += frag) {
+		struct ethernet_hdr *eth_send;
+		struct ip_hdr *ip_send;
+
+		frag = min(total - ofs, (uint)SB_NFS_FRAG_SIZE);
+		if (priv->recv_packets >= PKTBUFSRX) {
+			sb_nfs.drops++;
+			return;
+		}
+		eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+		memcpy(eth_send->et_dest, eth->et_src, ARP_HLEN);
+		memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+		eth_send->et_protlen = htons(PROT_IP);
+		ip_send = (void *)eth_send + ETHER_HDR_SIZE;
+		memcpy(ip_send, ip, IP_HDR_SIZE);
+		memcpy((void *)ip_send + IP_HDR_SIZE, dgram + ofs, frag);
+		ip_send->ip_len = htons(IP_HDR_SIZE + frag);
+		ip_send->ip_off = htons((ofs - IP_HDR_SIZE) / 8 |
+					(ofs + frag < total ? IP_FLAGS_MFRAG : 0));
+		ip_send->ip_sum = 0;
+		ip_send->ip_sum = compute_ip_checksum(ip_send, IP_HDR_SIZE);
+
+		priv->recv_packet_length[priv->recv_packets] =
+			ETHER_HDR_SIZE + IP_HDR_SIZE + frag;
+		priv->recv_packets++;
+	}
+}
+
+/* Build the reply to a READ of @count bytes at @offset into @p */
+static u32 *sb_nfs_read(u32 *p, uint offset, uint count)
+{
+	uchar *data;
+	bool eof;
+	uint i;
+
+	sb_nfs.reads++;
+	sb_nfs.max_read = max(sb_nfs.max_read, count);
+
+	if (sb_nfs.max_count)
+		count = min(count, sb_nfs.max_count);
+	count = offset < sb_nfs.size ? min(count, sb_nfs.size - offset) : 0;
+	eof = offset + count >= sb_nfs.size;
+	sb_nfs.sent += count;
+
+	*p++ = htonl(0);	/* status */
+	*p++ = htonl(0);	/* no attributes */
+	*p++ = htonl(count);
+	*p++ = htonl(eof);
+	*p++ = htonl(count);
+	data = (uchar *)p;
+	for (i = 0; i < count; i++)
+		data[i] = sb_nfs_byte(offset + i);
+	memset(data + count, '\0', -count & 3);
+
+	return p + DIV_ROUND_UP(count, 4);
+}
+
+static int sb_nfs_handler(struct udevice *dev, void *packet, unsigned int len)
+{
+	static u32 reply[SB_NFS_DGRAM_MAX / sizeof(u32)];
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	u32 *call = packet + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	u32 prog, proc, offset, count;
+	u32 *p, *args;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sb_nfs_arp_handler(dev, packet, len);
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return -EPROTONOSUPPORT;
+
+	/* Skip the credentials and verifier */
+	prog = ntohl(call[3]);
+	proc = ntohl(call[5]);
+	args = call + 6;
+	args += 2 + ntohl(args[1]) / 4;
+	args += 2 + ntohl(args[1]) / 4;
+
+	p = reply;
+	*p++ = call[0];			/* xid */
+	*p++ = htonl(MSG_REPLY);
+	*p++ = 0;			/* accepted */
+	*p++ = 0;			/* AUTH_NONE verifier */
+	*p++ = 0;
+	*p++ = 0;			/* success */
+
+	if (prog == PROG_PORTMAP) {
+		if (ntohl(args[0]) == PROG_MOUNT)
+			*p++ = htonl(SB_NFS_MOUNT_PORT);
+		else
+			*p++ = htonl(SB_NFS_PORT);
+	} else if (prog == PROG_MOUNT && proc == MOUNT_ADDENTRY) {
+		*p++ = 0;
+		memset(p, 'd', NFS_FHSIZE);
+		p += NFS_FHSIZE / 4;
+	} else if (prog == PROG_MOUNT) {
+		/* MOUNT_UMOUNTALL has nothing to return */
+	} else if (proc == NFS3PROC_LOOKUP) {
+		*p++ = 0;
+		*p++ = htonl(NFS_FHSIZE);
+		memset(p, 'f', NFS_FHSIZE);
+		p += NFS_FHSIZE / 4;
+	} else if (proc == NFS3PROC_FSINFO) {
+		*p++ = 0;
+		*p++ = 0;			/* no attributes */
+		*p++ = htonl(SB_NFS_DGRAM_MAX);	/* rtmax */
+		*p++ = htonl(sb_nfs.rtpref);
+	} else if (proc == NFS_READ) {
+		/* File handle, 64-bit offset and count */
+		args += 1 + ntohl(args[0]) / 4;
+		offset = ntohl(args[1]);
+		count = ntohl(args[2]);
+		p = sb_nfs_read(p, offset, count);
+
+		/* Hold back every other reply while there are more to come */
+		if (sb_nfs.swap && !sb_nfs.held_len &&
+		    offset + count < sb_nfs.size) {
+			sb_nfs.held_len = (p - reply) * sizeof(u32);
+			memcpy(sb_nfs.held, reply, sb_nfs.held_len);
+			return 0;
+		}
+	} else {
+		return -EPROTONOSUPPORT;
+	}
+	sb_nfs_send(dev, packet, reply, (p - reply) * sizeof(u32));
+
+	if (sb_nfs.held_len && proc == NFS_READ) {
+		sb_nfs_send(dev, packet, sb_nfs.held, sb_nfs.held_len);
+		sb_nfs.held_len = 0;
+	}
+
+	return 0;
+}
+
+static int sb_nfs_setup(struct unit_test_state *uts, uint size, uint rtpref,
+			int window)
+{
+	memset(&sb_nfs, '\0', sizeof(sb_nfs));
+	sb_nfs.size = size;
+	sb_nfs.rtpref = rtpref;
+	sandbox_eth_set_tx_handler(0, sb_nfs_handler);
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set_ulong("nfswindowsize", window);
+
+	return 0;
+}
+
+/* Load the file and check that it arrived intact */
+static int sb_nfs_check(struct unit_test_state *uts)
+{
+	uchar *buf;
+	uint i;
+
+	ut_assertok(run_command("nfs 20000 1.1.2.2:/export/file", 0));
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("nfswindowsize", NULL);
+
+	ut_asserteq(sb_nfs.size, env_get_hex("filesize", 0));
+	buf = map_sysmem(0x20000, sb_nfs.size);
+	for (i = 0; i < sb_nfs.size; i++) {
+		if (buf[i] != sb_nfs_byte(i))
+			break;
+	}
+	unmap_sysmem(buf);
+	ut_asserteq(sb_nfs.size, i);
+	ut_asserteq(0, sb_nfs.drops);
+	/* Nothing was asked for twice, so there were no timeouts */
+	ut_asserteq(sb_nfs.size, sb_nfs.sent);
+
+	return 0;
+}
+
+/* Keep several reads in flight, with replies arriving out of order */
+static int net_test_nfs_window(struct unit_test_state *uts)
+{
+	ut_assertok(sb_nfs_setup(uts, 10 * NFS_READ_SIZE + 100, NFS_READ_SIZE,
+				 3));
+	sb_nfs.swap = true;
+	ut_assertok(sb_nfs_check(uts));
+
+	/* Reads past the end may be in flight when the last reply arrives */
+	ut_assert(sb_nfs.reads >= 11);
+	ut_asserteq(NFS_READ_SIZE, sb_nfs.max_read);
+
+	return 0;
+}
+
+LIB_TEST(net_test_nfs_window, 0);
+
+/* Use the server's preferred size, with each reply split into fragments */
+static int net_test_nfs_rsize(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_IP_DEFRAG))
+		return -EAGAIN;
+
+	ut_assertok(sb_nfs_setup(uts, 20000, 4096, 1));
+	ut_assertok(sb_nfs_check(uts));
+	ut_asserteq(5, sb_nfs.reads);
+	ut_asserteq(4096, sb_nfs.max_read);
+
+	return 0;
+}
+
+LIB_TEST(net_test_nfs_rsize, 0);
+
+/* Ask for the rest of a short read, then use smaller reads */
+static int net_test_nfs_short(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_IP_DEFRAG))
+		return -EAGAIN;
+
+	ut_assertok(sb_nfs_setup(uts, 20000, 4096, 1));
+	sb_nfs.max_count = 3000;
+	ut_assertok(sb_nfs_check(uts));
+
+	/* 0+3000, 3000+1096, then 3000 at a time from 4096 */
+	ut_asserteq(8, sb_nfs.reads);
+	ut_asserteq(4096, sb_nfs.max_read);
+
+	return 0;
+}
+
+LIB_TEST(net_test_nfs_short, 0);
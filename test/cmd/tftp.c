@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the tftpboot command, against a minimal TFTP server
+ */
+
+#include <command.h>
+#include <console.h>
+#include <dm.h>
+#include <env.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/eth.h>
+#include <asm/unaligned.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SB_TFTP_RRQ		1
+#define SB_TFTP_DATA		3
+#define SB_TFTP_ACK		4
+#define SB_TFTP_OACK		6
+#define SB_TFTP_PORT		5000
+#define SB_TFTP_BLKSIZE		512
+/* Blocks in the file served, the last one short */
+#define SB_TFTP_BLOCKS		65
+#define SB_TFTP_SIZE		((SB_TFTP_BLOCKS - 1) * SB_TFTP_BLKSIZE + 100)
+
+/**
+ * struct sb_tftp - State of the fake TFTP server
+ *
+ * @lossy: Drop and reorder some blocks the first time they are sent
+ * @window: Window size asked for in the last read request, 1 if none
+ * @sent: Number of times each block was sent, indexed by block number
+ * @data: Number of data packets sent, counting any sent twice
+ * @drops: Number of packets dropped because the receive buffer was full
+ */
+static struct sb_tftp {
+	bool lossy;
+	int window;
+	int sent[SB_TFTP_BLOCKS + 1];
+	int data;
+	int drops;
+} sb_tftp;
+
+static uchar sb_tftp_byte(uint ofs)
+{
+	return ofs * 3 + (ofs >> 8);
+}
+
+static int sb_tftp_arp_handler(struct udevice *dev, void *packet,
+			       unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
+
+	if (ntohs(arp->ar_op) != ARPOP_REQUEST)
+		return -EPROTONOSUPPORT;
+	priv->fake_host_ipaddr = net_read_ip(&arp->ar_spa);
+
+	return sandbox_eth_arp_req_to_reply(dev, packet, len);
+}
+
+/* Send a TFTP packet from the server port back to the sender of @packet */
+static void sb_tftp_send(struct udevice *dev, void *packet, const void *msg,
+			 uint len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *req = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_send;
+	struct ip_udp_hdr *ip;
+
+	if (priv->recv_packets >= PKTBUFSRX) {
+		sb_tftp.drops++;
+		return;
+	}
+	eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_send->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_send->et_protlen = htons(PROT_IP);
+	ip = (void *)eth_send + ETHER_HDR_SIZE;
+	memcpy((void *)ip + IP_UDP_HDR_SIZE, msg, len);
+	net_set_ip_header((uchar *)ip, req->ip_src, req->ip_dst,
+			  IP_UDP_HDR_SIZE + len, IPPROTO_UDP);
+	ip->udp_src = htons(SB_TFTP_PORT);
+	ip->udp_dst = req->udp_src;
+	ip->udp_len = htons(UDP_HDR_SIZE + len);
+	ip->udp_xsum = 0;
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len;
+	priv->recv_packets++;
+}
+
+/* Send block @block, unless it is to be lost this time */
+static void sb_tftp_data(struct udevice *dev, void *packet, int block)
+{
+	uchar msg[4 + SB_TFTP_BLKSIZE];
+	uint ofs = (block - 1) * SB_TFTP_BLKSIZE;
+	uint i, len;
+
+	if (block > SB_TFTP_BLOCKS)
+		return;
+	/* Lose a block in each of three windows the first time round */
+	if (sb_tftp.lossy && !sb_tftp.sent[block]++ &&
+	    (block == 6 || block == 20 || block == 33))
+		return;
+
+	len = min((uint)SB_TFTP_BLKSIZE, SB_TFTP_SIZE - ofs);
+	put_unaligned_be16(SB_TFTP_DATA, msg);
+	put_unaligned_be16(block, msg + 2);
+	for (i = 0; i < len; i++)
+		msg[4 + i] = sb_tftp_byte(ofs + i);
+	sb_tftp.data++;
+	sb_tftp_send(dev, packet, msg, 4 + len);
+}
+
+/* Send the window of blocks after @acked */
+static void sb_tftp_window(struct udevice *dev, void *packet, int acked)
+{
+	int i, block;
+
+	for (i = 0; i < sb_tftp.window; i++) {
+		block = acked + 1 + i;
+
+		/* Swap blocks 11 and 12 the first time they are sent */
+		if (sb_tftp.lossy && !sb_tftp.sent[12] && block == 11)
+			block = 12;
+		else if (sb_tftp.lossy && sb_tftp.sent[12] == 1 &&
+			 !sb_tftp.sent[11] && block == 12)
+			block = 11;
+		sb_tftp_data(dev, packet, block);
+	}
+}
+
+/* Accept a read request, taking up the window size asked for */
+static void sb_tftp_rrq(struct udevice *dev, void *packet, char *req,
+			uint len)
+{
+	char msg[64], *opt, *end = req + len;
+	int pos;
+
+	sb_tftp.window = 1;
+	for (opt = req + strlen(req) + 1; opt < end; opt += strlen(opt) + 1) {
+		if (!strcmp(opt, "windowsize")) {
+			opt += strlen(opt) + 1;
+			sb_tftp.window = dectoul(opt, NULL);
+		}
+	}
+
+	put_unaligned_be16(SB_TFTP_OACK, msg);
+	pos = 2;
+	pos += sprintf(msg + pos, "blksize%c%d%c", 0, SB_TFTP_BLKSIZE, 0);
+	if (sb_tftp.window > 1)
+		pos += sprintf(msg + pos, "windowsize%c%d%c", 0,
+			       sb_tftp.window, 0);
+	sb_tftp_send(dev, packet, msg, pos);
+}
+
+static int sb_tftp_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	uchar *msg = packet + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	uint msg_len;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sb_tftp_arp_handler(dev, packet, len);
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return -EPROTONOSUPPORT;
+
+	msg_len = ntohs(ip->udp_len) - UDP_HDR_SIZE;
+	switch (get_unaligned_be16(msg)) {
+	case SB_TFTP_RRQ:
+		sb_tftp_rrq(dev, packet, (char *)msg + 2, msg_len - 2);
+		break;
+	case SB_TFTP_ACK:
+		sb_tftp_window(dev, packet, get_unaligned_be16(msg + 2));
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	return 0;
+}
+
+/* Load the file and check that it arrived intact */
+static int sb_tftp_check(struct unit_test_state *uts, bool lossy)
+{
+	uchar *buf;
+	uint i;
+
+	memset(&sb_tftp, '\0', sizeof(sb_tftp));
+	sb_tftp.lossy = lossy;
+	sandbox_eth_set_tx_handler(0, sb_tftp_handler);
+	sandbox_eth_set_priv(0, uts);
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+
+	buf = map_sysmem(0x20000, SB_TFTP_SIZE);
+	memset(buf, '\0', SB_TFTP_SIZE);
+	ut_assertok(run_command("tftpboot 20000 1.1.2.2:file", 0));
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	ut_asserteq(SB_TFTP_SIZE, env_get_hex("filesize", 0));
+	for (i = 0; i < SB_TFTP_SIZE; i++) {
+		if (buf[i] != sb_tftp_byte(i))
+			break;
+	}
+	unmap_sysmem(buf);
+	ut_asserteq(SB_TFTP_SIZE, i);
+
+	/* a lossy transfer may have two windows in flight, so drop the rest */
+	if (!lossy)
+		ut_asserteq(0, sb_tftp.drops);
+
+	return 0;
+}
+
+/*
+ * Keep blocks which arrive after a lost or late one, and ask for a smaller
+ * window after a lossy transfer
+ */
+static int net_test_tftp_window(struct unit_test_state *uts)
+{
+	bool adapt = IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPTIVE);
+
+	env_set("tftpwindowsize", "4");
+	console_record_reset_enable();
+	ut_assertok(sb_tftp_check(uts, true));
+	ut_asserteq(4, sb_tftp.window);
+
+	/*
+	 * The blocks which arrived after each of the three lost ones, and
+	 * block 12 which came before 11, were kept rather than dropped
+	 */
+	ut_assert_skip_to_linen("\t Window 4: %d blocks, 6 early, ",
+				SB_TFTP_BLOCKS);
+
+	/* a clean transfer with half the window, then back to the full one */
+	ut_assertok(sb_tftp_check(uts, false));
+	ut_asserteq(adapt ? 2 : 4, sb_tftp.window);
+	ut_asserteq(SB_TFTP_BLOCKS, sb_tftp.data);
+
+	ut_assertok(sb_tftp_check(uts, false));
+	ut_asserteq(4, sb_tftp.window);
+	env_set("tftpwindowsize", NULL);
+
+	return 0;
+}
+
+LIB_TEST(net_test_tftp_window, UT_TESTF_CONSOLE_REC);
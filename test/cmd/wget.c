@@ -13,10 +13,14 @@
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
+#include <net/decompress.h>
 #include <net/tcp.h>
 #include <net/wget.h>
+#include <time.h>
 #include <asm/eth.h>
+#include <linux/sizes.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -26,6 +30,7 @@
 
 #define SHIFT_TO_TCPHDRLEN_FIELD(x) ((x) << 4)
 #define LEN_B_TO_DW(x) ((x) >> 2)
+#define GET_TCP_HDR_LEN_IN_BYTES(x) ((x) >> 2)
 
 static int sb_arp_handler(struct udevice *dev, void *packet,
 			  unsigned int len)
@@ -71,7 +76,7 @@ static int sb_syn_handler(struct udevice *dev, void *packet,
 	tcp_send->tcp_ack = htonl(ntohl(tcp->tcp_seq) + 1);
 	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
 	tcp_send->tcp_flags = TCP_SYN | TCP_ACK;
-	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS);
 	tcp_send->tcp_xsum = 0;
 	tcp_send->tcp_ugr = 0;
 	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
@@ -134,7 +139,7 @@ static int sb_ack_handler(struct udevice *dev, void *packet,
 	}
 
 	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
-	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS);
 	tcp_send->tcp_xsum = 0;
 	tcp_send->tcp_ugr = 0;
 	pkt_len = IP_TCP_HDR_SIZE + payload_len;
@@ -204,3 +209,445 @@ static int net_test_wget(struct unit_test_state *uts)
 }
 
 LIB_TEST(net_test_wget, 0);
+
+/* Files served by the fake HTTP server below, @size is 0 for a string */
+static const struct {
+	const char *path;
+	const char *data;
+	int size;
+} sb_http_files[] = {
+	{ "/kernel", "The kernel image, a little longer than the others" },
+	{ "/dtb", "The device tree" },
+	{ "/initrd", "The initial ramdisk" },
+	/* /kernel compressed with gzip */
+	{ "/kernel.gz",
+	  "\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\x0b\xc9\x48\x55\xc8\x4e"
+	  "\x2d\xca\x4b\xcd\x51\xc8\xcc\x4d\x4c\x4f\xd5\x51\x48\x54\xc8\xc9"
+	  "\x2c\x29\xc9\x49\x55\xc8\xc9\xcf\x4b\x4f\x2d\x52\x28\xc9\x48\xcc"
+	  "\x03\x12\xa9\x0a\xf9\x40\xa2\xa8\x18\x00\xc2\x00\x69\xa8\x31\x00"
+	  "\x00\x00", 66 },
+};
+
+/**
+ * struct sb_http_server - state of the fake HTTP server
+ *
+ * @seq: next sequence number to send
+ * @close: close the connection after each response
+ * @conns: number of connections opened
+ * @requests: number of requests served
+ * @range: start of the range asked for in the last request
+ * @wscale: offer window scaling in the SYN-ACK
+ * @syn_scale: window scale option of the client's SYN, -1 if none
+ * @syn_win: window advertised in the client's SYN
+ * @win: window advertised in the last ACK of the client
+ * @stream: next segment of the stream to send, -1 if not streaming
+ * @stream_seq: sequence number of the first segment of the stream
+ * @acks: number of ACKs received while streaming
+ */
+static struct sb_http_server {
+	u32 seq;
+	bool close;
+	int conns;
+	int requests;
+	ulong range;
+	bool wscale;
+	int syn_scale;
+	u16 syn_win;
+	u16 win;
+	int stream;
+	u32 stream_seq;
+	int acks;
+} sb_http;
+
+/*
+ * The stream replayed for /stream: SB_STREAM_SEGS full segments, sent two at
+ * a time as a server would on each ACK, with one pair swapped around.
+ */
+#define SB_STREAM_SEGS		256
+#define SB_STREAM_SWAP		100
+#define SB_STREAM_SIZE		(SB_STREAM_SEGS * TCP_MSS)
+
+static u8 sb_stream_byte(uint ofs)
+{
+	return ofs + (ofs >> 8) + (ofs >> 16);
+}
+
+static void sb_http_send(struct udevice *dev, void *packet, u8 flags,
+			 u32 ack, const char *data, int payload_len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_send;
+	struct ip_tcp_hdr *tcp_send;
+	int pkt_len, hlen = TCP_HDR_SIZE;
+	u8 *opt;
+
+	/* Don't allow the buffer to overrun */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_send->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_send->et_protlen = htons(PROT_IP);
+	tcp_send = (void *)eth_send + ETHER_HDR_SIZE;
+	tcp_send->tcp_src = tcp->tcp_dst;
+	tcp_send->tcp_dst = tcp->tcp_src;
+	tcp_send->tcp_seq = htonl(sb_http.seq);
+	tcp_send->tcp_ack = htonl(ack);
+	if ((flags & TCP_SYN) && sb_http.wscale) {
+		opt = (void *)tcp_send + IP_TCP_HDR_SIZE;
+		opt[0] = TCP_1_NOP;
+		opt[1] = TCP_O_SCL;
+		opt[2] = TCP_OPT_LEN_3;
+		opt[3] = 7;
+		hlen += 4;
+	}
+	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(hlen));
+	tcp_send->tcp_flags = flags;
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS);
+	tcp_send->tcp_xsum = 0;
+	tcp_send->tcp_ugr = 0;
+	memcpy((void *)tcp_send + IP_HDR_SIZE + hlen, data, payload_len);
+	pkt_len = IP_HDR_SIZE + hlen + payload_len;
+	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
+						   tcp->ip_src,
+						   tcp->ip_dst,
+						   pkt_len - IP_HDR_SIZE,
+						   pkt_len);
+	net_set_ip_header((uchar *)tcp_send,
+			  tcp->ip_src,
+			  tcp->ip_dst,
+			  pkt_len,
+			  IPPROTO_TCP);
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + pkt_len;
+	++priv->recv_packets;
+
+	sb_http.seq += payload_len;
+	if (flags & (TCP_SYN | TCP_FIN))
+		sb_http.seq++;
+}
+
+/* Answer a GET request with a single packet */
+static void sb_http_request(struct udevice *dev, void *packet, u32 ack,
+			    char *req)
+{
+	const char *data = NULL;
+	char buf[512], *path, *pos;
+	bool close;
+	int i, len, size;
+
+	path = req + strlen("GET ");
+	pos = strchr(path, ' ');
+	if (strncmp(req, "GET ", 4) || !pos)
+		return;
+	*pos++ = '\0';
+	if (!strcmp(path, "/stream")) {
+		len = snprintf(buf, sizeof(buf),
+			       "HTTP/1.1 200 OK\r\n"
+			       "Content-Length: %d\r\n"
+			       "Connection: close\r\n\r\n", SB_STREAM_SIZE);
+		sb_http.requests++;
+		sb_http_send(dev, packet, TCP_ACK | TCP_PUSH, ack, buf, len);
+		sb_http.stream = 0;
+		sb_http.stream_seq = sb_http.seq;
+		return;
+	}
+	for (i = 0; i < ARRAY_SIZE(sb_http_files); i++) {
+		if (!strcmp(path, sb_http_files[i].path)) {
+			data = sb_http_files[i].data;
+			size = sb_http_files[i].size ?: strlen(data);
+		}
+	}
+	if (!data)
+		return;
+
+	pos = strstr(pos, "Range: bytes=");
+	sb_http.range = pos ? simple_strtoul(pos + 13, NULL, 10) : 0;
+	close = sb_http.close || strstr(pos ? pos : path + strlen(path) + 1,
+					"Connection: close");
+
+	if (sb_http.range)
+		len = snprintf(buf, sizeof(buf),
+			       "HTTP/1.1 206 Partial Content\r\n"
+			       "Content-Range: bytes %lu-%d/%d\r\n",
+			       sb_http.range, size - 1, size);
+	else
+		len = snprintf(buf, sizeof(buf), "HTTP/1.1 200 OK\r\n");
+	len += snprintf(buf + len, sizeof(buf) - len,
+			"Content-Length: %lu\r\n%s\r\n",
+			size - sb_http.range,
+			close ? "Connection: close\r\n" : "");
+	memcpy(buf + len, data + sb_http.range, size - sb_http.range);
+	len += size - sb_http.range;
+
+	sb_http.requests++;
+	sb_http_send(dev, packet, TCP_ACK | TCP_PUSH, ack, buf, len);
+	if (close)
+		sb_http_send(dev, packet, TCP_ACK | TCP_FIN, ack, NULL, 0);
+}
+
+static void sb_http_stream_seg(struct udevice *dev, void *packet, u32 ack,
+			       int seg)
+{
+	char buf[TCP_MSS];
+	uint ofs = seg * TCP_MSS;
+	int i;
+
+	for (i = 0; i < TCP_MSS; i++)
+		buf[i] = sb_stream_byte(ofs + i);
+	sb_http.seq = sb_http.stream_seq + ofs;
+	sb_http_send(dev, packet, TCP_ACK, ack, buf, TCP_MSS);
+}
+
+/* Send the next two segments of the stream, or close it at the end */
+static void sb_http_stream(struct udevice *dev, void *packet, u32 ack)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int seg = sb_http.stream;
+	int count;
+
+	count = min(2, PKTBUFSRX - priv->recv_packets);
+	count = min(count, SB_STREAM_SEGS - seg);
+	if (count == 2 && seg == SB_STREAM_SWAP) {
+		sb_http_stream_seg(dev, packet, ack, seg + 1);
+		sb_http_stream_seg(dev, packet, ack, seg);
+	} else {
+		for (; count > 0; count--)
+			sb_http_stream_seg(dev, packet, ack, seg++);
+	}
+	sb_http.stream = seg + count;
+	sb_http.seq = sb_http.stream_seq + sb_http.stream * TCP_MSS;
+
+	if (sb_http.stream == SB_STREAM_SEGS &&
+	    priv->recv_packets < PKTBUFSRX) {
+		sb_http_send(dev, packet, TCP_ACK | TCP_FIN, ack, NULL, 0);
+		sb_http.stream = -1;
+	}
+}
+
+/* Note the window scale option of a SYN */
+static void sb_http_syn(struct ip_tcp_hdr *tcp, int hlen)
+{
+	u8 *opt = (void *)tcp + IP_TCP_HDR_SIZE;
+	u8 *end = (void *)tcp + IP_HDR_SIZE + hlen;
+
+	sb_http.syn_win = ntohs(tcp->tcp_win);
+	sb_http.syn_scale = -1;
+	while (opt < end && *opt != TCP_O_END) {
+		if (*opt == TCP_1_NOP) {
+			opt++;
+			continue;
+		}
+		if (*opt == TCP_O_SCL)
+			sb_http.syn_scale = opt[2];
+		opt += opt[1];
+	}
+}
+
+static int sb_http_server_handler(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	char req[256];
+	u32 seq;
+	int hlen;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sb_arp_handler(dev, packet, len);
+	if (ntohs(eth->et_protlen) != PROT_IP || tcp->ip_p != IPPROTO_TCP)
+		return -EPROTONOSUPPORT;
+
+	seq = ntohl(tcp->tcp_seq);
+	hlen = GET_TCP_HDR_LEN_IN_BYTES(tcp->tcp_hlen);
+	len = ntohs(tcp->ip_len) - IP_HDR_SIZE - hlen;
+
+	if (tcp->tcp_flags == TCP_SYN) {
+		sb_http_syn(tcp, hlen);
+		sb_http.seq = 0;
+		sb_http.conns++;
+		sb_http_send(dev, packet, TCP_SYN | TCP_ACK, seq + 1, NULL, 0);
+	} else if (tcp->tcp_flags & TCP_FIN) {
+		sb_http_send(dev, packet, TCP_ACK, seq + 1, NULL, 0);
+	} else if (len > 0 && len < sizeof(req)) {
+		memcpy(req, (void *)tcp + IP_HDR_SIZE + hlen, len);
+		req[len] = '\0';
+		sb_http_request(dev, packet, seq + len, req);
+	} else if (!len && sb_http.stream >= 0) {
+		sb_http.acks++;
+		sb_http.win = ntohs(tcp->tcp_win);
+		sb_http_stream(dev, packet, seq);
+	}
+
+	return 0;
+}
+
+static int sb_http_setup(struct unit_test_state *uts, bool close)
+{
+	memset(&sb_http, '\0', sizeof(sb_http));
+	sb_http.close = close;
+	sb_http.stream = -1;
+	sandbox_eth_set_tx_handler(0, sb_http_server_handler);
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+
+	return 0;
+}
+
+/* Check that a file from the fake server is at @addr */
+static int sb_http_check(struct unit_test_state *uts, ulong addr, int idx)
+{
+	const char *data = sb_http_files[idx].data;
+
+	ut_asserteq_mem(data, map_sysmem(addr, 0), strlen(data));
+
+	return 0;
+}
+
+/* Fetch several files over one connection */
+static int net_test_wget_keep_alive(struct unit_test_state *uts)
+{
+	ut_assertok(sb_http_setup(uts, false));
+	ut_assertok(run_command("wget 20000 1.1.2.2:/kernel 21000 /dtb "
+				"22000 /initrd", 0));
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	ut_asserteq(1, sb_http.conns);
+	ut_asserteq(3, sb_http.requests);
+	ut_assertok(sb_http_check(uts, 0x20000, 0));
+	ut_assertok(sb_http_check(uts, 0x21000, 1));
+	ut_assertok(sb_http_check(uts, 0x22000, 2));
+	ut_asserteq(0x22000, env_get_hex("fileaddr", 0));
+	ut_asserteq(strlen(sb_http_files[2].data), env_get_hex("filesize", 0));
+
+	return 0;
+}
+
+LIB_TEST(net_test_wget_keep_alive, 0);
+
+/* Open a new connection for each file if the server closes it */
+static int net_test_wget_reconnect(struct unit_test_state *uts)
+{
+	ut_assertok(sb_http_setup(uts, true));
+	ut_assertok(run_command("wget 20000 1.1.2.2:/kernel 21000 /dtb", 0));
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	ut_asserteq(2, sb_http.conns);
+	ut_asserteq(2, sb_http.requests);
+	ut_assertok(sb_http_check(uts, 0x20000, 0));
+	ut_assertok(sb_http_check(uts, 0x21000, 1));
+
+	return 0;
+}
+
+LIB_TEST(net_test_wget_reconnect, 0);
+
+/* Resume a partial download with a range request */
+static int net_test_wget_resume(struct unit_test_state *uts)
+{
+	const char *data = sb_http_files[0].data;
+	char *buf = map_sysmem(0x20000, 0);
+
+	memset(buf, '\0', strlen(data));
+	memcpy(buf, data, 10);
+	env_set_hex("fileaddr", 0x20000);
+	env_set_hex("filesize", 10);
+
+	ut_assertok(sb_http_setup(uts, false));
+	ut_assertok(run_command("wget -c 20000 1.1.2.2:/kernel", 0));
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	ut_asserteq(10, sb_http.range);
+	ut_assertok(sb_http_check(uts, 0x20000, 0));
+	ut_asserteq(strlen(data), env_get_hex("filesize", 0));
+
+	return 0;
+}
+
+LIB_TEST(net_test_wget_resume, 0);
+
+/* Stream a file with a scaled window and delayed ACKs */
+static int net_test_wget_stream(struct unit_test_state *uts)
+{
+	u8 *buf = map_sysmem(0x20000, SB_STREAM_SIZE);
+	ulong start, msecs;
+	int i;
+
+	memset(buf, '\0', SB_STREAM_SIZE);
+	env_set("tcpwindowsize", "1048576");
+	ut_assertok(sb_http_setup(uts, false));
+	sb_http.wscale = true;
+	start = get_timer(0);
+	ut_assertok(run_command("wget 20000 1.1.2.2:/stream", 0));
+	msecs = max(get_timer(start), 1UL);
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("tcpwindowsize", NULL);
+
+	ut_asserteq(5, sb_http.syn_scale);
+	ut_asserteq(U16_MAX, sb_http.syn_win);
+	ut_asserteq(SZ_1M >> 5, sb_http.win);
+	for (i = 0; i < SB_STREAM_SIZE; i++) {
+		if (buf[i] != sb_stream_byte(i))
+			break;
+	}
+	ut_asserteq(SB_STREAM_SIZE, i);
+	ut_asserteq(SB_STREAM_SIZE, env_get_hex("filesize", 0));
+
+	/* one ACK per segment without delayed ACKs */
+	if (CONFIG_PROT_TCP_ACK_SEGMENTS > 1)
+		ut_assert(sb_http.acks < SB_STREAM_SEGS * 3 / 4);
+	printf("%d segments, %d ACKs, %lu KiB/s\n", SB_STREAM_SEGS,
+	       sb_http.acks, SB_STREAM_SIZE / msecs * 1000 / SZ_1K);
+
+	return 0;
+}
+
+LIB_TEST(net_test_wget_stream, 0);
+
+/* Decompress a file as it comes in, and store another one unchanged */
+static int net_test_wget_decompress(struct unit_test_state *uts)
+{
+	const char *data = sb_http_files[1].data;
+	u8 *buf = map_sysmem(0x20000, SB_STREAM_SIZE);
+	int i;
+
+	if (!IS_ENABLED(CONFIG_NET_DECOMPRESS))
+		return -EAGAIN;
+
+	env_set("netdecompress", "yes");
+	ut_assertok(sb_http_setup(uts, false));
+	ut_assertok(run_command("wget 20000 1.1.2.2:/kernel.gz 21000 /dtb", 0));
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	ut_assertok(sb_http_check(uts, 0x20000, 0));
+	ut_assertok(sb_http_check(uts, 0x21000, 1));
+	ut_asserteq(strlen(data), env_get_hex("filesize", 0));
+
+	/* the window is no larger than the data which can be held back */
+	memset(buf, '\0', SB_STREAM_SIZE);
+	env_set("tcpwindowsize", "1048576");
+	ut_assertok(sb_http_setup(uts, false));
+	sb_http.wscale = true;
+	ut_assertok(run_command("wget 20000 1.1.2.2:/stream", 0));
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("tcpwindowsize", NULL);
+	env_set("netdecompress", NULL);
+
+	ut_asserteq(3, sb_http.syn_scale);
+	ut_asserteq(NET_DECOMP_HOLD_SIZE >> 3, sb_http.win);
+	for (i = 0; i < SB_STREAM_SIZE; i++) {
+		if (buf[i] != sb_stream_byte(i))
+			break;
+	}
+	ut_asserteq(SB_STREAM_SIZE, i);
+
+	return 0;
+}
+
+LIB_TEST(net_test_wget_decompress, 0);
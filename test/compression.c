@@ -5,14 +5,22 @@
 
 #include <common.h>
 #include <abuf.h>
+#include <blk.h>
 #include <bootm.h>
 #include <command.h>
+#include <console.h>
+#include <dm.h>
+#include <env.h>
 #include <gzip.h>
 #include <image.h>
 #include <log.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <os.h>
+#include <sandbox_host.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
+#include <dm/device-internal.h>
 
 #include <u-boot/lz4.h>
 #include <u-boot/zlib.h>
@@ -23,7 +31,9 @@
 #include <lzma/LzmaTools.h>
 
 #include <linux/lzo.h>
+#include <linux/sizes.h>
 #include <linux/zstd.h>
+#include <net/decompress.h>
 #include <test/compression.h>
 #include <test/suites.h>
 #include <test/ut.h>
@@ -610,6 +620,238 @@ static int compression_test_bootm_none(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/*
+ * Pass compressed data to the network decompressor in small chunks, with
+ * each pair of chunks swapped around as if a packet had been overtaken.
+ */
+static int run_net_test(struct unit_test_state *uts, const char *name,
+			const void *in, ulong in_size, ulong out_size)
+{
+	const ulong chunk = 7;
+	ulong ofs, size;
+	void *out;
+
+	printf(" testing %s ...\n", name);
+	out = malloc(TEST_BUFFER_SIZE);
+	ut_assertnonnull(out);
+	memset(out, 'A', TEST_BUFFER_SIZE);
+
+	ut_assertok(net_decomp_start(map_to_sysmem(out), out_size));
+	ut_assert(net_decomp_active());
+	for (ofs = 0; ofs < in_size; ofs += 2 * chunk) {
+		if (ofs + chunk < in_size)
+			ut_assertok(net_decomp_write(ofs + chunk,
+						     in + ofs + chunk,
+						     min(chunk, in_size - ofs - chunk)));
+		ut_assertok(net_decomp_write(ofs, in + ofs,
+					     min(chunk, in_size - ofs)));
+	}
+	/* data received again is ignored */
+	ut_assertok(net_decomp_write(0, in, in_size));
+
+	ut_assertok(net_decomp_finish(&size));
+	ut_assert(!net_decomp_active());
+	ut_asserteq(strlen(plain), size);
+	ut_asserteq_mem(plain, out, size);
+	ut_asserteq('A', ((char *)out)[size]);
+	free(out);
+
+	return 0;
+}
+
+static int compression_test_net(struct unit_test_state *uts)
+{
+	ulong in_size = TEST_BUFFER_SIZE, size, ofs;
+	ulong plain_size = strlen(plain);
+	void *in, *out;
+
+	if (!IS_ENABLED(CONFIG_NET_DECOMPRESS))
+		return -EAGAIN;
+
+	in = malloc(TEST_BUFFER_SIZE);
+	out = malloc(TEST_BUFFER_SIZE);
+	ut_assertnonnull(in);
+	ut_assertnonnull(out);
+	ut_assertok(gzip(in, &in_size, (void *)plain, plain_size));
+
+	env_set("netdecompress", "yes");
+	ut_assertok(run_net_test(uts, "gzip", in, in_size, TEST_BUFFER_SIZE));
+	ut_assertok(run_net_test(uts, "zstd", zstd_compressed,
+				 zstd_compressed_size, TEST_BUFFER_SIZE));
+	ut_assertok(run_net_test(uts, "lz4", lz4_compressed,
+				 lz4_compressed_size, TEST_BUFFER_SIZE));
+	ut_assertok(run_net_test(uts, "none", plain, plain_size,
+				 TEST_BUFFER_SIZE));
+	ut_assertok(run_net_test(uts, "gzip, exact size", in, in_size,
+				 plain_size));
+
+	/* the output must not overrun */
+	ut_assertok(net_decomp_start(map_to_sysmem(out), plain_size - 1));
+	ut_assert(net_decomp_write(0, in, in_size));
+	ut_assert(!net_decomp_active());
+
+	/* a truncated file is an error */
+	ut_assertok(net_decomp_start(map_to_sysmem(out), TEST_BUFFER_SIZE));
+	ut_assertok(net_decomp_write(0, in, in_size - 1));
+	ut_asserteq(-EIO, net_decomp_finish(&size));
+
+	/* the format is found even if the file starts with tiny packets */
+	ut_assertok(net_decomp_start(map_to_sysmem(out), TEST_BUFFER_SIZE));
+	for (ofs = 0; ofs < 3; ofs++)
+		ut_assertok(net_decomp_write(ofs, zstd_compressed + ofs, 1));
+	ut_assertok(net_decomp_write(ofs, zstd_compressed + ofs,
+				     zstd_compressed_size - ofs));
+	ut_assertok(net_decomp_finish(&size));
+	ut_asserteq(plain_size, size);
+	ut_asserteq_mem(plain, out, size);
+
+	/*
+	 * Data held back in overlapping or duplicate pieces uses only one
+	 * range; data too far ahead, or needing a new range when none is left,
+	 * is refused but does not stop the file
+	 */
+	ut_assertok(net_decomp_start(map_to_sysmem(out), TEST_BUFFER_SIZE));
+	for (ofs = 0; ofs < 200; ofs++)
+		ut_assertok(net_decomp_write(100 + ofs / 2, in + 100 + ofs / 2,
+					     10));
+	for (ofs = 0; ofs < 63; ofs++)
+		ut_assertok(net_decomp_write(300 + ofs * 2, in + 300 + ofs * 2,
+					     1));
+	ut_asserteq(-ENOSPC, net_decomp_write(500, in + 500, 1));
+	ut_assertok(net_decomp_write(301, in + 301, 1));
+	ut_asserteq(-ENOSPC, net_decomp_write(NET_DECOMP_HOLD_SIZE, in, 1));
+	ut_assert(net_decomp_active());
+	ut_assertok(net_decomp_write(0, in, in_size));
+	ut_assertok(net_decomp_finish(&size));
+	ut_asserteq(plain_size, size);
+	ut_asserteq_mem(plain, out, size);
+
+	/* an LZ4 block larger than the frame allows is refused */
+	memcpy(in, lz4_compressed, lz4_compressed_size);
+	put_unaligned_le32(SZ_16M, in + 7 + (((u8 *)in)[4] & 0x08 ? 8 : 0));
+	ut_assertok(net_decomp_start(map_to_sysmem(out), TEST_BUFFER_SIZE));
+	ut_assert(net_decomp_write(0, in, lz4_compressed_size));
+	ut_assert(!net_decomp_active());
+
+	/* nothing is decompressed unless asked for */
+	env_set("netdecompress", NULL);
+	ut_assertok(net_decomp_start(map_to_sysmem(out), TEST_BUFFER_SIZE));
+	ut_assert(!net_decomp_active());
+
+	free(out);
+	free(in);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_net, 0);
+
+/* Write compressed data to a block device and check what arrives there */
+static int run_gzwrite_test(struct unit_test_state *uts,
+			    struct blk_desc *desc, void *in, ulong in_size,
+			    const void *expect, ulong size)
+{
+	lbaint_t blks = DIV_ROUND_UP(size, desc->blksz);
+	char *buf;
+
+	buf = malloc(blks * desc->blksz);
+	ut_assertnonnull(buf);
+
+	ut_assertok(gzwrite(in, in_size, desc, desc->blksz, SZ_1M, 0));
+	ut_asserteq(blks, blk_dread(desc, SZ_1M / desc->blksz, blks, buf));
+	ut_asserteq_mem(expect, buf, size);
+
+	/* the wrong size or a truncated input must be reported */
+	ut_asserteq(-1, gzwrite(in, in_size, desc, desc->blksz, SZ_1M,
+				size + 1));
+	ut_asserteq(-1, gzwrite(in, in_size - 5, desc, desc->blksz, SZ_1M,
+				size));
+	free(buf);
+
+	return 0;
+}
+
+static int compression_test_gzwrite(struct unit_test_state *uts)
+{
+	/* a zstd frame header asking for a 256MiB window, then an empty block */
+	static const u8 zstd_big_window[] = {
+		0x28, 0xb5, 0x2f, 0xfd, 0x00, 0x90, 0x01, 0x00, 0x00,
+	};
+	const ulong size = SZ_4K + 100;
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	ulong in_size = size;
+	char *ref, *in, *img;
+	char fname[256];
+	int i;
+
+	if (!IS_ENABLED(CONFIG_CMD_UNZIP) || !IS_ENABLED(CONFIG_SANDBOX))
+		return -EAGAIN;
+
+	/* use an image of our own, since the test writes to it */
+	os_persistent_file(fname, sizeof(fname), "gzwrite.img");
+	img = calloc(1, SZ_2M);
+	ut_assertnonnull(img);
+	ut_assertok(os_write_file(fname, img, SZ_2M));
+	free(img);
+
+	ut_assertok(host_create_device("test", true, DEFAULT_BLKSZ, &dev));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+
+	ref = malloc(size);
+	in = malloc(size);
+	ut_assertnonnull(ref);
+	ut_assertnonnull(in);
+
+	/* this takes several writes, with a partial block at the end */
+	for (i = 0; i < size; i++)
+		ref[i] = plain[i % strlen(plain)];
+	ut_assertok(gzip(in, &in_size, (void *)ref, size));
+	ut_assertok(run_gzwrite_test(uts, desc, in, in_size, ref, size));
+
+	/* a bad CRC in the trailer is reported along with the right one */
+	in[in_size - 8] ^= 1;
+	console_record_reset_enable();
+	ut_asserteq(-1, gzwrite(in, in_size, desc, desc->blksz, SZ_1M, size));
+	ut_assert_skip_to_line("\tuncompressed %lu of %lu", size, size);
+	ut_assert_nextlinen("\tcrcs == ");
+	ut_assert_console_end();
+
+	if (CONFIG_IS_ENABLED(ZSTD)) {
+		ut_assertok(run_gzwrite_test(uts, desc, (void *)zstd_compressed,
+					     zstd_compressed_size, plain,
+					     strlen(plain)));
+
+		/* zstd has no CRC32 to compare, so none is reported */
+		console_record_reset_enable();
+		ut_asserteq(-1, gzwrite((void *)zstd_compressed,
+					zstd_compressed_size, desc,
+					desc->blksz, SZ_1M, strlen(plain) + 1));
+		ut_assert_skip_to_line("\tuncompressed %zu of %zu",
+				       strlen(plain), strlen(plain) + 1);
+		ut_assert_console_end();
+
+		console_record_reset();
+		ut_asserteq(-1, gzwrite((void *)zstd_big_window,
+					sizeof(zstd_big_window), desc,
+					desc->blksz, SZ_1M, 0));
+		ut_assert_nextline("Error: zstd window of %u bytes is too large",
+				   SZ_256M);
+		ut_assert_console_end();
+	}
+
+	free(in);
+	free(ref);
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+	ut_assertok(os_unlink(fname));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_gzwrite, UT_TESTF_CONSOLE_REC);
+
 int do_ut_compression(struct cmd_tbl *cmdtp, int flag, int argc,
 		      char *const argv[])
 {
@@ -6,11 +6,18 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <os.h>
 #include <part.h>
 #include <sandbox_host.h>
+#include <squashfs.h>
 #include <usb.h>
 #include <asm/global_data.h>
 #include <asm/state.h>
+#include <dm/device-internal.h>
+#include <linux/sizes.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -335,3 +342,388 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/*
+ * Attach the image @img in the persistent-data directory to a new host
+ * device called @label, and probe its block device
+ */
+static int blk_test_attach(struct unit_test_state *uts, const char *label,
+			   const char *img, struct udevice **devp,
+			   struct udevice **blkp)
+{
+	char fname[256];
+
+	ut_assertok(os_persistent_file(fname, sizeof(fname), img));
+	ut_assertok(host_create_device(label, true, DEFAULT_BLKSZ, devp));
+	ut_assertok(host_attach_file(*devp, fname));
+	ut_assertok(blk_get_from_parent(*devp, blkp));
+	ut_assertok(device_probe(*blkp));
+
+	return 0;
+}
+
+/* Detach and unbind a host device set up by blk_test_attach() */
+static int blk_test_detach(struct unit_test_state *uts, struct udevice *dev)
+{
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+
+	return 0;
+}
+
+/* Test that the block cache returns the right data and reads ahead */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	const int count = SZ_256K / DEFAULT_BLKSZ;
+	struct block_cache_stats stats, old;
+	struct udevice *dev, *blk;
+	char *ref, *buf;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(BLOCK_CACHE))
+		return -EAGAIN;
+
+	ut_assertok(blk_test_attach(uts, "test", "2MB.ext2.img", &dev, &blk));
+
+	ref = malloc(SZ_256K);
+	ut_assertnonnull(ref);
+	buf = malloc(SZ_256K);
+	ut_assertnonnull(buf);
+
+	/* read the data with the cache disabled, for comparison */
+	blkcache_stats(&old);
+	blkcache_configure(0, 0);
+	ut_asserteq(count, blk_read(blk, 0, count, ref));
+
+	/* there is no read-ahead without a cache to hold it */
+	blkcache_configure(0, SZ_64K);
+	for (i = 0; i < 16; i++)
+		ut_asserteq(1, blk_read(blk, i, 1, buf));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.readaheads);
+	ut_asserteq(0, stats.max_entries);
+
+	/* without memory for the cache, reads stay uncached until reconfigured */
+	blkcache_configure(SZ_1M, SZ_64K);
+	malloc_enable_testing(0);
+	ut_asserteq(1, blk_read(blk, 0, 1, buf));
+	malloc_disable_testing();
+	for (i = 0; i < 16; i++)
+		ut_asserteq(1, blk_read(blk, i, 1, buf));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.readaheads);
+	ut_asserteq(0, stats.max_entries);
+
+	/* reading one block at a time should mostly hit read-ahead data */
+	blkcache_configure(SZ_1M, SZ_64K);
+	for (i = 0; i < count; i++)
+		ut_asserteq(1, blk_read(blk, i, 1, buf + i * DEFAULT_BLKSZ));
+	ut_asserteq_mem(ref, buf, SZ_256K);
+	blkcache_stats(&stats);
+	ut_assert(stats.readaheads > 0);
+	ut_assert(stats.hits > 8 * stats.misses);
+	ut_asserteq(SZ_1M / SZ_4K, stats.max_entries);
+
+	/* everything is cached now, in any order */
+	memset(buf, '\0', SZ_256K);
+	for (i = count - 1; i >= 0; i--)
+		ut_asserteq(1, blk_read(blk, i, 1, buf + i * DEFAULT_BLKSZ));
+	ut_asserteq_mem(ref, buf, SZ_256K);
+	blkcache_stats(&stats);
+	ut_asserteq(count, stats.hits);
+	ut_asserteq(0, stats.misses);
+	ut_asserteq(0, stats.readaheads);
+
+	/* writing drops the cached data but keeps the memory */
+	ut_asserteq(1, blk_write(blk, 0, 1, ref));
+	ut_asserteq(1, blk_read(blk, 1, 1, buf));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(1, stats.entries);
+	ut_asserteq(SZ_1M / SZ_4K, stats.max_entries);
+
+	/* the memory is freed when the only device using it goes away */
+	free(buf);
+	free(ref);
+	ut_assertok(blk_test_detach(uts, dev));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(0, stats.max_entries);
+
+	blkcache_configure(old.size, old.max_readahead);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+
+/* Write @size bytes from @buf to a file on the block device @desc */
+static int blk_test_write(struct unit_test_state *uts, struct blk_desc *desc,
+			  const char *fname, void *buf, loff_t size)
+{
+	loff_t actwrite;
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_write(fname, map_to_sysmem(buf), 0, size, &actwrite));
+	ut_asserteq(size, actwrite);
+
+	return 0;
+}
+
+/* Remove a file, or free its space if the filesystem cannot unlink */
+static int blk_test_remove(struct unit_test_state *uts, struct blk_desc *desc,
+			   const char *fname)
+{
+	char empty;
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	if (fs_get_type() == FS_TYPE_FAT) {
+		ut_assertok(fs_unlink(fname));
+		return 0;
+	}
+	fs_close();
+
+	return blk_test_write(uts, desc, fname, &empty, 0);
+}
+
+/* Read part of a file and return the number of device reads needed */
+static int blk_test_read(struct unit_test_state *uts, struct blk_desc *desc,
+			 const char *fname, void *buf, loff_t offset,
+			 loff_t len, int *readsp)
+{
+	struct block_cache_stats stats;
+	loff_t actread;
+
+	blkcache_stats(&stats);
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_read(fname, map_to_sysmem(buf), offset, len, &actread));
+	ut_asserteq(len, actread);
+	blkcache_stats(&stats);
+	*readsp = stats.misses;
+
+	return 0;
+}
+
+/*
+ * Check that /runs on the filesystem in @img reads back correctly and in
+ * no more than @maxreads device reads after the lookups. If @write is true
+ * the file is written first, split in two, otherwise it must hold a hole
+ * from 256KiB to 512KiB.
+ */
+static int blk_test_fs_runs(struct unit_test_state *uts, const char *img,
+			    bool write, int size, int maxreads)
+{
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	u32 *ref, *buf;
+	int i, base, reads;
+
+	ut_assertok(blk_test_attach(uts, "test", img, &dev, &blk));
+	desc = dev_get_uclass_plat(blk);
+
+	ref = malloc(size);
+	ut_assertnonnull(ref);
+	buf = malloc(size + 1);
+	ut_assertnonnull(buf);
+	for (i = 0; i < size / 4; i++)
+		ref[i] = i;
+
+	if (write) {
+		/*
+		 * Shrink a file to leave a gap before the next one, so that
+		 * the file is split in two
+		 */
+		ut_assertok(blk_test_write(uts, desc, "/gap", ref, SZ_64K));
+		ut_assertok(blk_test_write(uts, desc, "/keep", ref, SZ_64K));
+		ut_assertok(blk_test_write(uts, desc, "/gap", ref, SZ_4K));
+		ut_assertok(blk_test_write(uts, desc, "/runs", ref, size));
+	} else {
+		memset((char *)ref + SZ_256K, '\0', SZ_256K);
+	}
+
+	/* the lookups and the first block cost the same as for a tiny read */
+	ut_assertok(blk_test_read(uts, desc, "/runs", buf, 0, 1, &base));
+	ut_assertok(blk_test_read(uts, desc, "/runs", buf, 0, size, &reads));
+	ut_asserteq_mem(ref, buf, size);
+	ut_assert(reads - base <= maxreads);
+
+	/*
+	 * Partial blocks at both ends add a read each; FAT fills a misaligned
+	 * buffer through a copy of up to 64KiB at a time
+	 */
+	memset(buf, '\0', size);
+	ut_assertok(blk_test_read(uts, desc, "/runs", buf, 1001,
+				  size - 3000, &reads));
+	ut_asserteq_mem((char *)ref + 1001, buf, size - 3000);
+	ut_assert(reads - base <= maxreads + 2 + size / SZ_64K);
+
+	/* a misaligned buffer throughout */
+	ut_assertok(blk_test_read(uts, desc, "/runs", (char *)buf + 1, 0, size,
+				  &reads));
+	ut_asserteq_mem(ref, (char *)buf + 1, size);
+	ut_assert(reads - base <= maxreads + size / SZ_64K);
+
+	if (write) {
+		/* leave the image as it was, so that the test can run again */
+		ut_assertok(blk_test_remove(uts, desc, "/runs"));
+		ut_assertok(blk_test_remove(uts, desc, "/keep"));
+		ut_assertok(blk_test_remove(uts, desc, "/gap"));
+	}
+
+	free(buf);
+	free(ref);
+	ut_assertok(blk_test_detach(uts, dev));
+
+	return 0;
+}
+
+/*
+ * Check that /extents in the ext4 image reads back correctly, and that the
+ * index blocks above its extent leaves are not read again for every extent
+ */
+static int blk_test_fs_extents(struct unit_test_state *uts)
+{
+	const int count = 400, size = (count - 1) * SZ_8K + SZ_4K;
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	int i, base, reads;
+	u8 *buf;
+
+	ut_assertok(blk_test_attach(uts, "test", "8MB.ext4.img", &dev, &blk));
+	desc = dev_get_uclass_plat(blk);
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertok(blk_test_read(uts, desc, "/extents", buf, 0, 1, &base));
+	ut_assertok(blk_test_read(uts, desc, "/extents", buf, 0, size, &reads));
+	for (i = 0; i < size; i++)
+		ut_asserteq(i & SZ_4K ? 0 : (i / SZ_8K) % 255 + 1, buf[i]);
+
+	/*
+	 * Each extent takes one read, a few more where mkfs split a chunk
+	 * around the tree blocks. The index block and a leaf are read only
+	 * when moving to the next of the five leaves. Walking the tree again
+	 * for every run would take about 2000 reads, for every block 6000.
+	 */
+	ut_assert(reads - base <= count + count / 10);
+
+	free(buf);
+	ut_assertok(blk_test_detach(uts, dev));
+
+	return 0;
+}
+
+/* Test reading files a run of blocks at a time */
+static int dm_test_blk_fs_runs(struct unit_test_state *uts)
+{
+	struct block_cache_stats old;
+
+	if (!CONFIG_IS_ENABLED(BLOCK_CACHE))
+		return -EAGAIN;
+
+	/* every device read is a miss with the cache disabled */
+	blkcache_stats(&old);
+	blkcache_configure(0, 0);
+
+	/* block-mapped: four runs and three indirect blocks */
+	ut_assertok(blk_test_fs_runs(uts, "runs.ext2.img", true, SZ_512K, 7));
+
+	/* extent-mapped: two extents, created by test_ut_dm_init */
+	ut_assertok(blk_test_fs_runs(uts, "8MB.ext4.img", false, SZ_1M, 2));
+
+	/* extent-mapped with index blocks: one read per extent */
+	ut_assertok(blk_test_fs_extents(uts));
+
+	/* FAT: two runs of clusters, in an image of its own */
+	ut_assertok(blk_test_fs_runs(uts, "runs.fat32.img", true, SZ_256K, 2));
+
+	blkcache_configure(old.size, old.max_readahead);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_fs_runs, 0);
+
+/* Load a file from the SquashFS filesystem created by test_ut_dm_init */
+static int blk_test_sqfs_read(struct unit_test_state *uts,
+			      struct blk_desc *desc, const char *fname,
+			      int size)
+{
+	loff_t actread;
+	char *buf;
+	int i;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_read(fname, map_to_sysmem(buf), 0, 0, &actread));
+	ut_asserteq(size, actread);
+	for (i = 0; i < size; i++)
+		ut_asserteq((u8)(i * 7 + fname[1]), (u8)buf[i]);
+	free(buf);
+
+	return 0;
+}
+
+/*
+ * Test that SquashFS decompresses tables and fragment blocks only once, even
+ * though each load closes the filesystem
+ */
+static int dm_test_blk_sqfs_cache(struct unit_test_state *uts)
+{
+	struct squashfs_cache_stats stats;
+	struct udevice *dev, *blk, *dev2, *blk2;
+	struct blk_desc *desc, *desc2;
+	char fname[256];
+	loff_t size;
+	uint first;
+
+	if (!IS_ENABLED(CONFIG_FS_SQUASHFS))
+		return -EAGAIN;
+
+	/* test_ut_dm_init only creates the image if mksquashfs is present */
+	if (os_persistent_file(fname, sizeof(fname), "sqfs.img"))
+		return -EAGAIN;
+
+	ut_assertok(blk_test_attach(uts, "test", "sqfs.img", &dev, &blk));
+	desc = dev_get_uclass_plat(blk);
+	ut_assertok(blk_test_attach(uts, "test2", "sqfs.img", &dev2, &blk2));
+	desc2 = dev_get_uclass_plat(blk2);
+
+	/* start with the cache holding the filesystem on the other device */
+	ut_assertok(blk_test_sqfs_read(uts, desc2, "/c", 1500));
+
+	/* the first load decompresses the tables and the fragment block */
+	sqfs_cache_stats(&stats);
+	ut_assertok(blk_test_sqfs_read(uts, desc, "/a", 3000));
+	sqfs_cache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(3, stats.misses);
+	ut_assert(stats.decompressions >= 3);
+	first = stats.decompressions;
+
+	/* the other files share everything with it */
+	ut_assertok(blk_test_sqfs_read(uts, desc, "/b", 2000));
+	ut_assertok(blk_test_sqfs_read(uts, desc, "/c", 1500));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_size("/c", &size));
+	ut_asserteq(1500, size);
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_asserteq(1, fs_exists("/b"));
+	sqfs_cache_stats(&stats);
+	ut_asserteq(8, stats.hits);
+	ut_asserteq(0, stats.misses);
+	ut_asserteq(0, stats.decompressions);
+
+	/* probing the filesystem on another device drops the cache */
+	ut_assertok(blk_test_sqfs_read(uts, desc2, "/c", 1500));
+	sqfs_cache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(3, stats.misses);
+	ut_asserteq(first, stats.decompressions);
+
+	ut_assertok(blk_test_detach(uts, dev2));
+	ut_assertok(blk_test_detach(uts, dev));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_sqfs_cache, 0);
@@ -6,19 +6,23 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
 #include <dm.h>
+#include <event.h>
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <linux/libfdt.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -529,6 +533,74 @@ static int dm_test_leak(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_leak, 0);
 
+/* Add up the statistics of all the small-object size classes */
+static void malloc_slab_totals(struct malloc_class_stats *tot)
+{
+	struct malloc_class_stats st;
+	int i;
+
+	memset(tot, '\0', sizeof(*tot));
+	for (i = 0; !malloc_get_class_stats(i, &st); i++) {
+		tot->allocs += st.allocs;
+		tot->hits += st.hits;
+		tot->frees += st.frees;
+		tot->cached += st.cached;
+	}
+}
+
+/* Bind, probe and remove the test devices, checking for leaks */
+static int dm_test_slab_round(struct unit_test_state *uts)
+{
+	dm_leak_check_start(uts);
+	ut_assertok(dm_scan_plat(false));
+	ut_assertok(dm_scan_fdt(false));
+	ut_assertok(uclass_probe_all(UCLASS_TEST));
+	ut_assertok(dm_leak_check_end(uts));
+
+	return 0;
+}
+
+/* Check that the malloc free lists are used, and bypassed when disabled */
+static int dm_test_leak_slab(struct unit_test_state *uts)
+{
+	struct malloc_class_stats before, after;
+
+	if (!IS_ENABLED(CONFIG_SYS_MALLOC_SLAB))
+		return -EAGAIN;
+
+	/* disabling the free lists empties them and stops the counting */
+	malloc_slab_enable(false);
+	malloc_slab_totals(&before);
+	ut_asserteq(0, before.cached);
+	ut_assertok(dm_test_slab_round(uts));
+	malloc_slab_totals(&after);
+	ut_asserteq(before.allocs, after.allocs);
+	ut_asserteq(before.hits, after.hits);
+	ut_asserteq(before.frees, after.frees);
+	ut_asserteq(0, after.cached);
+
+	/* chunks freed in the first round are handed out again in the second */
+	malloc_slab_enable(true);
+	ut_assertok(dm_test_slab_round(uts));
+	malloc_slab_totals(&before);
+	ut_assert(before.allocs > after.allocs);
+	ut_assert(before.frees > after.frees);
+	ut_assert(before.cached > 0);
+	ut_assertok(dm_test_slab_round(uts));
+	malloc_slab_totals(&after);
+	ut_assert(after.hits > before.hits);
+	ut_assert(after.hits - before.hits <= after.allocs - before.allocs);
+
+	/* turning them off gives the cached chunks back to the heap */
+	malloc_slab_enable(false);
+	malloc_slab_totals(&after);
+	ut_asserteq(0, after.cached);
+	malloc_slab_enable(true);
+
+	return 0;
+}
+DM_TEST(dm_test_leak_slab, 0);
+
 /* Test uclass init/destroy methods */
 static int dm_test_uclass(struct unit_test_state *uts)
 {
@@ -1353,3 +1425,257 @@ static int dm_test_dev_get_mem(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_dev_get_mem, UT_TESTF_SCAN_FDT);
+
+/* Find the first device in @uc with @seq or @node by walking the uclass */
+static struct udevice *walk_uclass(struct uclass *uc, int seq, ofnode node)
+{
+	struct udevice *dev;
+
+	uclass_foreach_dev(dev, uc) {
+		if (seq != -1 ? dev_seq(dev) == seq :
+		    ofnode_equal(dev_ofnode(dev), node))
+			return dev;
+	}
+
+	return NULL;
+}
+
+/* Check that lookups find the same device as a walk of the uclass */
+static int dm_test_uclass_lookup(struct unit_test_state *uts)
+{
+	struct udevice *dev, *found;
+	struct uclass *uc;
+	enum uclass_id id;
+	ofnode node;
+	int seq;
+
+	list_for_each_entry(uc, gd->uclass_root, sibling_node) {
+		id = uc->uc_drv->id;
+		uclass_foreach_dev(dev, uc) {
+			seq = dev_seq(dev);
+			if (seq != -1) {
+				ut_assertok(uclass_find_device_by_seq(id, seq,
+								      &found));
+				ut_asserteq_ptr(walk_uclass(uc, seq,
+							    ofnode_null()),
+						found);
+			}
+			node = dev_ofnode(dev);
+			if (ofnode_valid(node)) {
+				ut_assertok(uclass_find_device_by_ofnode(id,
+									 node,
+									 &found));
+				ut_asserteq_ptr(walk_uclass(uc, -1, node),
+						found);
+			}
+		}
+	}
+
+	/* an unbound device cannot be found any more */
+	ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(test_drv), "lookup", 0,
+				ofnode_null(), &dev));
+	seq = dev_seq(dev);
+	ut_assertok(uclass_find_device_by_seq(UCLASS_TEST, seq, &found));
+	ut_asserteq_ptr(dev, found);
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST, seq,
+						       &found));
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_lookup, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/*
+ * Check that lookups in a large uclass find the right device, and that they
+ * use the index rather than walking the uclass
+ */
+static int dm_test_uclass_lookup_scale(struct unit_test_state *uts)
+{
+	const int count = 1024;
+	struct udevice **devs, *dev, *found;
+	struct list_head *prev;
+	int i, ret;
+
+	devs = calloc(count, sizeof(*devs));
+	ut_assertnonnull(devs);
+	for (i = 0; i < count; i++)
+		ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(test_drv),
+					"scale", 0, ofnode_null(), &devs[i]));
+
+	for (i = 0; i < count; i++) {
+		dev = devs[(i * 389) % count];
+		ut_assertok(uclass_find_device_by_seq(UCLASS_TEST, dev_seq(dev),
+						      &found));
+		ut_asserteq_ptr(dev, found);
+	}
+
+	/*
+	 * A device taken off the uclass list can then only be found through
+	 * the index, so this fails if lookups go back to walking the list
+	 */
+	if (CONFIG_IS_ENABLED(DM_UCLASS_INDEX)) {
+		dev = devs[count / 2];
+		prev = dev->uclass_node.prev;
+		list_del(&dev->uclass_node);
+		ret = uclass_find_device_by_seq(UCLASS_TEST, dev_seq(dev),
+						&found);
+		list_add(&dev->uclass_node, prev);
+		ut_assertok(ret);
+		ut_asserteq_ptr(dev, found);
+	}
+
+	for (i = 0; i < count; i++)
+		ut_assertok(device_unbind(devs[i]));
+	free(devs);
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_lookup_scale, 0);
+
+/* Find the driver for a compatible string the slow way */
+static struct driver *compat_lookup_linear(const char *compat,
+					   const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match;
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match; of_match && of_match->compatible;
+		     of_match++) {
+			if (!strcmp(of_match->compatible, compat)) {
+				*idp = of_match;
+				return entry;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Check that each compatible string is matched to the expected driver */
+static int check_compat(struct unit_test_state *uts, const char *compat)
+{
+	const struct udevice_id *id, *expect_id = NULL;
+	struct driver *drv, *expect;
+
+	id = NULL;
+	expect = compat_lookup_linear(compat, &expect_id);
+	drv = lists_driver_lookup_compat(compat, &id);
+	ut_asserteq_ptr(expect, drv);
+	if (drv)
+		ut_asserteq_ptr(expect_id, id);
+
+	return 0;
+}
+
+/* Test that drivers are found for compatible strings as with a linear search */
+static int dm_test_lists_compat(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match, *id;
+	const char *compat;
+	struct driver *entry;
+	int count = 0, i;
+	ofnode node;
+
+	/* Every compatible string of every driver */
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match; of_match && of_match->compatible;
+		     of_match++) {
+			ut_assertok(check_compat(uts, of_match->compatible));
+			count++;
+		}
+	}
+	ut_assert(count > 100);
+
+	/* Every compatible string in the device tree, matching or not */
+	ofnode_for_each_subnode(node, ofnode_root()) {
+		for (i = 0; !ofnode_read_string_index(node, "compatible", i,
+						      &compat); i++)
+			ut_assertok(check_compat(uts, compat));
+	}
+	ut_assertnull(lists_driver_lookup_compat("sandbox,no-such-device", &id));
+
+	/* The second string in a driver's table gives its data */
+	ut_asserteq_ptr(DM_DRIVER_GET(denx_u_boot_fdt_test),
+			lists_driver_lookup_compat("google,another-fdt-test",
+						   &id));
+	ut_asserteq(DM_TEST_TYPE_SECOND, id->data);
+
+	return 0;
+}
+DM_TEST(dm_test_lists_compat, UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(DM_PROBE_TIME)
+/* Make the probe of each test device take a known amount of time */
+static int h_probe_time(void *ctx, struct event *event)
+{
+	struct udevice *dev = event->data.dm.dev;
+
+	if (!strcmp(dev->name, "probe-parent"))
+		timer_test_add_offset(2);
+	else if (!strcmp(dev->name, "probe-child"))
+		timer_test_add_offset(5);
+
+	return 0;
+}
+
+/* Test that probe time is recorded against the right device */
+static int dm_test_probe_time(struct unit_test_state *uts)
+{
+	struct udevice *parent, *child;
+	struct fdt_header *old_fdt;
+	char fdt[4096];
+	int node, len;
+	bool found;
+
+	ut_assertok(event_register("probe_time", EVT_DM_POST_PROBE,
+				   h_probe_time, NULL));
+	ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(test_drv),
+				"probe-parent", (void *)&test_pdata_manual,
+				ofnode_null(), &parent));
+	ut_assertok(device_bind(parent, DM_DRIVER_GET(test_drv), "probe-child",
+				(void *)&test_pdata_manual, ofnode_null(),
+				&child));
+
+	/* the parent is probed first but is not charged for the child */
+	ut_assertok(device_probe(child));
+	ut_assert(parent->probe_us >= 2000);
+	ut_assert(parent->probe_us < 5000);
+	ut_assert(child->probe_us >= 5000);
+	ut_assert(child->probe_us < 7000);
+
+	/* the child took longest, so comes first */
+	console_record_reset_enable();
+	ut_assertok(run_command("dm probetime", 0));
+	ut_assert_nextline("Device               Uclass        Self (us) Total (us)");
+	ut_assert_nextlinen("-----");
+	ut_assert_nextlinen("probe-child          test");
+	ut_assert_nextlinen("probe-parent         test");
+
+	/* check that the child is added to the bootstage node */
+	ut_assertok(fdt_create_empty_tree(fdt, sizeof(fdt)));
+	old_fdt = working_fdt;
+	working_fdt = (struct fdt_header *)fdt;
+	ut_assertok(bootstage_fdt_add_report());
+	working_fdt = old_fdt;
+	found = false;
+	fdt_for_each_subnode(node, fdt, fdt_path_offset(fdt, "/bootstage")) {
+		if (strcmp("probe probe-child",
+			   fdt_getprop(fdt, node, "name", NULL)))
+			continue;
+		ut_asserteq_str("probe-parent",
+				fdt_getprop(fdt, node, "parent", &len));
+		ut_asserteq(child->probe_us,
+			    fdtdec_get_int(fdt, node, "accum", 0));
+		found = true;
+	}
+	ut_assert(found);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_time, UT_TESTF_CONSOLE_REC);
+#endif
@@ -617,6 +617,56 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 
 DM_TEST(dm_test_eth_async_ping_reply, UT_TESTF_SCAN_FDT);
 
+static int sb_rx_batch_replies;
+
+static int sb_with_rx_batch_handler(struct udevice *dev, void *packet,
+				    unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
+	/* Used by all of the ut_assert macros */
+	struct unit_test_state *uts = priv->priv;
+	int i;
+
+	if (ntohs(eth->et_protlen) != PROT_ARP)
+		return sandbox_eth_ping_req_to_reply(dev, packet, len);
+
+	if (ntohs(arp->ar_op) == ARPOP_REPLY) {
+		/* The whole batch left the queue before it was processed */
+		ut_asserteq(0, priv->recv_packets);
+		sb_rx_batch_replies++;
+		return 0;
+	}
+
+	/* Fill the queue with requests from another host, then our reply */
+	priv->fake_host_ipaddr = string_to_ip("1.1.2.4");
+	for (i = 0; i < PKTBUFSRX - 1; i++)
+		ut_assertok(sandbox_eth_recv_arp_req(dev));
+
+	return sandbox_eth_arp_req_to_reply(dev, packet, len);
+}
+
+static int dm_test_eth_rx_batch(struct unit_test_state *uts)
+{
+	net_ping_ip = string_to_ip("1.1.2.2");
+	sb_rx_batch_replies = 0;
+
+	sandbox_eth_set_tx_handler(0, sb_with_rx_batch_handler);
+	/* Used by all of the ut_assert macros in the tx_handler */
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	ut_assertok(net_loop(PING));
+	ut_asserteq(PKTBUFSRX - 1, sb_rx_batch_replies);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_rx_batch, UT_TESTF_SCAN_FDT);
+
 #if IS_ENABLED(CONFIG_IPV6_ROUTER_DISCOVERY)
 
 static u8 ip6_ra_buf[] = {0x60, 0xf, 0xc5, 0x4a, 0x0, 0x38, 0x3a, 0xff, 0xfe,
@@ -20,6 +20,7 @@
 #include <dm/uclass-internal.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <linux/sizes.h>
 
 /*
  * These tests use the standard sandbox frame buffer, the resolution of which
@@ -82,8 +83,12 @@ static int compress_frame_buffer(struct unit_test_state *uts,
 	if (ret)
 		return ret;
 
-	/* Check here that the copy frame buffer is working correctly */
+	/*
+	 * Check here that the copy frame buffer is working correctly. With
+	 * CONFIG_VIDEO_DAMAGE the copy is only updated by video_sync()
+	 */
 	if (IS_ENABLED(CONFIG_VIDEO_COPY)) {
+		ut_assertok(video_sync(dev, false));
 		ut_assertf(!memcmp(uc_priv->fb, uc_priv->copy_fb,
 				   uc_priv->fb_size),
 				   "Copy framebuffer does not match fb");
@@ -231,6 +236,65 @@ static int dm_test_video_chars(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_chars, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* Test that video_sync() only handles the parts of the display which changed */
+static int dm_test_video_damage(struct unit_test_state *uts)
+{
+	struct video_priv *priv;
+	struct udevice *dev, *con;
+	int pbytes;
+
+	if (!IS_ENABLED(CONFIG_VIDEO_DAMAGE))
+		return -EAGAIN;
+
+	ut_assertok(select_vidconsole(uts, "vidconsole0"));
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	ut_assertok(vidconsole_select_font(con, "8x16", 0));
+	priv = dev_get_uclass_priv(dev);
+	pbytes = VNBYTES(priv->bpix);
+
+	/* Nothing has changed since the display was cleared */
+	ut_assertok(video_sync(dev, false));
+	ut_assertok(video_sync(dev, false));
+	ut_asserteq(0, priv->sync_bytes);
+
+	/* A single character only needs its own cell synced */
+	vidconsole_putc_xy(con, VID_TO_POS(80), 32, 'a');
+	ut_assertok(video_sync(dev, false));
+	ut_asserteq(8 * 16 * pbytes, priv->sync_bytes);
+
+	/* Two characters are covered by a single rectangle */
+	vidconsole_putc_xy(con, VID_TO_POS(8), 16, 'b');
+	vidconsole_putc_xy(con, VID_TO_POS(24), 48, 'c');
+	ut_assertok(video_sync(dev, false));
+	ut_asserteq(24 * 48 * pbytes, priv->sync_bytes);
+
+	/* Filled areas are clipped to the display */
+	ut_assertok(video_fill_part(dev, priv->xsize - 10, priv->ysize - 5,
+				    priv->xsize + 10, priv->ysize + 5, 0));
+	ut_assertok(video_sync(dev, false));
+	ut_asserteq(10 * 5 * pbytes, priv->sync_bytes);
+	ut_assertok(video_fill_part(dev, priv->xsize, 0, priv->xsize + 10,
+				    priv->ysize, 0));
+	ut_assertok(video_sync(dev, false));
+	ut_asserteq(0, priv->sync_bytes);
+
+	/* Clearing a text row covers whole lines */
+	ut_assertok(vidconsole_set_row(con, 1, 0));
+	ut_assertok(video_sync(dev, false));
+	ut_asserteq(16 * priv->line_length, priv->sync_bytes);
+
+	/* Clearing the display needs everything synced */
+	ut_assertok(video_clear(dev));
+	ut_asserteq(priv->ysize * priv->line_length, priv->sync_bytes);
+
+	/* The copy frame buffer must still match */
+	ut_asserteq(46, compress_frame_buffer(uts, dev));
+
+	return 0;
+}
+DM_TEST(dm_test_video_damage, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
 #ifdef CONFIG_VIDEO_ANSI
 #define ANSI_ESC "\x1b"
 /* Test handling of ANSI escape sequences */
@@ -604,3 +668,80 @@ static int dm_test_video_truetype_bs(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_video_truetype_bs, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test the TrueType glyph cache */
+static int dm_test_video_truetype_cache(struct unit_test_state *uts)
+{
+	const char *test_string = "Criticism may not be agreeable, but it is necessary. It fulfils the same function as pain in the human body. It calls attention to an unhealthy state of things.\n";
+	struct console_tt_cache_stats stats;
+	struct udevice *dev, *con;
+	ulong misses;
+	int len, i;
+
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	len = strlen(test_string) - 1;
+
+	/* with the cache disabled, nothing is counted */
+	console_truetype_set_cache_size(con, 0);
+	vidconsole_put_string(con, test_string);
+	console_truetype_get_cache_stats(con, &stats);
+	ut_asserteq(0, stats.used);
+	ut_asserteq(0, stats.glyphs);
+	ut_asserteq(0, stats.hits + stats.misses);
+
+	/* each character / sub-pixel position should be rendered only once */
+	console_truetype_set_cache_size(con, SZ_64K);
+	ut_assertok(vidconsole_clear_and_reset(con));
+	vidconsole_put_string(con, test_string);
+	console_truetype_get_cache_stats(con, &stats);
+	ut_asserteq(SZ_64K, stats.size);
+	ut_asserteq(len, stats.hits + stats.misses);
+	ut_asserteq(stats.glyphs, stats.misses);
+	ut_assert(stats.hits > 0);
+	ut_assert(stats.used <= stats.size);
+	ut_asserteq(4620, compress_frame_buffer(uts, dev));
+
+	/* drawing the text again renders nothing */
+	misses = stats.misses;
+	for (i = 0; i < 3; i++) {
+		ut_assertok(vidconsole_clear_and_reset(con));
+		vidconsole_put_string(con, test_string);
+	}
+	console_truetype_get_cache_stats(con, &stats);
+	ut_asserteq(misses, stats.misses);
+	ut_asserteq(len * 4 - misses, stats.hits);
+
+	/*
+	 * a cache which is too small for the text must keep to its limit and
+	 * still draw the same thing
+	 */
+	console_truetype_set_cache_size(con, SZ_16K);
+	console_truetype_get_cache_stats(con, &stats);
+	ut_assert(stats.used <= SZ_16K);
+	ut_assert(stats.glyphs < misses);
+	ut_assertok(vidconsole_clear_and_reset(con));
+	vidconsole_put_string(con, test_string);
+	console_truetype_get_cache_stats(con, &stats);
+	ut_assert(stats.used <= SZ_16K);
+	ut_assert(stats.misses > misses);
+	ut_asserteq(4620, compress_frame_buffer(uts, dev));
+
+	/* a cache too small for the per-font table is not used at all */
+	console_truetype_set_cache_size(con, SZ_4K);
+	console_truetype_get_cache_stats(con, &stats);
+	ut_asserteq(0, stats.used);
+	ut_asserteq(0, stats.glyphs);
+	misses = stats.misses;
+	vidconsole_put_string(con, test_string);
+	console_truetype_get_cache_stats(con, &stats);
+	ut_asserteq(misses, stats.misses);
+	ut_asserteq(0, stats.used);
+
+	console_truetype_set_cache_size(con,
+					CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE *
+					SZ_1K);
+
+	return 0;
+}
+DM_TEST(dm_test_video_truetype_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -7,13 +7,16 @@
 #include <common.h>
 #include <command.h>
 #include <log.h>
+#include <malloc.h>
 #include <search.h>
 #include <stdio.h>
+#include <time.h>
 #include <test/env.h>
 #include <test/ut.h>
 
 #define SIZE 32
 #define ITERATIONS 10000
+#define IMPORT_VARS 10000
 
 static int htab_fill(struct unit_test_state *uts,
 		     struct hsearch_data *htab, size_t size)
@@ -124,3 +127,78 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/* Fill the hashtable far beyond its initial size */
+static int env_test_htab_grow(struct unit_test_state *uts)
+{
+	struct hsearch_stats stats;
+	struct hsearch_data htab;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+
+	ut_assertok(htab_fill(uts, &htab, SIZE * 40));
+	ut_assertok(htab_check_fill(uts, &htab, SIZE * 40));
+	ut_asserteq(SIZE * 40, htab.filled);
+
+	/* the table is kept at most three quarters full */
+	hstats_r(&htab, &stats);
+	ut_asserteq(SIZE * 40, stats.filled);
+	ut_asserteq(htab.size, stats.size);
+	ut_assert(stats.filled * 4 <= stats.size * 3);
+	ut_asserteq(0, stats.deleted);
+	ut_assert(stats.probes < stats.filled * 2);
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_grow, 0);
+
+/* Import a large environment with long common prefixes */
+static int env_test_htab_import(struct unit_test_state *uts)
+{
+	struct hsearch_stats stats;
+	struct hsearch_data htab;
+	struct env_entry item, *ritem;
+	char key[40], value[40];
+	ulong start, us;
+	char *env, *p;
+	int i;
+
+	env = malloc(IMPORT_VARS * 48);
+	ut_assertnonnull(env);
+	for (i = 0, p = env; i < IMPORT_VARS; i++)
+		p += sprintf(p, "provisioning_variable_%05d=value %d", i, i) + 1;
+	*p = '\0';
+
+	memset(&htab, 0, sizeof(htab));
+	start = timer_get_us();
+	ut_asserteq(1, himport_r(&htab, env, p - env + 1, '\0', 0, 0, 0,
+				 NULL));
+	us = timer_get_us() - start;
+	ut_asserteq(IMPORT_VARS, htab.filled);
+
+	hstats_r(&htab, &stats);
+	printf("%d variables: imported in %lu us, %u entries, %u.%02u probes\n",
+	       IMPORT_VARS, us, stats.size, stats.probes / stats.filled,
+	       stats.probes % stats.filled * 100 / stats.filled);
+	ut_assert(stats.probes < stats.filled * 2);
+
+	for (i = 0; i < IMPORT_VARS; i++) {
+		sprintf(key, "provisioning_variable_%05d", i);
+		sprintf(value, "value %d", i);
+		item.key = key;
+		item.data = NULL;
+		hsearch_r(item, ENV_FIND, &ritem, &htab, 0);
+		ut_assertnonnull(ritem);
+		ut_asserteq_str(value, ritem->data);
+	}
+
+	hdestroy_r(&htab);
+	free(env);
+
+	return 0;
+}
+
+ENV_TEST(env_test_htab_import, 0);
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing Android sparse images
+ */
+
+#include <image-sparse.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <sparse_format.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+
+#define TEST_BLKSZ		512
+#define TEST_SPARSE_BLKSZ	4096
+#define TEST_BLKS		512
+#define TEST_ERASE_BLKS		32
+
+/**
+ * struct sparse_test - memory-backed storage for a sparse image
+ *
+ * @mem: Storage contents
+ * @first_write: Buffer passed to the first write
+ * @erased: Number of blocks erased
+ */
+struct sparse_test {
+	u8 *mem;
+	const void *first_write;
+	lbaint_t erased;
+};
+
+static lbaint_t sparse_test_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	struct sparse_test *priv = info->priv;
+
+	if (!priv->first_write)
+		priv->first_write = buffer;
+	memcpy(priv->mem + blk * TEST_BLKSZ, buffer, blkcnt * TEST_BLKSZ);
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_reserve(struct sparse_storage *info, lbaint_t blk,
+				    lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_erase(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	struct sparse_test *priv = info->priv;
+
+	if (blk % TEST_ERASE_BLKS || blkcnt % TEST_ERASE_BLKS)
+		return 0;
+	memset(priv->mem + blk * TEST_BLKSZ, '\0', blkcnt * TEST_BLKSZ);
+	priv->erased += blkcnt;
+
+	return blkcnt;
+}
+
+/* Add a chunk to the image, returning a pointer to its data */
+static void *add_chunk(void **ptrp, u16 type, u32 blks, u32 data_sz)
+{
+	chunk_header_t *chunk = *ptrp;
+
+	chunk->chunk_type = type;
+	chunk->reserved1 = 0;
+	chunk->chunk_sz = blks;
+	chunk->total_sz = sizeof(*chunk) + data_sz;
+	*ptrp += chunk->total_sz;
+
+	return chunk + 1;
+}
+
+/* Test writing a sparse image, with and without an erase callback */
+static int lib_test_image_sparse(struct unit_test_state *uts)
+{
+	struct sparse_storage info;
+	struct sparse_test priv;
+	sparse_header_t *hdr;
+	void *buf, *image, *ptr, *raw;
+	u8 *expect;
+	int use_erase;
+	u32 *fill;
+	int i;
+
+	buf = memalign(ARCH_DMA_MINALIGN, SZ_64K);
+	expect = malloc(TEST_BLKS * TEST_BLKSZ);
+	priv.mem = malloc(TEST_BLKS * TEST_BLKSZ);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(priv.mem);
+
+	/* place the image so that the first raw chunk is aligned for DMA */
+	image = buf + ARCH_DMA_MINALIGN -
+		(sizeof(*hdr) + sizeof(chunk_header_t)) % ARCH_DMA_MINALIGN;
+	hdr = image;
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->magic = SPARSE_HEADER_MAGIC;
+	hdr->major_version = 1;
+	hdr->file_hdr_sz = sizeof(*hdr);
+	hdr->chunk_hdr_sz = sizeof(chunk_header_t);
+	hdr->blk_sz = TEST_SPARSE_BLKSZ;
+	hdr->total_chunks = 5;
+	hdr->total_blks = 2 + 9 + 1 + 2 + 1;
+	ptr = image + hdr->file_hdr_sz;
+	memset(expect, 0xaa, TEST_BLKS * TEST_BLKSZ);
+
+	raw = add_chunk(&ptr, CHUNK_TYPE_RAW, 2, 2 * TEST_SPARSE_BLKSZ);
+	ut_assert(IS_ALIGNED((ulong)raw, ARCH_DMA_MINALIGN));
+	for (i = 0; i < 2 * TEST_SPARSE_BLKSZ; i++)
+		((u8 *)raw)[i] = i * 7;
+	memcpy(expect, raw, 2 * TEST_SPARSE_BLKSZ);
+
+	/* this covers part of two erase units and one whole one */
+	fill = add_chunk(&ptr, CHUNK_TYPE_FILL, 9, sizeof(u32));
+	*fill = 0;
+	memset(expect + 2 * TEST_SPARSE_BLKSZ, '\0', 9 * TEST_SPARSE_BLKSZ);
+
+	add_chunk(&ptr, CHUNK_TYPE_DONT_CARE, 1, 0);
+
+	fill = add_chunk(&ptr, CHUNK_TYPE_FILL, 2, sizeof(u32));
+	*fill = 0x12345678;
+	for (i = 0; i < 2 * TEST_SPARSE_BLKSZ / sizeof(u32); i++)
+		((u32 *)(expect + 12 * TEST_SPARSE_BLKSZ))[i] = 0x12345678;
+
+	raw = add_chunk(&ptr, CHUNK_TYPE_RAW, 1, TEST_SPARSE_BLKSZ);
+	memset(raw, 0x55, TEST_SPARSE_BLKSZ);
+	memset(expect + 14 * TEST_SPARSE_BLKSZ, 0x55, TEST_SPARSE_BLKSZ);
+
+	for (use_erase = 0; use_erase < 2; use_erase++) {
+		memset(priv.mem, 0xaa, TEST_BLKS * TEST_BLKSZ);
+		priv.first_write = NULL;
+		priv.erased = 0;
+
+		info.blksz = TEST_BLKSZ;
+		info.start = 0;
+		info.size = TEST_BLKS;
+		info.erase_blks = TEST_ERASE_BLKS;
+		info.priv = &priv;
+		info.write = sparse_test_write;
+		info.reserve = sparse_test_reserve;
+		info.erase = use_erase ? sparse_test_erase : NULL;
+		info.mssg = NULL;
+		ut_assertok(write_sparse_image(&info, "test", image, NULL));
+
+		ut_asserteq_mem(expect, priv.mem, TEST_BLKS * TEST_BLKSZ);
+		ut_asserteq(use_erase ? TEST_ERASE_BLKS : 0, priv.erased);
+
+		/* the aligned chunk is written from the image itself */
+		ut_asserteq_ptr(image + sizeof(*hdr) + sizeof(chunk_header_t),
+				priv.first_write);
+	}
+
+	free(priv.mem);
+	free(expect);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_image_sparse, 0);
@@ -700,12 +700,13 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, 0);
 
-	/*  error for the (CONFIG_LMB_MAX_REGIONS + 1) memory regions */
+	/*  the (CONFIG_LMB_MAX_REGIONS + 1) memory region grows the array */
 	offset = ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * ram_size;
 	ret = lmb_add(&lmb, offset, ram_size);
-	ut_asserteq(ret, -1);
+	ut_asserteq(ret, 0);
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
+	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS + 1);
+	ut_assert(lmb.memory.max > CONFIG_LMB_MAX_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, 0);
 
 	/*  reserve CONFIG_LMB_MAX_REGIONS regions */
@@ -715,29 +716,116 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 		ut_asserteq(ret, 0);
 	}
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
+	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS + 1);
 	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
 
-	/*  error for the 9th reserved blocks */
+	/*  and so does the next reserved block */
 	offset = ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * blk_size;
 	ret = lmb_reserve(&lmb, offset, blk_size);
-	ut_asserteq(ret, -1);
+	ut_asserteq(ret, 0);
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
-	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
+	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS + 1);
+	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS + 1);
+	ut_assert(lmb.reserved.max > CONFIG_LMB_MAX_REGIONS);
 
 	/*  check each regions */
 	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++)
 		ut_asserteq(lmb.memory.region[i].base, ram + 2 * i * ram_size);
+	ut_asserteq(lmb.memory.region[i].base,
+		    ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * ram_size);
 
 	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++)
 		ut_asserteq(lmb.reserved.region[i].base, ram + 2 * i * blk_size);
+	ut_asserteq(lmb.reserved.region[i].base,
+		    ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * blk_size);
+
+	lmb_uninit(&lmb);
 
 	return 0;
 }
 LIB_TEST(lib_test_lmb_max_regions, 0);
 #endif
 
+/* Reserve and free thousands of discontiguous blocks */
+static int lib_test_lmb_many_regions(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t blk = 0x1000;
+	const int count = 5000;
+	struct lmb lmb;
+	phys_addr_t addr;
+	int i;
+
+	lmb_init(&lmb);
+	ut_assertok(lmb_add(&lmb, ram, 2 * count * blk));
+
+	/* reserve every other block, in a scrambled order */
+	for (i = 0; i < count; i++) {
+		addr = ram + 2 * ((i * 2039) % count) * blk;
+		ut_assertok(lmb_reserve(&lmb, addr, blk));
+	}
+	ut_asserteq(count, lmb.reserved.cnt);
+	ut_assert(lmb.reserved.max >= count);
+	for (i = 0; i < count; i++) {
+		addr = ram + 2 * i * blk;
+		ut_asserteq(addr, lmb.reserved.region[i].base);
+		ut_asserteq(1, lmb_is_reserved(&lmb, addr + blk - 1));
+		ut_asserteq(0, lmb_is_reserved(&lmb, addr + blk));
+		ut_asserteq(blk, lmb_get_free_size(&lmb, addr + blk));
+		ut_asserteq(-1, lmb_reserve(&lmb, addr + blk / 2, blk));
+	}
+
+	/* a block fits in the top gap, anything bigger fits nowhere */
+	addr = lmb_alloc(&lmb, blk, blk);
+	ut_asserteq(ram + (2 * count - 1) * blk, addr);
+	ut_asserteq(count, lmb.reserved.cnt);
+	ut_asserteq(0, __lmb_alloc_base(&lmb, 2 * blk, blk, 0));
+
+	/* filling the other gaps merges everything into one region */
+	for (i = 0; i < count - 1; i++) {
+		addr = ram + (2 * i + 1) * blk;
+		ut_asserteq(addr, lmb_alloc_addr(&lmb, addr, blk));
+	}
+	ASSERT_LMB(&lmb, ram, 2 * count * blk, 1, ram, 2 * count * blk,
+		   0, 0, 0, 0);
+
+	/* punching the holes again splits it */
+	for (i = 0; i < count; i++)
+		ut_assertok(lmb_free(&lmb, ram + (2 * i + 1) * blk, blk));
+	ut_asserteq(count, lmb.reserved.cnt);
+	for (i = 0; i < count; i++)
+		ut_assertok(lmb_free(&lmb, ram + 2 * i * blk, blk));
+	ut_asserteq(0, lmb.reserved.cnt);
+
+	lmb_uninit(&lmb);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_many_regions, 0);
+
+/* An lmb which was never initialised gets its arrays on first use */
+static int lib_test_lmb_zeroed(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	struct lmb lmb;
+
+	memset(&lmb, '\0', sizeof(lmb));
+	ut_assertok(lmb_reserve(&lmb, ram + 0x2000, 0x1000));
+	ut_assertok(lmb_reserve(&lmb, ram, 0x1000));
+	ut_asserteq(2, lmb.reserved.cnt);
+	ut_asserteq(LMB_RESERVED_REGIONS, lmb.reserved.max);
+	ut_asserteq(ram, lmb.reserved.region[0].base);
+	ut_asserteq(ram + 0x2000, lmb.reserved.region[1].base);
+	ut_assertok(lmb_add(&lmb, ram, 0x10000));
+	ut_asserteq(ram + 0x1000, lmb_alloc_addr(&lmb, ram + 0x1000, 0x1000));
+	ASSERT_LMB(&lmb, ram, 0x10000, 1, ram, 0x3000, 0, 0, 0, 0);
+
+	lmb_uninit(&lmb);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_zeroed, 0);
+
 static int lib_test_lmb_flags(struct unit_test_state *uts)
 {
 	const phys_addr_t ram = 0x40000000;
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit test for crc32 and its engines
+ */
+
+#include <malloc.h>
+#include <rand.h>
+#include <test/lib.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+#define CRC32_TEST_BUF_SIZE	4096
+
+/* Known-answer tests for crc32() */
+static int lib_crc32(struct unit_test_state *uts)
+{
+	const unsigned char str[] = "123456789";
+
+	ut_asserteq(0, crc32(0, NULL, 0));
+	ut_asserteq(0xcbf43926, crc32(0, str, 9));
+	ut_asserteq(0xcbf43926, crc32(crc32(0, str, 4), str + 4, 5));
+	ut_asserteq(0x2dfd2d88, crc32_no_comp(0, str, 9));
+
+	return 0;
+}
+LIB_TEST(lib_crc32, 0);
+
+/* Compare every available engine against the table engine */
+static int lib_crc32_engines(struct unit_test_state *uts)
+{
+	enum crc32_engine engine;
+	unsigned char *buf;
+	uint32_t expect, crc;
+	uint ofs, len;
+	int i;
+
+	ut_assert(crc32_engine_available(CRC32_ENGINE_TABLE));
+
+	buf = malloc(CRC32_TEST_BUF_SIZE);
+	ut_assertnonnull(buf);
+	srand(1);
+	for (i = 0; i < CRC32_TEST_BUF_SIZE; i++)
+		buf[i] = rand();
+
+	for (i = 0; i < 500; i++) {
+		/* cover every alignment and the short-length tails */
+		ofs = rand() % 16;
+		len = i < 64 ? i : rand() % (CRC32_TEST_BUF_SIZE - ofs);
+		expect = crc32_no_comp_engine(CRC32_ENGINE_TABLE, i, buf + ofs,
+					      len);
+		for (engine = 0; engine < CRC32_ENGINE_COUNT; engine++) {
+			if (!crc32_engine_available(engine))
+				continue;
+			crc = crc32_no_comp_engine(engine, i, buf + ofs, len);
+			ut_asserteq(expect, crc);
+		}
+		ut_asserteq(expect, crc32_no_comp(i, buf + ofs, len));
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_crc32_engines, 0);
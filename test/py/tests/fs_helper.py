@@ -9,7 +9,7 @@ import re
 import os
 from subprocess import call, check_call, check_output, CalledProcessError
 
-def mk_fs(config, fs_type, size, prefix, size_gran = 0x100000):
+def mk_fs(config, fs_type, size, prefix, size_gran = 0x100000, src_dir=None):
     """Create a file system volume
 
     Args:
@@ -18,6 +18,7 @@ def mk_fs(config, fs_type, size, prefix, size_gran = 0x100000):
         size (int): Size of file system in bytes
         prefix (str): Prefix string of volume's file name
         size_gran (int): Size granularity of file system image in bytes
+        src_dir (str): Directory to copy into an ext2/3/4 filesystem, or None
 
     Raises:
         CalledProcessError: if any error occurs when creating the filesystem
@@ -34,6 +35,9 @@ def mk_fs(config, fs_type, size, prefix, size_gran = 0x100000):
     else:
         mkfs_opt = ''
 
+    if src_dir and re.match('ext', fs_type):
+        mkfs_opt += f' -d {src_dir}'
+
     if re.match('fat', fs_type):
         fs_lnxtype = 'vfat'
     else:
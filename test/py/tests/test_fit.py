@@ -35,6 +35,12 @@ base_its = '''
                         compression = "none";
                         %(loadables1_load)s
                         entry = <0x0>;
+                        hash-1 {
+                                algo = "crc32";
+                        };
+                        hash-2 {
+                                algo = "sha256";
+                        };
                 };
                 fdt-1 {
                         description = "snow";
@@ -65,6 +71,9 @@ base_its = '''
                         os = "linux";
                         %(loadables2_load)s
                         compression = "none";
+                        hash-1 {
+                                algo = "sha1";
+                        };
                 };
         };
         configurations {
@@ -382,6 +391,67 @@ def test_fit(u_boot_console):
             check_equal(loadables2, loadables2_out,
                         'Loadables2 (ramdisk) not loaded')
 
+        # A loadable with bad data must be rejected and nothing may be written
+        # past its load region. Check this with the data corrupted, both
+        # embedded and external, and with external data whose size has been
+        # made larger, since 'data-size' is not covered by the hashes
+        with cons.log.section('Loadables with bad data'):
+            guard = 0x1000
+            size = params['loadables1_size']
+            guard_script = '''
+host load hostfs 0 %(fit_addr)x %(fit)s
+mw.b %(loadables1_addr)x a5 %(guard_size)x
+fdt addr %(fit_addr)x
+%(fit_cmd)s
+bootm start %(fit_addr)x
+host save hostfs 0 %(loadables1_addr)x %(loadables1_out)s %(guard_size)x
+'''
+            params['guard_size'] = size + guard
+            params['fit_cmd'] = ''
+
+            def load_guarded(bad):
+                cons.restart_uboot()
+                output = cons.run_command_list(
+                    (guard_script % params).splitlines())
+                assert ('Bad Data Hash' in ''.join(output)) == bad
+                return read_file(loadables1_out)
+
+            def corrupt_fit():
+                data = bytearray(read_file(fit))
+                pos = data.find(read_file(loadables1))
+                assert pos != -1
+                data[pos + 100] ^= 0xff
+                with open(fit, 'wb') as fd:
+                    fd.write(data)
+
+            corrupt_fit()
+            data = load_guarded(True)
+            assert data[size:] == b'\xa5' * guard, (
+                'Bad loadable written past its load region')
+
+            # External data is hashed while it is copied, like embedded data
+            its = fit_util.make_its(cons, base_its, params)
+            util.run_and_log(cons, [mkimage, '-E', '-f', its, fit])
+            data = load_guarded(False)
+            assert data[:size] == read_file(loadables1), (
+                'External loadable not loaded')
+            assert data[size:] == b'\xa5' * guard, (
+                'External loadable written past its load region')
+
+            corrupt_fit()
+            data = load_guarded(True)
+            assert data[size:] == b'\xa5' * guard, (
+                'Bad external loadable written past its load region')
+
+            # A larger size fails the hash and writes no more than that size
+            util.run_and_log(cons, [mkimage, '-E', '-f', its, fit])
+            params['fit_cmd'] = ('fdt set /images/kernel-2 data-size <%#x>' %
+                                 (size + 0x100))
+            data = load_guarded(True)
+            assert data[size + 0x100:] == b'\xa5' * (guard - 0x100), (
+                'Loadable with bad size written past its size')
+            params['fit_cmd'] = ''
+
         # Kernel, FDT and Ramdisk all compressed
         with cons.log.section('(Kernel + FDT + Ramdisk) compressed'):
             params['compression'] = 'gzip'
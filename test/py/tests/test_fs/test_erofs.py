@@ -2,6 +2,7 @@
 # Copyright (C) 2022 Huang Jianan <jnhuang95@gmail.com>
 # Author: Huang Jianan <jnhuang95@gmail.com>
 
+import hashlib
 import os
 import pytest
 import shutil
@@ -19,7 +20,17 @@ def generate_file(name, size):
     file.write(content)
     file.close()
 
-def make_erofs_image(build_dir):
+def generate_text_file(name, size):
+    """
+    Generates a file filled with numbered lines, which spans several
+    compressed clusters.
+    """
+    lines = ['line {:06d}\n'.format(i) for i in range(size // 12 + 1)]
+    file = open(name, 'w')
+    file.write(''.join(lines)[:size])
+    file.close()
+
+def make_erofs_image(build_dir, algorithm):
     """
     Makes the EROFS images used for the test.
 
@@ -27,6 +38,7 @@ def make_erofs_image(build_dir):
     erofs_src_dir/
     ├── f4096
     ├── f7812
+    ├── f100000
     ├── subdir/
     │   └── subdir-file
     ├── symdir -> subdir
@@ -41,6 +53,9 @@ def make_erofs_image(build_dir):
     # 7812: Compressed file
     generate_file(os.path.join(root, 'f7812'), 7812)
 
+    # 100000: Compressed file made of several clusters
+    generate_text_file(os.path.join(root, 'f100000'), 100000)
+
     # sub-directory with a single file inside
     subdir_path = os.path.join(root, 'subdir')
     os.makedirs(subdir_path)
@@ -53,8 +68,8 @@ def make_erofs_image(build_dir):
     input_path = os.path.join(build_dir, EROFS_SRC_DIR)
     output_path = os.path.join(build_dir, EROFS_IMAGE_NAME)
     args = ' '.join([output_path, input_path])
-    subprocess.run(['mkfs.erofs -zlz4 ' + args], shell=True, check=True,
-                   stdout=subprocess.DEVNULL)
+    subprocess.run(['mkfs.erofs -z{} {}'.format(algorithm, args)], shell=True,
+                   check=True, stdout=subprocess.DEVNULL)
 
 def clean_erofs_image(build_dir):
     """
@@ -73,8 +88,9 @@ def erofs_ls_at_root(u_boot_console):
     slash = u_boot_console.run_command('erofsls host 0 /')
     assert no_slash == slash
 
-    expected_lines = ['./', '../', '4096   f4096', '7812   f7812', 'subdir/',
-                      '<SYM>   symdir', '<SYM>   symfile', '4 file(s), 3 dir(s)']
+    expected_lines = ['./', '../', '4096   f4096', '7812   f7812',
+                      '100000   f100000', 'subdir/', '<SYM>   symdir',
+                      '<SYM>   symfile', '5 file(s), 3 dir(s)']
 
     output = u_boot_console.run_command('erofsls host 0')
     for line in expected_lines:
@@ -138,8 +154,8 @@ def erofs_load_files_at_root(u_boot_console):
     """
     Test load file from the root directory.
     """
-    files = ['f4096', 'f7812']
-    sizes = ['4096', '7812']
+    files = ['f4096', 'f7812', 'f100000']
+    sizes = ['4096', '7812', '100000']
     address = '$kernel_addr_r'
     erofs_load_files(u_boot_console, files, sizes, address)
 
@@ -161,6 +177,28 @@ def erofs_load_files_at_symlink(u_boot_console):
     address = '$kernel_addr_r'
     erofs_load_files(u_boot_console, files, sizes, address)
 
+def erofs_load_file_pieces(u_boot_console):
+    """
+    Test loading a file in pieces which start and end within clusters.
+    """
+    build_dir = u_boot_console.config.build_dir
+    path = os.path.join(build_dir, EROFS_SRC_DIR, 'f100000')
+    with open(path, 'rb') as file:
+        content = file.read()
+
+    address = '$kernel_addr_r'
+    for (pos, size) in [(5000, 7000), (12000, 7000), (0, 1000),
+                        (99000, 1000), (5000, 7000)]:
+        cmd = 'erofsload host 0 {} f100000 {:x} {:x}'.format(address, size,
+                                                              pos)
+        out = u_boot_console.run_command(cmd)
+        assert '{} bytes read'.format(size) in out
+
+        out = u_boot_console.run_command('md5sum {} {:x}'.format(address, size))
+        u_boot_checksum = out.split()[-1]
+        original_checksum = hashlib.md5(content[pos:pos + size]).hexdigest()
+        assert u_boot_checksum == original_checksum
+
 def erofs_load_non_existent_file(u_boot_console):
     """
     Test if the EROFS support will crash when load a nonexistent file.
@@ -181,6 +219,7 @@ def erofs_run_all_tests(u_boot_console):
     erofs_load_files_at_root(u_boot_console)
     erofs_load_files_at_subdir(u_boot_console)
     erofs_load_files_at_symlink(u_boot_console)
+    erofs_load_file_pieces(u_boot_console)
     erofs_load_non_existent_file(u_boot_console)
 
 @pytest.mark.boardspec('sandbox')
@@ -189,12 +228,17 @@ def erofs_run_all_tests(u_boot_console):
 @pytest.mark.buildconfigspec('fs_erofs')
 @pytest.mark.requiredtool('mkfs.erofs')
 @pytest.mark.requiredtool('md5sum')
+@pytest.mark.parametrize('algorithm', ['lz4', 'lzma', 'deflate'])
 
-def test_erofs(u_boot_console):
+def test_erofs(u_boot_console, algorithm):
     """
     Executes the erofs test suite.
     """
     build_dir = u_boot_console.config.build_dir
+    config = 'config_fs_erofs_zip_' + algorithm
+    if (algorithm != 'lz4' and
+            u_boot_console.config.buildconfig.get(config, 'n') != 'y'):
+        pytest.skip('{} compression is not enabled'.format(algorithm))
 
     # If the EFI subsystem is enabled and initialized, EFI subsystem tries to
     # add EFI boot option when the new disk is detected. If there is no EFI
@@ -207,7 +251,7 @@ def test_erofs(u_boot_console):
 
     try:
         # setup test environment
-        make_erofs_image(build_dir)
+        make_erofs_image(build_dir, algorithm)
         image_path = os.path.join(build_dir, EROFS_IMAGE_NAME)
         u_boot_console.run_command('host bind 0 {}'.format(image_path))
         # run all tests
@@ -6,6 +6,9 @@ import getpass
 import gzip
 import os
 import os.path
+import shutil
+import struct
+import tempfile
 import pytest
 
 import u_boot_utils
@@ -536,8 +539,44 @@ def test_ut_dm_init(u_boot_console):
             u_boot_console, f'sfdisk {fn}', stdin=b'type=83')
 
     fs_helper.mk_fs(u_boot_console.config, 'ext2', 0x200000, '2MB')
+
+    # Create an ext2 filesystem for dm_test_blk_fs_runs to write to
+    fs_helper.mk_fs(u_boot_console.config, 'ext2', 0x200000, 'runs')
+
+    # Create an ext4 filesystem with a file of two extents around a hole,
+    # and one with 400 extents, which needs index blocks
+    with tempfile.TemporaryDirectory() as src_dir:
+        data = b''.join(struct.pack('<I', i) for i in range(0x40000))
+        with open(os.path.join(src_dir, 'runs'), 'wb') as fh:
+            fh.write(data[:0x40000])
+            fh.seek(0x80000)
+            fh.write(data[0x80000:])
+        with open(os.path.join(src_dir, 'extents'), 'wb') as fh:
+            for i in range(400):
+                fh.seek(i * 0x2000)
+                fh.write(bytes([i % 255 + 1]) * 0x1000)
+        fs_helper.mk_fs(u_boot_console.config, 'ext4', 0x800000, '8MB',
+                        src_dir=src_dir)
+
     fs_helper.mk_fs(u_boot_console.config, 'fat32', 0x100000, '1MB')
 
+    # Create a FAT32 filesystem for dm_test_blk_fs_runs to write to
+    fs_helper.mk_fs(u_boot_console.config, 'fat32', 0x100000, 'runs')
+
+    # Create a SquashFS filesystem whose files all share a fragment block.
+    # Without mksquashfs, dm_test_blk_sqfs_cache is skipped instead.
+    if shutil.which('mksquashfs'):
+        with tempfile.TemporaryDirectory() as src_dir:
+            for name, size in (('a', 3000), ('b', 2000), ('c', 1500)):
+                with open(os.path.join(src_dir, name), 'wb') as fh:
+                    fh.write(bytes((i * 7 + ord(name)) & 0xff
+                                   for i in range(size)))
+            fn = os.path.join(u_boot_console.config.persistent_data_dir,
+                              'sqfs.img')
+            u_boot_utils.run_and_log(
+                u_boot_console, f'mksquashfs {src_dir} {fn} -noappend '
+                '-comp gzip -always-use-fragments')
+
     mmc_dev = 6
     fn = os.path.join(u_boot_console.config.source_dir, f'mmc{mmc_dev}.img')
     data = b'\x00' * (12 * 1024 * 1024)